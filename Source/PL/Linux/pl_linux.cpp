@@ -0,0 +1,174 @@
+#include "PL/pl.h"
+#include "PL/pl_utils.h"
+#include "PL/pl_memory_arena.h"
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+
+//Headless PL for Linux servers: timing is real, there is no window, input or audio.
+//The window functions keep the same contract as Win32 so an app that asks for a window just gets told to stop running.
+
+struct LinuxSpecific
+{
+	b32* pointer_to_pl_running;
+};
+
+static LinuxSpecific* pl_specific;
+
+//-------------------------------<window stuff>----------------------------------------
+void PL_initialize_window(PL_Window& window)
+{
+	pl_print("No window support on Linux. Run with --headless.\n");
+	*pl_specific->pointer_to_pl_running = FALSE;
+}
+
+void PL_initialize_window(PL_Window& window, MArena* arena)
+{
+	PL_initialize_window(window);
+}
+
+void PL_poll_window(PL_Window& window)
+{
+}
+
+void PL_push_window(PL_Window& window, b32 refresh_window_title)
+{
+}
+
+void PL_cleanup_window(PL_Window& window, MArena* arena)
+{
+}
+
+void PL_cleanup_window(PL_Window& window)
+{
+}
+//-------------------------------</window stuff>----------------------------------------
+
+//-------------------------------<timing stuff>-----------------------------------------
+//NOTE: "cycles" are nanoseconds of CLOCK_MONOTONIC (same clock as pl_get_tsc)
+void PL_initialize_timing(PL_Timing& time)
+{
+	time.cycles_per_second = 1000000000ull;
+
+	PL_poll_timing(time);	//To avoid the first frame having wierd 0 delta and current time values.
+}
+
+void PL_poll_timing(PL_Timing& time)
+{
+	uint64 new_q = pl_get_tsc();
+
+	f64 tmp_cs;
+	uint64 tmp_cmil, tmp_cmic;
+
+	tmp_cs = (f64)new_q / (f64)time.cycles_per_second;
+	tmp_cmil = (uint64)(tmp_cs * 1000);
+	tmp_cmic = (uint64)(tmp_cs * 1000000);
+
+	time.delta_cycles = new_q - time.current_cycles;
+	time.delta_millis = tmp_cmil - time.current_millis;
+	time.delta_micros = tmp_cmic - time.current_micros;
+
+	time.fdelta_seconds = (new_q - time.current_cycles) / (f32)time.cycles_per_second;
+
+	time.fcurrent_seconds = tmp_cs;
+	time.current_cycles = new_q;
+	time.current_seconds = (uint64)tmp_cs;
+	time.current_millis = tmp_cmil;
+	time.current_micros = tmp_cmic;
+}
+//-------------------------------</timing stuff>----------------------------------------
+
+//-------------------------------<input stuff>------------------------------------------
+//NOTE: no input without a window. Buttons stay up.
+void PL_initialize_input_mouse(PL_Input_Mouse& mouse)
+{
+	mouse = {};
+}
+
+void PL_poll_input_mouse(PL_Input_Mouse& mouse, PL_Window& main_window)
+{
+}
+
+void PL_initialize_input_keyboard(PL_Input_Keyboard& keyboard)
+{
+	keyboard = {};
+}
+
+void PL_poll_input_keyboard(PL_Input_Keyboard& keyboard)
+{
+}
+
+void PL_initialize_input_gamepad(PL_Input_Gamepad& gamepad)
+{
+	gamepad = {};
+}
+
+void PL_poll_input_gamepad(PL_Input_Gamepad& gamepad)
+{
+}
+//-------------------------------</input stuff>-----------------------------------------
+
+//-------------------------------<audio stuff>------------------------------------------
+//TODO: ALSA/PulseAudio backend. Capture never has new frames and nothing is played.
+void PL_initialize_audio_render(PL_Audio_Output& output)
+{
+}
+
+void PL_push_audio_render(PL_Audio_Output& pl)
+{
+}
+
+void PL_cleanup_audio_render(PL_Audio_Output& pl)
+{
+}
+
+void PL_initialize_audio_capture(PL_Audio_Input& input)
+{
+	input.no_of_new_frames = 0;
+	input.sink_buffer = 0;
+}
+
+void PL_initialize_audio_capture(PL_Audio_Input& input, MArena* arena)
+{
+	PL_initialize_audio_capture(input);
+}
+
+void PL_poll_audio_capture(PL_Audio_Input& input)
+{
+	input.no_of_new_frames = 0;
+}
+
+void PL_cleanup_audio_capture(PL_Audio_Input& input)
+{
+}
+
+void PL_cleanup_audio_capture(PL_Audio_Input& input, MArena* arena)
+{
+}
+//-------------------------------</audio stuff>-----------------------------------------
+
+
+//--------------------------------<Linux ENTRY POINT>------------------------------------------
+//A platform's PL implementation has the job of creating a PL object and a platform_specific object in the main()
+// and calling PL_entry_point to let the application handle how the initialization and game loop runs.
+int main(int argc, char** argv)
+{
+	LinuxSpecific pl_linux = {};
+
+	PL pl = {};
+	pl_specific = &pl_linux;
+	pl_specific->pointer_to_pl_running = &pl.running;
+
+	//a write to a pipe of a child process that died returns an error instead of killing this process
+	signal(SIGPIPE, SIG_IGN);
+
+	long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+	pl.core_count = core_count > 0 ? (uint32)core_count : 1;
+
+	pl.argc = argc;
+	pl.argv = argv;
+
+	PL_entry_point(pl);
+	return pl.exit_code;
+}
+//--------------------------------</Linux ENTRY POINT>------------------------------------------
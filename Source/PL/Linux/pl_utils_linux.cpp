@@ -0,0 +1,584 @@
+#include "PL/pl_utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <spawn.h>
+#include <x86intrin.h>
+
+//NOTE: file handles are file descriptors cast to void*
+
+//Paths in the app are written with '\' (Win32). Converted to '/' here so the same paths work.
+#define PL_LINUX_MAX_PATH 4096
+static b32 to_posix_path(const char* path, char* buffer)
+{
+	uint32 i = 0;
+	for (; path[i] != 0; i++)
+	{
+		if (i + 1 >= PL_LINUX_MAX_PATH)
+		{
+			return FALSE;
+		}
+		buffer[i] = path[i] == '\\' ? '/' : path[i];
+	}
+	buffer[i] = 0;
+	return TRUE;
+}
+
+uint32 pl_get_thread_id()
+{
+	return (uint32)syscall(SYS_gettid);
+}
+
+uint64 pl_get_hardware_entropy()
+{
+	//TODO: consider using rdrand intrinsic for proper hardware entropy
+	//right now, just gets current time stamp counter and multiplies with thread id (to make "thread safe" I guess)
+	return __rdtsc() * pl_get_thread_id();
+}
+
+//---------------------------------------------<THREADING>--------------------------------------------
+//NOTE: pthreads can only be joined once and can't be joined after being detached, so the handle remembers if it was.
+struct LinuxThread
+{
+	pthread_t thread;
+	b32 joined;
+};
+
+//owned by the new thread, since the handle can be closed before the thread starts
+struct CreateThreadData
+{
+	ThreadProc func_to_be_executed;
+	void* data;
+};
+
+static void* linux_start_thread(void* parameter)
+{
+	CreateThreadData* new_thread_data = (CreateThreadData*)parameter;
+	new_thread_data->func_to_be_executed(new_thread_data->data);
+	pl_buffer_free(new_thread_data);
+	return 0;
+}
+
+ThreadHandle pl_create_thread(ThreadProc proc, void* data)
+{
+	CreateThreadData* new_thread_data = (CreateThreadData*)pl_buffer_alloc(sizeof(CreateThreadData));
+	new_thread_data->func_to_be_executed = proc;
+	new_thread_data->data = data;
+
+	ThreadHandle handle;
+	handle.thread_handle = 0;
+	LinuxThread* thread = (LinuxThread*)pl_buffer_alloc(sizeof(LinuxThread));
+	if (pthread_create(&thread->thread, 0, linux_start_thread, new_thread_data) != 0)
+	{
+		pl_buffer_free(new_thread_data);
+		pl_buffer_free(thread);
+		return handle;
+	}
+	handle.thread_handle = thread;
+	return handle;
+}
+
+void pl_close_thread(const ThreadHandle* handle)
+{
+	LinuxThread* thread = (LinuxThread*)handle->thread_handle;
+	if (!thread->joined)
+	{
+		pthread_detach(thread->thread);	//like closing a Win32 handle, the thread keeps running
+	}
+	pl_buffer_free(thread);
+}
+
+//gets the absolute CLOCK_REALTIME time timeout_in_ms from now (what the timed pthread/semaphore waits take)
+static timespec get_deadline(uint32 timeout_in_ms)
+{
+	timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout_in_ms / 1000;
+	deadline.tv_nsec += (long)(timeout_in_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+	return deadline;
+}
+
+b32 pl_wait_for_thread(const ThreadHandle* handle, uint32 timeout_in_ms)
+{
+	LinuxThread* thread = (LinuxThread*)handle->thread_handle;
+	if (thread->joined)
+	{
+		return FALSE;
+	}
+	int32 result;
+	if (timeout_in_ms == UINT32MAX)	//INFINITE
+	{
+		result = pthread_join(thread->thread, 0);
+	}
+	else
+	{
+		timespec deadline = get_deadline(timeout_in_ms);
+		result = pthread_timedjoin_np(thread->thread, 0, &deadline);
+	}
+	if (result == 0)
+	{
+		thread->joined = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+b32 pl_wait_for_all_threads(uint32 no_of_threads, const ThreadHandle* handles, uint32 timeout_in_ms)
+{
+	uint64 start = pl_get_tsc();
+	for (uint32 i = 0; i < no_of_threads; i++)
+	{
+		uint32 remaining = timeout_in_ms;
+		if (timeout_in_ms != UINT32MAX)
+		{
+			uint64 elapsed_ms = (pl_get_tsc() - start) / 1000000;
+			remaining = elapsed_ms < timeout_in_ms ? timeout_in_ms - (uint32)elapsed_ms : 0;
+		}
+		if (pl_wait_for_thread(&handles[i], remaining))
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+void pl_sleep_thread(uint32 timeout_in_ms)
+{
+	if (timeout_in_ms == 0)
+	{
+		sched_yield();	//Sleep(0) gives up the rest of the time slice
+		return;
+	}
+	timespec duration;
+	duration.tv_sec = timeout_in_ms / 1000;
+	duration.tv_nsec = (long)(timeout_in_ms % 1000) * 1000000;
+	while (nanosleep(&duration, &duration) != 0 && errno == EINTR)
+	{
+	}
+}
+
+//NOTE: POSIX semaphores have no max count. max_count is ignored.
+SemaphoreHandle pl_create_semaphore(int32 initial_count, int32 max_count)
+{
+	SemaphoreHandle handle;
+	sem_t* semaphore = (sem_t*)pl_buffer_alloc(sizeof(sem_t));
+	sem_init(semaphore, 0, (uint32)initial_count);
+	handle.semaphore_handle = semaphore;
+	return handle;
+}
+
+void pl_signal_semaphore(const SemaphoreHandle* handle, int32 count)
+{
+	for (int32 i = 0; i < count; i++)
+	{
+		sem_post((sem_t*)handle->semaphore_handle);
+	}
+}
+
+b32 pl_wait_for_semaphore(const SemaphoreHandle* handle, uint32 timeout_in_ms)
+{
+	sem_t* semaphore = (sem_t*)handle->semaphore_handle;
+	int32 result;
+	if (timeout_in_ms == UINT32MAX)	//INFINITE
+	{
+		while ((result = sem_wait(semaphore)) != 0 && errno == EINTR)
+		{
+		}
+	}
+	else
+	{
+		timespec deadline = get_deadline(timeout_in_ms);
+		while ((result = sem_timedwait(semaphore, &deadline)) != 0 && errno == EINTR)
+		{
+		}
+	}
+	return result != 0;
+}
+
+void pl_close_semaphore(const SemaphoreHandle* handle)
+{
+	sem_destroy((sem_t*)handle->semaphore_handle);
+	pl_buffer_free(handle->semaphore_handle);
+}
+//---------------------------------------------</THREADING>-------------------------------------------
+
+//---------------------------------------------<MEMORY>-----------------------------------------------
+void pl_buffer_set(void* buffer, int32 value_to_set, size_t no_bytes_to_set)
+{
+	memset(buffer, value_to_set, no_bytes_to_set);
+}
+
+void pl_buffer_copy(void* destination, void* from, size_t length)
+{
+	memcpy(destination, from, length);
+}
+
+void pl_buffer_move(void* destination, void* source, size_t length)
+{
+	memmove(destination, source, length);
+}
+
+//Arenas are mmapped directly (like VirtualAlloc): zeroed, page aligned and only backed by memory once touched.
+//munmap needs the size, so it's kept in a header in front of the buffer.
+#define PL_ARENA_HEADER_SIZE 64		//keeps the buffer cache line aligned
+
+void* pl_arena_buffer_alloc(size_t size)
+{
+	void* block = mmap(0, size + PL_ARENA_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (block == MAP_FAILED)
+	{
+		return 0;
+	}
+	*(size_t*)block = size + PL_ARENA_HEADER_SIZE;
+	return (uint8*)block + PL_ARENA_HEADER_SIZE;
+}
+
+//NOTE: mremap moves the pages instead of copying them
+void* pl_arena_buffer_resize(void* block, size_t old_size, size_t new_size)
+{
+	uint8* header = (uint8*)block - PL_ARENA_HEADER_SIZE;
+	void* new_block = mremap(header, *(size_t*)header, new_size + PL_ARENA_HEADER_SIZE, MREMAP_MAYMOVE);
+	if (new_block == MAP_FAILED)
+	{
+		return 0;
+	}
+	*(size_t*)new_block = new_size + PL_ARENA_HEADER_SIZE;
+	return (uint8*)new_block + PL_ARENA_HEADER_SIZE;
+}
+
+void pl_arena_buffer_free(void* arena_buffer)
+{
+	uint8* header = (uint8*)arena_buffer - PL_ARENA_HEADER_SIZE;
+	munmap(header, *(size_t*)header);
+}
+
+//NOTE: calloc gets big blocks straight from mmap, so they aren't cleared twice
+void* pl_buffer_alloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+//NOTE: realloc doesn't know how much of the block was asked for, so everything after the kept bytes is cleared
+//up to the usable size (including the slack at the end, which a later resize will hand out).
+void* pl_buffer_resize(void* block, size_t new_size)
+{
+	size_t old_size = block ? malloc_usable_size(block) : 0;
+	uint8* new_block = (uint8*)realloc(block, new_size);
+	if (new_block)
+	{
+		size_t kept = old_size < new_size ? old_size : new_size;
+		memset(new_block + kept, 0, malloc_usable_size(new_block) - kept);
+	}
+	return new_block;
+}
+
+void pl_buffer_free(void* buffer)
+{
+	free(buffer);
+}
+//---------------------------------------------</MEMORY>----------------------------------------------
+
+//---------------------------------------------<PROCESSES>--------------------------------------------
+extern char** environ;
+
+//NOTE: the command line goes through /bin/sh like CreateProcess parses it on Win32 (quotes, spaces).
+//exec replaces the shell, so the pid is the program's and killing it doesn't leave the program running.
+b32 pl_create_process(ProcessHandle* handle, char* command_line)
+{
+	int32 input_fds[2], output_fds[2];
+	if (pipe2(input_fds, O_CLOEXEC) != 0)
+	{
+		return FALSE;
+	}
+	if (pipe2(output_fds, O_CLOEXEC) != 0)
+	{
+		close(input_fds[0]);
+		close(input_fds[1]);
+		return FALSE;
+	}
+
+	size_t command_length = strlen(command_line);
+	char* shell_command = (char*)pl_buffer_alloc(command_length + 6);
+	memcpy(shell_command, "exec ", 5);
+	memcpy(shell_command + 5, command_line, command_length + 1);
+
+	//dup2'd fds don't keep O_CLOEXEC, so the child only gets these two ends
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, input_fds[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, output_fds[1], STDOUT_FILENO);
+
+	char shell[] = "/bin/sh";
+	char shell_flag[] = "-c";
+	char* args[] = { shell, shell_flag, shell_command, 0 };
+	pid_t pid;
+	int32 error = posix_spawn(&pid, shell, &actions, 0, args, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	pl_buffer_free(shell_command);
+
+	close(input_fds[0]);
+	close(output_fds[1]);
+	if (error != 0)
+	{
+		close(input_fds[1]);
+		close(output_fds[0]);
+		return FALSE;
+	}
+	handle->process_handle = (void*)(intptr_t)pid;
+	handle->input_pipe = (void*)(intptr_t)input_fds[1];
+	handle->output_pipe = (void*)(intptr_t)output_fds[0];
+	return TRUE;
+}
+
+void pl_close_process(ProcessHandle* handle)
+{
+	close((int32)(intptr_t)handle->input_pipe);
+	close((int32)(intptr_t)handle->output_pipe);
+	pid_t pid = (pid_t)(intptr_t)handle->process_handle;
+	kill(pid, SIGKILL);
+	while (waitpid(pid, 0, 0) < 0 && errno == EINTR)
+	{
+	}
+	*handle = {};
+}
+
+void* pl_get_standard_input()
+{
+	return (void*)(intptr_t)STDIN_FILENO;
+}
+
+void* pl_get_standard_output()
+{
+	return (void*)(intptr_t)STDOUT_FILENO;
+}
+
+b32 pl_read_from_pipe(void* pipe, void* block_to_store_into, uint32 no_bytes)
+{
+	int32 fd = (int32)(intptr_t)pipe;
+	uint8* dst = (uint8*)block_to_store_into;
+	while (no_bytes > 0)
+	{
+		ssize_t read_bytes = read(fd, dst, no_bytes);
+		if (read_bytes < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (read_bytes <= 0)
+		{
+			return FALSE;
+		}
+		dst += read_bytes;
+		no_bytes -= (uint32)read_bytes;
+	}
+	return TRUE;
+}
+
+//NOTE: SIGPIPE is ignored (see main), so writing to a pipe whose reader died fails with EPIPE instead of killing the process
+b32 pl_write_to_pipe(void* pipe, void* block_to_write, uint32 no_bytes)
+{
+	int32 fd = (int32)(intptr_t)pipe;
+	uint8* src = (uint8*)block_to_write;
+	while (no_bytes > 0)
+	{
+		ssize_t written = write(fd, src, no_bytes);
+		if (written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (written <= 0)
+		{
+			return FALSE;
+		}
+		src += written;
+		no_bytes -= (uint32)written;
+	}
+	return TRUE;
+}
+//---------------------------------------------</PROCESSES>-------------------------------------------
+
+//---------------------------------------------<FILE I/O>---------------------------------------------
+b32 pl_get_file_handle(char* path, void** handle)
+{
+	char posix_path[PL_LINUX_MAX_PATH];
+	if (!to_posix_path(path, posix_path))
+	{
+		return FALSE;
+	}
+	int32 fd = open(posix_path, O_RDWR);
+	if (fd < 0 && (errno == EACCES || errno == EROFS || errno == EISDIR))
+	{
+		fd = open(posix_path, O_RDONLY);	//read only assets
+	}
+	if (fd < 0)
+	{
+		return FALSE;
+	}
+	*handle = (void*)(intptr_t)fd;
+	return TRUE;
+}
+
+//NOTE: one read() straight into the caller's buffer. Mapping the file would need a copy into the buffer anyway
+//(callers keep and modify it), so that would be slower.
+b32 pl_load_file_into(void* handle, void* block_to_store_into, uint32 file_size)
+{
+	int32 fd = (int32)(intptr_t)handle;
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	uint8* dst = (uint8*)block_to_store_into;
+	size_t remaining = file_size;
+	while (remaining > 0)
+	{
+		ssize_t read_bytes = read(fd, dst, remaining);
+		if (read_bytes < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (read_bytes <= 0)
+		{
+			return FALSE;
+		}
+		dst += read_bytes;
+		remaining -= (size_t)read_bytes;
+	}
+	return TRUE;
+}
+
+b32 pl_create_file(void** file_handle, char* path)
+{
+	char posix_path[PL_LINUX_MAX_PATH];
+	if (!to_posix_path(path, posix_path))
+	{
+		return FALSE;
+	}
+	int32 fd = open(posix_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		return FALSE;
+	}
+	*file_handle = (void*)(intptr_t)fd;
+	return TRUE;
+}
+
+b32 pl_create_or_overwrite_file(void** file_handle, char* path)
+{
+	char posix_path[PL_LINUX_MAX_PATH];
+	if (!to_posix_path(path, posix_path))
+	{
+		return FALSE;
+	}
+	int32 fd = open(posix_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		return FALSE;
+	}
+	*file_handle = (void*)(intptr_t)fd;
+	return TRUE;
+}
+
+b32 pl_append_to_file(void* file_handle, void* block_to_store, int32 bytes_to_append)
+{
+	int32 fd = (int32)(intptr_t)file_handle;
+	lseek(fd, 0, SEEK_END);
+	uint8* src = (uint8*)block_to_store;
+	size_t remaining = (size_t)bytes_to_append;
+	while (remaining > 0)
+	{
+		ssize_t written = write(fd, src, remaining);
+		if (written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (written <= 0)
+		{
+			return FALSE;
+		}
+		src += written;
+		remaining -= (size_t)written;
+	}
+	return TRUE;
+}
+
+b32 pl_close_file_handle(void* file_handle)
+{
+	return close((int32)(intptr_t)file_handle) == 0;
+}
+
+b32 pl_replace_file(char* from, char* to)
+{
+	char posix_from[PL_LINUX_MAX_PATH];
+	char posix_to[PL_LINUX_MAX_PATH];
+	if (!to_posix_path(from, posix_from) || !to_posix_path(to, posix_to))
+	{
+		return FALSE;
+	}
+	return rename(posix_from, posix_to) == 0;
+}
+
+uint64 pl_get_file_size(void* handle)
+{
+	struct stat file_stat;
+	if (fstat((int32)(intptr_t)handle, &file_stat) != 0)
+	{
+		return 0;
+	}
+	return (uint64)file_stat.st_size;
+}
+//---------------------------------------------</FILE I/O>--------------------------------------------
+
+//NOTE: nanoseconds of CLOCK_MONOTONIC (vDSO, no syscall). Like QueryPerformanceCounter on Win32, it's not the raw
+//rdtsc, so it's steady across cores and frequency changes.
+uint64 pl_get_tsc()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64)now.tv_sec * 1000000000ull + (uint64)now.tv_nsec;
+}
+
+void pl_throw_error_box(const char* error)
+{
+	fprintf(stderr, "INVALID CODE PATH! %s\n", error);
+}
+
+//NOTE: straight to the stream, as these are called from job system workers at once. stdio locks the stream for a call,
+//so their lines don't get mixed (and there's no length limit).
+void pl_debug_print(const char* format, ...)
+{
+	va_list arg_list;
+	va_start(arg_list, format);
+	vfprintf(stderr, format, arg_list);
+	va_end(arg_list);
+}
+
+void pl_print(const char* format, ...)
+{
+	va_list arg_list;
+	va_start(arg_list, format);
+	vfprintf(stdout, format, arg_list);
+	va_end(arg_list);
+	fflush(stdout);	//progress shows up right away when piped to a log
+}
+
+void pl_format_print(char* buffer, uint32 buffer_size, const char* format, ...)
+{
+	va_list arg_list;
+	va_start(arg_list, format);
+	vsnprintf(buffer, buffer_size, format, arg_list);
+	va_end(arg_list);
+}
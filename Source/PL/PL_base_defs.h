@@ -2,17 +2,30 @@
 //---------------------------------------<Base Definitions>------------------------------------------------------------
 #pragma once
 
+#ifdef _WIN32
 #define PL_WINDOWS
+#elif defined(__linux__)
+#define PL_LINUX
+#endif
 #define PL_INTERNAL
 
 #ifdef _MSC_VER
 #define PL_COMPILER_MSVC 1
+#elif defined(__GNUC__)
+#define PL_COMPILER_GCC 1	//clang defines __GNUC__ too
+#endif
+
+#ifdef PL_COMPILER_MSVC
+#define PL_DEBUG_BREAK() __debugbreak()
+#else
+#define PL_DEBUG_BREAK() __builtin_trap()
 #endif
 
-#define ERRORBOX(error) {pl_throw_error_box(error); __debugbreak();}
+#define ERRORBOX(error) {pl_throw_error_box(error); PL_DEBUG_BREAK();}
 
-#ifdef _DEBUG
-#define ASSERT(x) if(!(x)) __debugbreak();
+//NOTE: GCC/Clang builds don't define _DEBUG, so asserts are on unless NDEBUG is defined (like assert())
+#if defined(_DEBUG) || (defined(PL_COMPILER_GCC) && !defined(NDEBUG))
+#define ASSERT(x) if(!(x)) PL_DEBUG_BREAK();
 #else
 #define ASSERT(X)
 #endif 
@@ -25,12 +38,20 @@
 #define PL_X86
 #endif
 #endif
+#else
+#ifdef __x86_64__
+#define PL_X64
+#else
+#ifdef __i386__
+#define PL_X86
+#endif
+#endif
 #endif
 
 #ifdef PL_COMPILER_MSVC 
 #define FORCEDINLINE __forceinline
 #else
-#define FORCEDINLINE __attribute__((always_inline))
+#define FORCEDINLINE inline __attribute__((always_inline))
 #endif
 
 #ifndef TRUE
@@ -49,6 +70,8 @@
 
 //-----------------------------------------------
 
+#include <stddef.h>	//size_t (MSVC has it without the include)
+
 typedef signed char        int8;
 typedef short              int16;
 typedef int                int32;
@@ -73,6 +96,8 @@ typedef double f64;
 #define MIN_FLOAT          1.175494351e-38F        // min normalized positive value
 #define UINT32MAX		   0xffffffff			
 #define INV_UINT32_MAX	   2.328306437e-10F
+#define PI32			   3.14159265359f
+#define INV_PI32		   0.31830988618f
 
 #define ArrayCount(array) (sizeof(array) / sizeof(array[0]))
 
@@ -1,6 +1,10 @@
 #pragma once
-#include "pl_base_defs.h"
+#include "PL_base_defs.h"
+#ifdef PL_COMPILER_MSVC
 #include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 
 //Table for quick uint64 pow(10,x)
 constexpr uint64 INT_POWER_10[20] =
@@ -24,7 +28,7 @@ constexpr uint64 INT_POWER_10[20] =
 	10000000000000000,
 	100000000000000000,
 	1000000000000000000,
-	10000000000000000000,
+	10000000000000000000ULL,
 };
 
 #define AT_POWER_10_OFFSET 28	//where 1.0 (1.0e0) is in POWER_10
@@ -349,6 +353,21 @@ FORCEDINLINE f32 fpow(f32 base, f32 exponent)
 	return powf(base, exponent);
 }
 
+FORCEDINLINE f32 fexp(f32 exponent)
+{
+	return expf(exponent);
+}
+
+FORCEDINLINE f32 fsin(f32 radians)
+{
+	return sinf(radians);
+}
+
+FORCEDINLINE f32 fcos(f32 radians)
+{
+	return cosf(radians);
+}
+
 FORCEDINLINE f64 sqroot(f64 real64)
 {
 	f64 result = _mm_cvtsd_f64(_mm_sqrt_pd(_mm_set_sd(real64)));
@@ -361,6 +380,15 @@ FORCEDINLINE f32 sqroot(f32 real32)
 	return result;
 }
 
+FORCEDINLINE f32 inv_sqroot(f32 real32)
+{
+#ifdef PL_COMPILER_MSVC
+	return _mm_cvtss_f32(_mm_invsqrt_ps(_mm_set_ss(real32)));	//SVML, only MSVC has it
+#else
+	return _mm_cvtss_f32(_mm_div_ss(_mm_set_ss(1.0f), _mm_sqrt_ss(_mm_set_ss(real32))));
+#endif
+}
+
 //----<Vec2>-----
 FORCEDINLINE f32 mag2(vec2f vector)
 {
@@ -387,7 +415,7 @@ FORCEDINLINE f32 mag(vec3f vector)
 FORCEDINLINE void normalize(vec3f& v)
 {
 	f32 inv_sqr_root = mag2(v);
-	inv_sqr_root = _mm_cvtss_f32(_mm_invsqrt_ps(_mm_set_ss(inv_sqr_root)));
+	inv_sqr_root = inv_sqroot(inv_sqr_root);
 	v = v * inv_sqr_root;
 }
 //----</Vec3>----
@@ -406,7 +434,7 @@ FORCEDINLINE f32 mag(vec4f vector)
 FORCEDINLINE void normalize(vec4f& v)
 {
 	f32 inv_sqr_root = mag2(v);
-	inv_sqr_root = _mm_cvtss_f32(_mm_invsqrt_ps(_mm_set_ss(inv_sqr_root)));
+	inv_sqr_root = inv_sqroot(inv_sqr_root);
 	v = v * inv_sqr_root;
 }
 //----</Vec4>----
@@ -447,6 +475,113 @@ FORCEDINLINE vec4f lerp(vec4f start, vec4f towards, f32 interpolation)
 	return { ((towards - start) * interpolation) + start };
 }
 
+//-----------------------
+// SIMD Math Types
+//----------------------
+//NOTE: for running the same math on 4 values at once (kd-tree leaves test packets of 4 triangles). vec3f math is still scalar.
+
+//----<f32_4x>-----
+//4 f32 lanes in an SSE register. Comparisons return masks (all bits set where true) for select() and get_mask_bits().
+struct f32_4x
+{
+	union
+	{
+		__m128 m;
+		f32 raw[4];
+	};
+
+	FORCEDINLINE f32& operator [] (int32 i) { return raw[i]; };
+
+	FORCEDINLINE f32_4x operator + (f32_4x n) { return { _mm_add_ps(m, n.m) }; };
+	FORCEDINLINE void operator += (f32_4x n) { m = _mm_add_ps(m, n.m); };
+	FORCEDINLINE f32_4x operator - () { return { _mm_sub_ps(_mm_setzero_ps(), m) }; };
+	FORCEDINLINE f32_4x operator - (f32_4x n) { return { _mm_sub_ps(m, n.m) }; };
+	FORCEDINLINE void operator -= (f32_4x n) { m = _mm_sub_ps(m, n.m); };
+	FORCEDINLINE f32_4x operator * (f32_4x n) { return { _mm_mul_ps(m, n.m) }; };
+	FORCEDINLINE void operator *= (f32_4x n) { m = _mm_mul_ps(m, n.m); };
+	FORCEDINLINE f32_4x operator / (f32_4x n) { return { _mm_div_ps(m, n.m) }; };
+
+	FORCEDINLINE f32_4x operator < (f32_4x n) { return { _mm_cmplt_ps(m, n.m) }; };
+	FORCEDINLINE f32_4x operator <= (f32_4x n) { return { _mm_cmple_ps(m, n.m) }; };
+	FORCEDINLINE f32_4x operator > (f32_4x n) { return { _mm_cmpgt_ps(m, n.m) }; };
+	FORCEDINLINE f32_4x operator >= (f32_4x n) { return { _mm_cmpge_ps(m, n.m) }; };
+	FORCEDINLINE f32_4x operator == (f32_4x n) { return { _mm_cmpeq_ps(m, n.m) }; };
+	FORCEDINLINE f32_4x operator != (f32_4x n) { return { _mm_cmpneq_ps(m, n.m) }; };
+	FORCEDINLINE f32_4x operator & (f32_4x n) { return { _mm_and_ps(m, n.m) }; };
+	FORCEDINLINE f32_4x operator | (f32_4x n) { return { _mm_or_ps(m, n.m) }; };
+};
+
+FORCEDINLINE f32_4x set_f32_4x(f32 value) { return { _mm_set1_ps(value) }; }
+
+FORCEDINLINE f32_4x min(f32_4x a, f32_4x b) { return { _mm_min_ps(a.m, b.m) }; }
+FORCEDINLINE f32_4x max(f32_4x a, f32_4x b) { return { _mm_max_ps(a.m, b.m) }; }
+FORCEDINLINE f32_4x sqroot(f32_4x a) { return { _mm_sqrt_ps(a.m) }; }
+
+//a where mask is set, b where it isn't
+FORCEDINLINE f32_4x select(f32_4x mask, f32_4x a, f32_4x b) { return { _mm_or_ps(_mm_and_ps(mask.m, a.m), _mm_andnot_ps(mask.m, b.m)) }; }
+
+//a & !b
+FORCEDINLINE f32_4x and_not(f32_4x a, f32_4x b) { return { _mm_andnot_ps(b.m, a.m) }; }
+
+//bit i is set if lane i of mask is set
+FORCEDINLINE uint32 get_mask_bits(f32_4x mask) { return (uint32)_mm_movemask_ps(mask.m); }
+//----</f32_4x>----
+
+//----<Vec3_SoA>-----
+//"Vector of vec3": lane i of x, y and z is the i-th vec3f. For running the same math on 4 vectors at once.
+template <typename lane>
+struct Vec3_SoA
+{
+	lane x, y, z;
+
+	FORCEDINLINE Vec3_SoA<lane> operator + (Vec3_SoA<lane> n) { Vec3_SoA<lane> ans = { x + n.x, y + n.y, z + n.z }; return ans; };
+	FORCEDINLINE void operator += (Vec3_SoA<lane> n) { x += n.x; y += n.y; z += n.z; };
+
+	FORCEDINLINE Vec3_SoA<lane> operator - () { Vec3_SoA<lane> ans = { -x, -y, -z }; return ans; };
+
+	FORCEDINLINE Vec3_SoA<lane> operator - (Vec3_SoA<lane> n) { Vec3_SoA<lane> ans = { x - n.x, y - n.y, z - n.z }; return ans; };
+	FORCEDINLINE void operator -= (Vec3_SoA<lane> n) { x -= n.x; y -= n.y; z -= n.z; };
+
+	FORCEDINLINE Vec3_SoA<lane> operator * (lane n) { Vec3_SoA<lane> ans = { x * n, y * n, z * n }; return ans; };
+	FORCEDINLINE void operator *= (lane n) { x *= n; y *= n; z *= n; };
+};
+typedef Vec3_SoA<f32_4x> vec3f_4x;
+
+//every lane set to v
+FORCEDINLINE vec3f_4x set_vec3f_4x(vec3f v) { vec3f_4x ans = { set_f32_4x(v.x), set_f32_4x(v.y), set_f32_4x(v.z) }; return ans; }
+
+template <typename lane>
+FORCEDINLINE void set_lane(Vec3_SoA<lane>& soa, int32 i, vec3f v) { soa.x[i] = v.x; soa.y[i] = v.y; soa.z[i] = v.z; }
+
+template <typename lane>
+FORCEDINLINE vec3f get_lane(Vec3_SoA<lane>& soa, int32 i) { vec3f ans = { soa.x[i], soa.y[i], soa.z[i] }; return ans; }
+
+template <typename lane>
+FORCEDINLINE lane dot(Vec3_SoA<lane> p, Vec3_SoA<lane> n) { return (p.x * n.x) + (p.y * n.y) + (p.z * n.z); }
+
+template <typename lane>
+FORCEDINLINE Vec3_SoA<lane> hadamard(Vec3_SoA<lane> a, Vec3_SoA<lane> b) { Vec3_SoA<lane> ans = { a.x * b.x, a.y * b.y, a.z * b.z }; return ans; }
+
+template <typename lane>
+FORCEDINLINE Vec3_SoA<lane> cross(Vec3_SoA<lane> a, Vec3_SoA<lane> b)
+{
+	Vec3_SoA<lane> ans = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	return ans;
+}
+
+template <typename lane>
+FORCEDINLINE lane mag2(Vec3_SoA<lane> vector) { return dot(vector, vector); }
+
+template <typename lane>
+FORCEDINLINE void normalize(Vec3_SoA<lane>& v)
+{
+	lane length = sqroot(mag2(v));
+	v.x = v.x / length;
+	v.y = v.y / length;
+	v.z = v.z / length;
+}
+//----</Vec3_SoA>----
+
 //proper conversion of linear to srgb color space
 inline f32 linear_to_srgb(f32 l)
 {
@@ -476,6 +611,12 @@ FORCEDINLINE vec3f linear_to_srgb(vec3f l)
 	return srgb;
 }
 
+//Rec.709 luminance of a linear rgb color
+FORCEDINLINE f32 luminance(vec3f color)
+{
+	return color.x * 0.2126f + color.y * 0.7152f + color.z * 0.0722f;
+}
+
 FORCEDINLINE vec3f rgb_gamma_correct(vec3f color)
 {
 	vec3f gamma_correct;
@@ -542,6 +683,10 @@ FORCEDINLINE f32 rand_bi(RNG_Stream* stream)
 //---------------------------------------------------------------------------
 
 //---------------------------<ATOMICS>---------------------------------------
+#ifdef PL_COMPILER_MSVC
+//keeps the compiler from moving memory accesses across it (no fence instruction)
+#define COMPILER_BARRIER() _ReadWriteBarrier()
+
 #ifdef PL_X64
 #pragma intrinsic(_InterlockedExchangeAdd64)
 //NOTE: Doesn't work on x86 
@@ -613,4 +758,88 @@ FORCEDINLINE int32 interlocked_exchange_i32(volatile int32* data, int32 value)
 	return _InterlockedExchange((volatile long*)data, value);
 }
 
+#ifdef PL_X64
+#pragma intrinsic(_InterlockedCompareExchange64)
+//NOTE: Doesn't work on x86 
+//sets data to value only if data is equal to comparand. Returns the previous value (exchange happened if it equals comparand)
+FORCEDINLINE int64 interlocked_compare_exchange_i64(volatile int64* data, int64 value, int64 comparand)
+{
+	return _InterlockedCompareExchange64((volatile long long*)data, value, comparand);
+}
+#endif
+
+#pragma intrinsic(_InterlockedCompareExchange)
+//sets data to value only if data is equal to comparand. Returns the previous value (exchange happened if it equals comparand)
+FORCEDINLINE int32 interlocked_compare_exchange_i32(volatile int32* data, int32 value, int32 comparand)
+{
+	return _InterlockedCompareExchange((volatile long*)data, value, comparand);
+}
+
+#else
+//GCC/Clang builtins. Full barriers like the _Interlocked intrinsics, so both behave the same.
+#define COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+//performs atomic add and returns result(for int64 value)
+FORCEDINLINE int64 interlocked_add_i64(volatile int64* data, int64 value)
+{
+	return __atomic_add_fetch(data, value, __ATOMIC_SEQ_CST);
+}
+
+//performs atomic add and returns result(for int32 value)
+FORCEDINLINE int32 interlocked_add_i32(volatile int32* data, int32 value)
+{
+	return __atomic_add_fetch(data, value, __ATOMIC_SEQ_CST);
+}
+
+//returns resulting incremented value after performing locked increment(for int64 value)
+FORCEDINLINE int64 interlocked_increment_i64(volatile int64* data)
+{
+	return __atomic_add_fetch(data, 1, __ATOMIC_SEQ_CST);
+}
+
+//returns resulting incremented value after performing locked increment(for int32 value)
+FORCEDINLINE int64 interlocked_increment_i32(volatile int32* data)
+{
+	return __atomic_add_fetch(data, 1, __ATOMIC_SEQ_CST);
+}
+
+//returns resulting decremented value after performing locked decrement(for int64 value)
+FORCEDINLINE int64 interlocked_decrement_i64(volatile int64* data)
+{
+	return __atomic_sub_fetch(data, 1, __ATOMIC_SEQ_CST);
+}
+
+//returns resulting decremented value after performing locked decrement(for int32 value)
+FORCEDINLINE int64 interlocked_decrement_i32(volatile int32* data)
+{
+	return __atomic_sub_fetch(data, 1, __ATOMIC_SEQ_CST);
+}
+
+//returns previous value after exchanging with new value
+FORCEDINLINE int64 interlocked_exchange_i64(volatile int64* data, int64 value)
+{
+	return __atomic_exchange_n(data, value, __ATOMIC_SEQ_CST);
+}
+
+//returns previous value after exchanging with new value
+FORCEDINLINE int32 interlocked_exchange_i32(volatile int32* data, int32 value)
+{
+	return __atomic_exchange_n(data, value, __ATOMIC_SEQ_CST);
+}
+
+//sets data to value only if data is equal to comparand. Returns the previous value (exchange happened if it equals comparand)
+FORCEDINLINE int64 interlocked_compare_exchange_i64(volatile int64* data, int64 value, int64 comparand)
+{
+	__atomic_compare_exchange_n(data, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;	//set to the previous value if the exchange failed
+}
+
+//sets data to value only if data is equal to comparand. Returns the previous value (exchange happened if it equals comparand)
+FORCEDINLINE int32 interlocked_compare_exchange_i32(volatile int32* data, int32 value, int32 comparand)
+{
+	__atomic_compare_exchange_n(data, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+#endif
+
 //---------------------------</ATOMICS>--------------------------------------
@@ -22,7 +22,7 @@ void pl_close_thread(const ThreadHandle* handle)
 
 b32 pl_wait_for_thread(const ThreadHandle* handle, uint32 timeout_in_ms)
 {
-	return WaitForSingleObject((HANDLE*)handle, timeout_in_ms);
+	return WaitForSingleObject(handle->thread_handle, timeout_in_ms);
 }
 
 b32 pl_wait_for_all_threads(uint32 no_of_threads, const ThreadHandle* handles, uint32 timeout_in_ms)
@@ -115,6 +115,122 @@ void pl_sleep_thread(uint32 timeout_in_ms)
 	Sleep((DWORD)timeout_in_ms);
 }
 
+SemaphoreHandle pl_create_semaphore(int32 initial_count, int32 max_count)
+{
+	SemaphoreHandle handle;
+	handle.semaphore_handle = CreateSemaphoreA(0, initial_count, max_count, 0);
+	return handle;
+}
+
+void pl_signal_semaphore(const SemaphoreHandle* handle, int32 count)
+{
+	ReleaseSemaphore(handle->semaphore_handle, count, 0);
+}
+
+b32 pl_wait_for_semaphore(const SemaphoreHandle* handle, uint32 timeout_in_ms)
+{
+	return WaitForSingleObject(handle->semaphore_handle, timeout_in_ms) == WAIT_TIMEOUT;
+}
+
+void pl_close_semaphore(const SemaphoreHandle* handle)
+{
+	CloseHandle(handle->semaphore_handle);
+}
+
+
+b32 pl_create_process(ProcessHandle* handle, char* command_line)
+{
+	//only the child's ends of the pipes are inherited
+	SECURITY_ATTRIBUTES inherit = { sizeof(SECURITY_ATTRIBUTES), 0, TRUE };
+	HANDLE child_input, parent_input, parent_output, child_output;
+	if (!CreatePipe(&child_input, &parent_input, &inherit, 0))
+	{
+		return FALSE;
+	}
+	if (!CreatePipe(&parent_output, &child_output, &inherit, 0))
+	{
+		CloseHandle(child_input);
+		CloseHandle(parent_input);
+		return FALSE;
+	}
+	SetHandleInformation(parent_input, HANDLE_FLAG_INHERIT, 0);
+	SetHandleInformation(parent_output, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOA startup_info = {};
+	startup_info.cb = sizeof(startup_info);
+	startup_info.dwFlags = STARTF_USESTDHANDLES;
+	startup_info.hStdInput = child_input;
+	startup_info.hStdOutput = child_output;
+	startup_info.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+	PROCESS_INFORMATION process_info = {};
+	b32 created = CreateProcessA(0, command_line, 0, 0, TRUE, CREATE_NO_WINDOW, 0, 0, &startup_info, &process_info);
+
+	CloseHandle(child_input);
+	CloseHandle(child_output);
+	if (!created)
+	{
+		CloseHandle(parent_input);
+		CloseHandle(parent_output);
+		return FALSE;
+	}
+	CloseHandle(process_info.hThread);
+	handle->process_handle = process_info.hProcess;
+	handle->input_pipe = parent_input;
+	handle->output_pipe = parent_output;
+	return TRUE;
+}
+
+void pl_close_process(ProcessHandle* handle)
+{
+	CloseHandle(handle->input_pipe);
+	CloseHandle(handle->output_pipe);
+	TerminateProcess(handle->process_handle, 1);
+	WaitForSingleObject(handle->process_handle, INFINITE);
+	CloseHandle(handle->process_handle);
+	*handle = {};
+}
+
+void* pl_get_standard_input()
+{
+	return GetStdHandle(STD_INPUT_HANDLE);
+}
+
+void* pl_get_standard_output()
+{
+	return GetStdHandle(STD_OUTPUT_HANDLE);
+}
+
+b32 pl_read_from_pipe(void* pipe, void* block_to_store_into, uint32 no_bytes)
+{
+	uint8* dst = (uint8*)block_to_store_into;
+	while (no_bytes > 0)
+	{
+		DWORD read_bytes;
+		if (!ReadFile(pipe, dst, no_bytes, &read_bytes, 0) || read_bytes == 0)
+		{
+			return FALSE;
+		}
+		dst += read_bytes;
+		no_bytes -= read_bytes;
+	}
+	return TRUE;
+}
+
+b32 pl_write_to_pipe(void* pipe, void* block_to_write, uint32 no_bytes)
+{
+	uint8* src = (uint8*)block_to_write;
+	while (no_bytes > 0)
+	{
+		DWORD written;
+		if (!WriteFile(pipe, src, no_bytes, &written, 0) || written == 0)
+		{
+			return FALSE;
+		}
+		src += written;
+		no_bytes -= written;
+	}
+	return TRUE;
+}
 
 b32 pl_load_file_into(void* handle, void* block_to_store_into, uint32 file_size)
 {
@@ -157,6 +273,12 @@ b32 pl_create_file(void** file_handle, char* path)
 	}
 }
 
+b32 pl_create_or_overwrite_file(void** file_handle, char* path)
+{
+	*file_handle = CreateFileA(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	return *file_handle != INVALID_HANDLE_VALUE;
+}
+
 b32 pl_append_to_file(void* file_handle, void* block_to_store, int32 bytes_to_append)
 {
 	LARGE_INTEGER offset;
@@ -181,6 +303,11 @@ b32 pl_close_file_handle(void* file_handle)
 	return CloseHandle(file_handle);
 }
 
+b32 pl_replace_file(char* from, char* to)
+{
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+}
+
 uint64 pl_get_file_size(void* handle)
 {
 	LARGE_INTEGER file_size;
@@ -230,6 +357,33 @@ void pl_debug_print(const char* format, ...)
 	OutputDebugStringA(buffer);
 }
 
+void pl_print(const char* format, ...)
+{
+	static char buffer[1024];
+	va_list arg_list;
+	va_start(arg_list, format);
+	int32 length = vsprintf_s(buffer, sizeof(buffer), format, arg_list);
+	va_end(arg_list);
+	//NOTE: a windows subsystem app only has a stdout if it was redirected. Otherwise, print to the console it was started from (if any).
+	HANDLE std_out = GetStdHandle(STD_OUTPUT_HANDLE);
+	static b32 attached_console = FALSE;
+	if ((std_out == 0 || std_out == INVALID_HANDLE_VALUE) && !attached_console)
+	{
+		attached_console = TRUE;
+		if (AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			std_out = CreateFileA("CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE, 0, OPEN_EXISTING, 0, 0);
+			SetStdHandle(STD_OUTPUT_HANDLE, std_out);
+		}
+	}
+	if (std_out != 0 && std_out != INVALID_HANDLE_VALUE && length > 0)
+	{
+		DWORD written;
+		WriteFile(std_out, buffer, (DWORD)length, &written, 0);
+	}
+	OutputDebugStringA(buffer);
+}
+
 void pl_format_print(char* buffer, uint32 buffer_size, const char* format, ...)
 {
 	va_list arg_list;
@@ -5,6 +5,7 @@
 #include <mmdeviceapi.h>
 #include <audioclient.h>
 #include <windowsx.h>
+#include <shellapi.h>
 
 struct Win32Specific
 {
@@ -1070,7 +1071,25 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance,
 	GetSystemInfo(&sys_info);
 	pl.core_count = sys_info.dwNumberOfProcessors;
 
+	//NOTE: lpCmdLine doesn't have the executable and isn't split, so the command line is parsed again here.
+	LPWSTR* wide_argv = CommandLineToArgvW(GetCommandLineW(), &pl.argc);
+	pl.argv = (char**)pl_buffer_alloc((pl.argc + 1) * sizeof(char*));
+	for (int32 i = 0; i < pl.argc; i++)
+	{
+		int32 size = WideCharToMultiByte(CP_UTF8, 0, wide_argv[i], -1, 0, 0, 0, 0);
+		pl.argv[i] = (char*)pl_buffer_alloc(size);
+		WideCharToMultiByte(CP_UTF8, 0, wide_argv[i], -1, pl.argv[i], size, 0, 0);
+	}
+	LocalFree(wide_argv);
+
 	PL_entry_point(pl);
+
+	for (int32 i = 0; i < pl.argc; i++)
+	{
+		pl_buffer_free(pl.argv[i]);
+	}
+	pl_buffer_free(pl.argv);
+	return pl.exit_code;
 }
 //--------------------------------</Win32 ENTRY POINT>------------------------------------------
 
@@ -1,7 +1,7 @@
 #pragma once
 
 //-----------------------------------------------
-#include "pl_base_defs.h"
+#include "PL_base_defs.h"
 struct PL;
 typedef void(*PL_Function)(PL& pl);	//used for functions that are different for different modes. Ex: PL_push_window() is different for opengl and for bit-blitting using a bitmap. 
 
@@ -245,6 +245,9 @@ struct PL
 	uint32 core_count;
 	b32 initialized;
 	b32 running;
+	int32 argc;			//command line arguments. argv[0] is the executable, argv[argc] is 0.
+	char** argv;		//UTF-8
+	int32 exit_code;	//returned by the process once PL_entry_point returns
 	PL_Input input;
 	PL_Timing time;
 	PL_Audio audio;
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "pl_base_defs.h"
+#include "PL_base_defs.h"
 
 //-------------------------------------------<MEMORY ALLOCATION>-------------------------------------------
 void pl_buffer_set(void* buffer, int32 value_to_set, size_t no_bytes_to_set);
@@ -175,9 +175,52 @@ void pl_sleep_thread(uint32 timeout_in_ms);
 //gets unique thread id
 uint32 pl_get_thread_id();
 
+//Data for a handle to a semaphore
+struct SemaphoreHandle
+{
+	void* semaphore_handle;
+};
+
+SemaphoreHandle pl_create_semaphore(int32 initial_count, int32 max_count);
+
+//increases semaphore count by "count", releasing that many waiting threads
+void pl_signal_semaphore(const SemaphoreHandle* handle, int32 count);
+
+//Waits for semaphore count to be non zero (and decrements it) or timeout. Returns TRUE if wait is timed out, and FALSE if semaphore was taken
+b32 pl_wait_for_semaphore(const SemaphoreHandle* handle, uint32 timeout_in_ms);
+
+void pl_close_semaphore(const SemaphoreHandle* handle);
+
 
 //------------------------------------------</THREADING>--------------------------------------------
 
+//------------------------------------------<PROCESSES>--------------------------------------------
+//Data for a handle to a child process, and the pipes connected to its standard input and output
+struct ProcessHandle
+{
+	void* process_handle;
+	void* input_pipe;	//written to by the parent, read by the process as its standard input
+	void* output_pipe;	//read by the parent, written by the process as its standard output
+};
+
+//Starts command_line (program path followed by its arguments, paths with spaces in double quotes) as a child process.
+//Its standard error is the same as the parent's. Returns FALSE if the process couldn't be started.
+b32 pl_create_process(ProcessHandle* handle, char* command_line);
+
+//Kills the process if it's still running, waits for it to exit and closes its pipes
+void pl_close_process(ProcessHandle* handle);
+
+//Pipes of the current process's own standard input and output (for talking to the parent process)
+void* pl_get_standard_input();
+void* pl_get_standard_output();
+
+//Blocks till all bytes are read. Returns FALSE if the other end of the pipe is closed (ex: process exited) before that.
+b32 pl_read_from_pipe(void* pipe, void* block_to_store_into, uint32 no_bytes);
+
+//Blocks till all bytes are written. Returns FALSE if the other end of the pipe is closed.
+b32 pl_write_to_pipe(void* pipe, void* block_to_write, uint32 no_bytes);
+//------------------------------------------</PROCESSES>--------------------------------------------
+
 //------------------------------------------</RANDOM>-----------------------------------------------
 //gets a random uint64 number from system 
 //NOTE: this entropy may be biased based on how it is implemented
@@ -197,11 +240,18 @@ b32 pl_load_file_into(void* handle, void* block_to_store_into, uint32 file_size)
 //returns true if successfully created and loads file_handle. false if file already exists.
 b32 pl_create_file(void** file_handle, char* path);
 
+//same as pl_create_file, but truncates the file if it already exists. Returns false if the file couldn't be opened.
+b32 pl_create_or_overwrite_file(void** file_handle, char* path);
+
 //appends to file. returns true if successful.
 b32 pl_append_to_file(void* file_handle, void* block_to_store, int32 bytes_to_append);
 
 b32 pl_close_file_handle(void* file_handle);
 
+//moves the file at from to path to, replacing the file there if there is one. Returns true if successful.
+//NOTE: atomic on the same volume, so writing to a temporary file and replacing never leaves a half written file at to.
+b32 pl_replace_file(char* from, char* to);
+
 //returns file size in bytes
 uint64 pl_get_file_size(void* handle);
 
@@ -218,5 +268,7 @@ void pl_throw_error_box(const char* error);
 
 #include <cstdarg>
 void pl_debug_print(const char* format, ...);
+//prints to the standard output of the process (console or whatever it was redirected to). pl_debug_print only goes to the debugger.
+void pl_print(const char* format, ...);
 void pl_format_print(char* buffer, uint32 buffer_size, const char* format, ...);
 //--------------------------------------</DEBUG>---------------------------------------
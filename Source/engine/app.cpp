@@ -1,17 +1,34 @@
 #include "PL/pl.h"
 #include "engine/tools/texture.h"
 #include "renderer/renderer.h"
+#include "renderer/denoiser.h"
 #include "utilities/ATP/atp.h"
 #include "engine/tools/OBJ_loader.h"
+#include "scene_setup.h"
+#include "batch_render.h"
 
 ATP_REGISTER(load_assets);
 ATP_REGISTER(prep_scene);
 ATP_REGISTER(render_from_camera);
-void print_out_tests(PL_Timing& pl);
-void render_app(PL& pl, Texture& texture, ThreadPool& tpool);
+ATP_REGISTER(denoise);
+static void print_out_tests(PL_Timing& pl);
+static void render_app(PL& pl, Texture& texture, JobSystem& job_system);
 
 void PL_entry_point(PL& pl)
 {
+	//no window for batch renders
+	if (is_batch_render(pl.argc, pl.argv))
+	{
+		BatchRenderOptions options;
+		if (!parse_batch_render_options(pl.argc, pl.argv, options))
+		{
+			pl.exit_code = 1;
+			return;
+		}
+		pl.exit_code = run_batch_render(pl, options);
+		return;
+	}
+
 	pl.running = TRUE;
 	pl.core_count = 8;
 	Texture texture;
@@ -23,32 +40,31 @@ void PL_entry_point(PL& pl)
 	pl.window.title = (char*)"Starting Rendering...";
 	pl.window.window_bitmap.buffer = texture.bmb.buffer_memory;
 
-	ThreadPool thread_pool;
-	//thread_pool.threads.allocate(1);	//For single thread
-	thread_pool.threads.allocate(pl.core_count);
+	JobSystem job_system;
+	//start_job_system(job_system, 1);	//For single thread
+	start_job_system(job_system, pl.core_count);
 
 	PL_initialize_input_keyboard(pl.input.kb);
 	PL_initialize_input_mouse(pl.input.mouse);
 	PL_initialize_window(pl.window);
 	PL_initialize_timing(pl.time);
-	render_app(pl,texture, thread_pool);
+	if (pl.running)	//FALSE if the platform has no window (headless)
+	{
+		render_app(pl, texture, job_system);
+	}
 
 	pl_buffer_free(texture.bmb.buffer_memory);
 	
-	//NOTE: by now, none of the threads should be running anything. 
-	for (int i = 0; i < thread_pool.threads.size; i++)
-	{
-		pl_close_thread(&thread_pool.threads[i].handle);
-	}
-	thread_pool.threads.clear();
+	//NOTE: by now, none of the workers should be running anything. 
+	stop_job_system(job_system);
 }
 
-static int32 find_tile_index_covering_point(vec2i point, WorkQueue<RenderTile>& twq)
+static int32 find_tile_index_covering_point(vec2i point, FDBuffer<RenderTile>& tiles)
 {
-	for (uint32 i = 0; i < (uint32)twq.jobs.size; i++)
+	for (uint32 i = 0; i < (uint32)tiles.size; i++)
 	{
-		if (twq.jobs[i].tile.left_bottom.x <= point.x && twq.jobs[i].tile.left_bottom.y <= point.y &&
-			twq.jobs[i].tile.right_top.x >= point.x && twq.jobs[i].tile.right_top.y >= point.y)
+		if (tiles[i].tile.left_bottom.x <= point.x && tiles[i].tile.left_bottom.y <= point.y &&
+			tiles[i].tile.right_top.x >= point.x && tiles[i].tile.right_top.y >= point.y)
 		{
 			return (int32)i;
 		}
@@ -56,177 +72,276 @@ static int32 find_tile_index_covering_point(vec2i point, WorkQueue<RenderTile>&
 	return -1;
 }
 
-static void render_app(PL& pl,Texture& texture, ThreadPool& tpool)
-{
+#define CAMERA_MOVE_SPEED 2.0f	//units per second
+#define CAMERA_TURN_SPEED 1.0f	//radians per second
 
-	ATP_START(load_assets);
+//W/S, A/D and R/F move the camera forward/back, left/right and up/down. J/L turn it left/right and I/K up/down.
+//Not while Shift is down (Shift+key are the other commands). Returns TRUE if the camera moved.
+static b32 move_app_camera(PL& pl, vec3f& position, vec3f& direction)
+{
+	if (pl.input.keys[PL_KEY::SHIFT].down)
+	{
+		return FALSE;
+	}
+	PL_Digital_Button* keys = pl.input.keys;
+	f32 dt = min(pl.time.fdelta_seconds, 0.1f);	//a long frame (ex: denoising) shouldn't jump the camera
+	f32 forward = (f32)((keys[PL_KEY::W].down ? 1 : 0) - (keys[PL_KEY::S].down ? 1 : 0));
+	f32 right = (f32)((keys[PL_KEY::D].down ? 1 : 0) - (keys[PL_KEY::A].down ? 1 : 0));
+	f32 up = (f32)((keys[PL_KEY::R].down ? 1 : 0) - (keys[PL_KEY::F].down ? 1 : 0));
+	f32 yaw = (f32)((keys[PL_KEY::J].down ? 1 : 0) - (keys[PL_KEY::L].down ? 1 : 0)) * CAMERA_TURN_SPEED * dt;
+	f32 pitch = (f32)((keys[PL_KEY::I].down ? 1 : 0) - (keys[PL_KEY::K].down ? 1 : 0)) * CAMERA_TURN_SPEED * dt;
+	if (forward == 0.0f && right == 0.0f && up == 0.0f && yaw == 0.0f && pitch == 0.0f)
+	{
+		return FALSE;
+	}
 
-	pl_debug_print("\nLoading Assets...\n");
-	Model model = {};
-	load_model_data(model.data, "Assets\\dragon.obj", tpool);
-	model.surrounding_aabb = get_AABB(model.data);
-	//resize_scale(model, 3);
-	vec3f center = (model.surrounding_aabb.max - model.surrounding_aabb.min) / 2 + model.surrounding_aabb.min;
+	vec3f world_up = { 0.0f, 1.0f, 0.0f };
+	vec3f right_axis = cross(direction, world_up);
+	normalize(right_axis);
+	position += (direction * forward + right_axis * right + world_up * up) * (CAMERA_MOVE_SPEED * dt);
+
+	//yaw around the world up axis, pitch towards the camera's up (stopping short of straight up/down)
+	vec3f turned = { direction.x * fcos(yaw) + direction.z * fsin(yaw), direction.y, -direction.x * fsin(yaw) + direction.z * fcos(yaw) };
+	right_axis = cross(turned, world_up);
+	normalize(right_axis);
+	vec3f camera_up = cross(right_axis, turned);
+	normalize(camera_up);
+	vec3f pitched = turned * fcos(pitch) + camera_up * fsin(pitch);
+	normalize(pitched);
+	direction = pitched.y > 0.98f || pitched.y < -0.98f ? turned : pitched;
+	normalize(direction);
+	return TRUE;
+}
 
+static void render_app(PL& pl,Texture& texture, JobSystem& job_system)
+{
 
+	ATP_START(load_assets);
 
-	translate_to(model, { 0.f,-15.f,-38.f });
+	pl_debug_print("\nLoading Assets...\n");
+	Scene scene;
+	if (!setup_app_scene(scene, DEFAULT_SCENE_PATH, job_system))
+	{
+		pl_debug_print("Couldn't open scene: %s\n", DEFAULT_SCENE_PATH);
+		return;
+	}
 	ATP_END(load_assets);
 
-	model.kd_tree.division_method = KD_Division_Method::SAH;
-	model.kd_tree.max_no_faces_per_node = 300;//(uint32)((200.f/(1570.f * 8)) * (f32)model.data.faces_vertices.size);	//use "bucket size" or density value factor to calculate this.
-
 	Camera cm;
 	RenderSettings rs;
-	rs.anti_aliasing = FALSE;
-	rs.resolution.x = texture.bmb.width;
-	rs.resolution.y = texture.bmb.height;
-	rs.samples_per_pixel = 5;
-	rs.bounce_limit = 5;
+	set_default_render_settings(rs, texture.bmb.width, texture.bmb.height);
 
-
-	set_camera(cm, { 0.1f,2.f,0.f }, { -.1f, -0.5f,-1.f }, rs, 1.0f);
-
-	Scene scene;
-	Material skybox = { {0.3f,0.4f,0.5f}, {0.2f,0.3f,0.4f},0.3f };
-	Material sphere_1 = { {0.f,0.0f,0.0f }, {0.2f,0.8f,0.2f },0.3f };
-	Material sphere_2 = { {0.0f,0.0f,0.0f }, {0.4f,0.8f,0.9f },0.9f };
-	Material plane_2 = { { 0.0f, 0.4f,0.6f } , { 0.2f, 0.3f,0.2f },0.f };
-	Material ground_plane = { {0.f, 0.f,0.0f } , {0.5f, 0.5f,0.5f },0.f };
-	Material model_mat = { {0.4f,0.2f,0.2f}, {0.92f,0.5f,0.0f},0.3f };
-	Material mat_model_aabb = { {0.8f,0.2f,0.2f}, {0.92f,0.0f,0.0f},0.3f };
-
-	scene.materials.add(skybox);	//The first material is the skybox
-	scene.materials.add(sphere_1);
-	scene.materials.add(sphere_2);
-	scene.materials.add(plane_2);
-	scene.materials.add(ground_plane);
-	scene.materials.add(model_mat);
-	scene.materials.add(mat_model_aabb);
-
-	//NOTE: this stuff is ad-hoc right now and should be properly implemented. 
-	//Should Objects contain a pointer to a material or should they have an "index" instead...
-	//Depends on how materials are loaded and what order they are stored in. Objects need to know which material
-	// they point to in the Material buffer in scene.
-	Sphere spr[2];
-	Plane pln[2];
-
-	spr[0].center = { -1.f,1.0f,-7.f };
-	spr[0].radius = 1.0f;
-	spr[0].material = &scene.materials[1];
-
-	spr[1].center = { 1.f,1.f,-7.f };	
-	spr[1].radius = 1.f;    
-	spr[1].material = &scene.materials[2];
-
-	pln[0].distance = -7.f;
-	pln[0].normal = { 1.f,0.f,0.f };
-	pln[0].material = &scene.materials[3];
-
-	//ground plane
-	pln[1].distance = 0.f;
-	pln[1].normal = { 0.f,1.f,0.f };
-	pln[1].material = &scene.materials[4];
-
-	model.data.material = &scene.materials[5];
-
-	AABB tmp = {};
-	tmp.min = { -0.5f,-0.5f,-3.5f };
-	tmp.max = { 0.5f,4.5f,-2.5f };
-
-	
-	scene.models.add_nocpy(model);
-	//scene.planes.add(pln[0]);
-	//scene.planes.add(pln[1]);
-	//scene.spheres.add(spr[0]);
-	//scene.spheres.add(spr[1]);
+	set_camera(cm, DEFAULT_CAMERA_POSITION, DEFAULT_CAMERA_DIRECTION, rs, DEFAULT_CAMERA_FOV);
 
 	uint32 kd_tree_max_nodes;
 	ATP_START(prep_scene);
-	prep_scene(scene, kd_tree_max_nodes);
+	prep_scene(scene, rs.accelerator, kd_tree_max_nodes, job_system);
 	ATP_END(prep_scene);
 
 	pl_debug_print("\nResolution [%i,%i] || Samples per pixel - %i - Starting Render...\n",texture.bmb.width, texture.bmb.height, rs.samples_per_pixel);
 	
-	RenderInfo info;
+	RenderInfo info = {};
 	info.camera_tex = &texture;
+	//NOTE: two films, so when the camera moves the new one can take the samples of the old one that are still valid
+	Film films[2];
+	setup_film(films[0], texture.bmb.width, texture.bmb.height, AOV_ALL);
+	setup_film(films[1], texture.bmb.width, texture.bmb.height, AOV_ALL);
+	info.film = &films[0];
 	info.camera = &cm;
 	info.scene = &scene;
 	info.hit_stack_capacity = kd_tree_max_nodes;
 	info.leaf_stack_capacity = kd_tree_max_nodes;
+	vec3f camera_position = DEFAULT_CAMERA_POSITION;
+	vec3f camera_direction = DEFAULT_CAMERA_DIRECTION;
+	normalize(camera_direction);
 
 	ATP_START(render_from_camera);
-	start_render_from_camera(info, tpool);
-
-	int32 last_tile = 0;
-	while (wait_for_render_from_camera_to_finish(info, tpool, 33))	//checks if threadpool is finished every 33 milliseconds and exists when done.
+	start_render_from_camera(info, job_system);
+
+	b32 rendering = TRUE;
+	b32 first_render = TRUE;
+	int32 last_tile = -1;
+	int32 last_pass = -1;
+	uint32 pixels_kept = texture.bmb.width * texture.bmb.height;
+	//denoised image is shown once the render is done. Film keeps the noisy one.
+	DenoiseSettings ds;
+	b32 showing_denoised = FALSE;
+	int32 tile_on_mouse = -1;
+	ATP::TestType* Tiles_TestType = 0;
+	Tiles_TestType = ATP::lookup_testtype("Tiles");
+	while (pl.running)
 	{
 		PL_poll_window(pl.window);
-		if (pl.running != TRUE)
+		PL_poll_input_keyboard(pl.input.kb);
+		PL_poll_input_mouse(pl.input.mouse, pl.window);
+		PL_poll_timing(pl.time);
+		if (pl.input.keys[PL_KEY::ESCAPE].pressed)
 		{
-			//TODO:Maybe put warning message about how the process wont end until all threads finish the tile they're working on
-			info.twq.clear();
-			wait_for_pool(tpool, UINT32MAX);
-			free_scene_memory(scene);	//NOTE:cleared out on process end anyway. Maybe implement a "shutdown" which waits for all threads to finish then clears scene memory.
-			return;
-
+			pl.running = FALSE;
 		}
-		if (info.twq.jobs_done > last_tile)
+
+		//The camera moving restarts the render. Pixels that still see the same surface keep their samples (reprojected),
+		//so only the rest starts over from the first pass: the image stays sharp where it can and fills in the rest.
+		Camera previous_camera = cm;
+		if (move_app_camera(pl, camera_position, camera_direction))
 		{
-			char buffer[512];
-			pl_format_print(buffer, 512, "Rendering: Width:%i, Height:%i | Threads: %i | Tiles: %i/%i", pl.window.width, pl.window.height, tpool.threads.size, info.twq.jobs_done, info.twq.jobs.size);
-			pl.window.title = buffer;
-			PL_push_window(pl.window, TRUE);
-			last_tile = info.twq.jobs_done;
+			if (rendering)
+			{
+				cancel_render_from_camera(info);
+			}
+			Film* previous = info.film;
+			info.film = previous == &films[0] ? &films[1] : &films[0];
+			update_camera_pos(cm, camera_position, camera_direction);
+			pixels_kept = reproject_film(info, *previous, previous_camera, job_system);
+			start_render_of_tiles(info, job_system);
+			rendering = TRUE;
+			showing_denoised = FALSE;
+			last_tile = -1;
 		}
-		else
+		Film& film = *info.film;
+
+		if (rendering)
 		{
-			PL_push_window(pl.window, FALSE);
-		}
-	}
-	ATP_END(render_from_camera);
-	
+			//checks if render is finished every 33 milliseconds
+			if (wait_for_render_from_camera_to_finish(info, 33))
+			{
+				if (info.tiles_done != last_tile || info.current_pass != last_pass)
+				{
+					int32 tiles_done = info.tiles_done;
+					int32 pass = info.current_pass;
+					char buffer[512];
+					pl_format_print(buffer, 512, "Rendering: Width:%i, Height:%i | Threads: %i | Pass: %i/%i | Tiles: %i/%i | Reprojected: %.1f%%", pl.window.width, pl.window.height, job_system.workers.size,
+						pass + 1, info.no_passes, tiles_done, info.tiles.size, 100.0f * (f32)pixels_kept / (f32)(texture.bmb.width * texture.bmb.height));
+					pl.window.title = buffer;
+					PL_push_window(pl.window, TRUE);
+					last_tile = tiles_done;
+					last_pass = pass;
+				}
+				else
+				{
+					PL_push_window(pl.window, FALSE);
+				}
+				continue;
+			}
+			rendering = FALSE;
 
-	pl_debug_print("\nCompleted:\n");
-	
-	print_out_tests(pl.time);
-	
-	pl_debug_print("	Total Rays Shot: %I64i rays\n", info.total_ray_casts);
-	pl_debug_print("	Millisecond Per Ray: %.*f ms/ray\n", 8, ATP::get_ms_from_test(*ATP::lookup_testtype("render_from_camera")) / (f64)info.total_ray_casts);
+			ATP_START(denoise);
+			denoise_film(film, texture, ds, job_system);
+			ATP_END(denoise);
+			showing_denoised = TRUE;
+			pl.window.title = (char*)"Completed";
+			PL_push_window(pl.window, TRUE);
 
-	int32 tile_on_mouse = -1;
-	ATP::TestType* Tiles_TestType = 0;
-	Tiles_TestType = ATP::lookup_testtype("Tiles");
-	while (pl.running)
-	{
+			if (first_render)
+			{
+				ATP_END(render_from_camera);
+				first_render = FALSE;
+				pl_debug_print("\nCompleted:\n");
+
+				print_out_tests(pl.time);
+
+				pl_debug_print("	Tile Order: %s (%i tiles)\n", get_tile_order_name(rs.tile_order), info.tiles.size);
+				pl_debug_print("	Accelerator: %s\n", get_accelerator_name(rs.accelerator));
+				pl_debug_print("	Tone Mapping: %s | Exposure: %.2f\n", get_tone_map_operator_name(film.display.tone_map), film.display.exposure);
+				pl_debug_print("	Total Rays Shot: %lld rays\n", info.total_ray_casts);
+				pl_debug_print("	Millisecond Per Ray: %.*f ms/ray\n", 8, ATP::get_ms_from_test(*ATP::lookup_testtype("render_from_camera")) / (f64)info.total_ray_casts);
+				pl_debug_print("	W/A/S/D, R/F: move | J/L, I/K: turn\n");
+			}
+		}
 
-		PL_poll_window(pl.window);
-		PL_poll_input_keyboard(pl.input.kb);
-		PL_poll_input_mouse(pl.input.mouse, pl.window);
-		
 		if (pl.input.keys[PL_KEY::SHIFT].down && pl.input.keys[PL_KEY::S].pressed)
 		{
 			Write_To_File(texture, "Results\\resultings");
 			pl.window.title = (char*)"SAVED TO FILE!";
 			PL_push_window(pl.window, TRUE);
 		}
-		if (pl.input.keys[PL_KEY::ESCAPE].pressed)
+		if (pl.input.keys[PL_KEY::SHIFT].down && pl.input.keys[PL_KEY::C].pressed)
 		{
-			pl.running = FALSE;
+			Texture sample_count_map;
+			Setup_Texture(sample_count_map, TextureFileType::BMP, texture.bmb.width, texture.bmb.height);
+			resolve_film_sample_count_map(film, sample_count_map, get_max_samples_per_pixel(rs));
+			Write_To_File(sample_count_map, "Results\\sample_count");
+			pl_buffer_free(sample_count_map.bmb.buffer_memory);
+			pl.window.title = (char*)"SAVED SAMPLE COUNT MAP TO FILE!";
+			PL_push_window(pl.window, TRUE);
+		}
+		if (pl.input.keys[PL_KEY::SHIFT].down && pl.input.keys[PL_KEY::A].pressed)
+		{
+			Texture aov_texture;
+			Setup_Texture(aov_texture, TextureFileType::BMP, texture.bmb.width, texture.bmb.height);
+			for (uint32 aov = 1; aov & AOV_ALL; aov <<= 1)
+			{
+				char file_name[256];
+				pl_format_print(file_name, 256, "Results\\aov_%s", get_aov_name((AOV_Flags)aov));
+				resolve_film_aov(film, (AOV_Flags)aov, aov_texture);
+				Write_To_File(aov_texture, file_name);
+			}
+			pl_buffer_free(aov_texture.bmb.buffer_memory);
+			pl.window.title = (char*)"SAVED AOVS TO FILE!";
+			PL_push_window(pl.window, TRUE);
+		}
+		if (pl.input.keys[PL_KEY::SHIFT].down && pl.input.keys[PL_KEY::N].pressed)
+		{
+			resolve_film(film, texture);
+			showing_denoised = FALSE;
+			pl.window.title = (char*)"SHOWING NOISY RENDER";
+			PL_push_window(pl.window, TRUE);
+		}
+		if (pl.input.keys[PL_KEY::SHIFT].down && pl.input.keys[PL_KEY::D].pressed)
+		{
+			denoise_film(film, texture, ds, job_system);
+			showing_denoised = TRUE;
+			pl.window.title = (char*)"SHOWING DENOISED RENDER";
+			PL_push_window(pl.window, TRUE);
+		}
+		//display settings: Shift+T cycles tone mapping, Shift+E/Shift+Q doubles/halves exposure
+		//NOTE: both films, so the display doesn't change back the next time the camera moves
+		b32 display_changed = FALSE;
+		if (pl.input.keys[PL_KEY::SHIFT].down && pl.input.keys[PL_KEY::T].pressed)
+		{
+			film.display.tone_map = (ToneMapOperator)(((int32)film.display.tone_map + 1) % 3);
+			display_changed = TRUE;
+		}
+		if (pl.input.keys[PL_KEY::SHIFT].down && pl.input.keys[PL_KEY::E].pressed)
+		{
+			film.display.exposure *= 2.0f;
+			display_changed = TRUE;
+		}
+		if (pl.input.keys[PL_KEY::SHIFT].down && pl.input.keys[PL_KEY::Q].pressed)
+		{
+			film.display.exposure *= 0.5f;
+			display_changed = TRUE;
+		}
+		if (display_changed)
+		{
+			films[0].display = film.display;
+			films[1].display = film.display;
+			if (showing_denoised)
+			{
+				denoise_film(film, texture, ds, job_system);
+			}
+			else
+			{
+				resolve_film(film, texture);
+			}
+			char buffer[512];
+			pl_format_print(buffer, 512, "Tone Mapping: %s | Exposure: %.2f", get_tone_map_operator_name(film.display.tone_map), film.display.exposure);
+			pl.window.title = buffer;
+			PL_push_window(pl.window, TRUE);
 		}
 		
 		if (pl.input.mouse.left.down && pl.input.mouse.is_in_window)
 		{
 			vec2i point = { pl.input.mouse.position_x, pl.input.mouse.position_y };
 			
-			tile_on_mouse = find_tile_index_covering_point(point, info.twq);
+			tile_on_mouse = find_tile_index_covering_point(point, info.tiles);
 			if (tile_on_mouse != -1)
 			{
 				uint64 cycles_to_render_tile = Tiles_TestType->tests.front[tile_on_mouse].test_run_cycles;
-				uint64 ray_casts_on_tile = info.twq.jobs[tile_on_mouse].ray_casts;
+				uint64 ray_casts_on_tile = info.tiles[tile_on_mouse].ray_casts;
 				f64 tile_ms = ((f64)cycles_to_render_tile / (f64)pl.time.cycles_per_second) * 1000;
 				char buffer[512];
-				pl_format_print(buffer, 512, "Rendered:Tile(%i/%i) milliseconds to render tile:%.*f ms | rays cast on tile:%i64  ",tile_on_mouse+1,info.twq.jobs.size, 3,tile_ms, ray_casts_on_tile);
+				pl_format_print(buffer, 512, "Rendered:Tile(%i/%i) milliseconds to render tile:%.*f ms | rays cast on tile:%i64  ",tile_on_mouse+1,info.tiles.size, 3,tile_ms, ray_casts_on_tile);
 				pl.window.title = buffer;
 				PL_push_window(pl.window, TRUE);
 			}
@@ -246,19 +361,15 @@ static void render_app(PL& pl,Texture& texture, ThreadPool& tpool)
 		
 	}
 
-
-	if (info.twq.jobs_done == info.twq.jobs.size)
-	{
-		info.twq.jobs.clear();
-	}
-	else
+	//TODO:Maybe put warning message about how the process wont end until all threads finish the pixels they're working on
+	if (rendering)
 	{
-		ASSERT(false);	//All tiles not rendered!
+		cancel_render_from_camera(info);
 	}
-
-
-	free_scene_memory(scene);
-
+	info.tiles.clear();
+	free_scene_memory(scene);	//NOTE:cleared out on process end anyway. Maybe implement a "shutdown" which waits for all threads to finish then clears scene memory.
+	free_film(films[0]);
+	free_film(films[1]);
 }
 
 static void print_out_tests(PL_Timing& pl)
@@ -276,11 +387,11 @@ static void print_out_tests(PL_Timing& pl)
 			{
 				total += index->test_run_cycles;
 				f64 ms = (index->test_run_cycles * 1000 / (f64)pl.cycles_per_second);
-				pl_debug_print("		index:%i:%.*f ms (%.*f s),%I64u\n", i, 3, ms, 4, ms / 1000, index->test_run_cycles);
+				pl_debug_print("		index:%i:%.*f ms (%.*f s),%llu\n", i, 3, ms, 4, ms / 1000, index->test_run_cycles);
 				index++;
 			}
 			f64 ms = (total * 1000 / (f64)pl.cycles_per_second);
-			pl_debug_print("	total:%.*f ms (%.*f s), %I64u\n", 3, ms, 4, ms / 1000, total);
+			pl_debug_print("	total:%.*f ms (%.*f s), %llu\n", 3, ms, 4, ms / 1000, total);
 
 		}
 		else
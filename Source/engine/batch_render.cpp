@@ -0,0 +1,925 @@
+#include "batch_render.h"
+#include "distributed_render.h"
+#include "partial_film.h"
+#include "scene_setup.h"
+#include "renderer/renderer.h"
+#include "renderer/denoiser.h"
+#include "utilities/parser.h"
+
+#define BATCH_POLL_INTERVAL_MS 20		//how late the end of the render can be noticed
+#define BATCH_PROGRESS_INTERVAL 1.0		//seconds between progress prints
+#define BATCH_STATS_BUFFER_SIZE 1024	//pl_print can't print more at once
+#define DEFAULT_CHECKPOINT_INTERVAL 300.0f	//seconds
+#define TIME_BUDGET_SAMPLES_PER_PASS 1		//the image gets better evenly, and a pass is never far from done
+#define TIME_BUDGET_MAX_SAMPLES_PER_PIXEL 65536	//used when --spp isn't given with --time
+
+static b32 args_match(const char* a, const char* b)
+{
+	while (*a && *a == *b)
+	{
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+//parses count numbers separated by commas (ex: "0.1,2,0"). Fails if there's anything else in str.
+static b32 parse_f32_list(char* str, f32* values, uint32 count)
+{
+	for (uint32 i = 0; i < count; i++)
+	{
+		f64 value;
+		char* end = parse_f64(str, value);
+		if (end == str || (i + 1 < count && *end != ','))
+		{
+			return FALSE;
+		}
+		values[i] = (f32)value;
+		str = end + (i + 1 < count);
+	}
+	return *str == 0;
+}
+
+static b32 parse_uint32_arg(char* str, uint32& value)
+{
+	uint64 tmp;
+	char* end = parse_uint(str, tmp);
+	if (end == str || *end != 0 || tmp > UINT32MAX)
+	{
+		return FALSE;
+	}
+	value = (uint32)tmp;
+	return TRUE;
+}
+
+//parses count unsigned numbers separated by commas (ex: "0,2,16"). Fails if there's anything else in str.
+static b32 parse_uint32_list(char* str, uint32* values, uint32 count)
+{
+	for (uint32 i = 0; i < count; i++)
+	{
+		uint64 value;
+		char* end = parse_uint(str, value);
+		if (end == str || value > UINT32MAX || (i + 1 < count && *end != ','))
+		{
+			return FALSE;
+		}
+		values[i] = (uint32)value;
+		str = end + (i + 1 < count);
+	}
+	return *str == 0;
+}
+
+//"first-last" or a single number (inclusive)
+static b32 parse_range_arg(char* str, uint32& first, uint32& last)
+{
+	uint64 a, b;
+	char* end = parse_uint(str, a);
+	if (end == str || a > UINT32MAX)
+	{
+		return FALSE;
+	}
+	b = a;
+	if (*end == '-')
+	{
+		char* last_start = end + 1;
+		end = parse_uint(last_start, b);
+		if (end == last_start)
+		{
+			return FALSE;
+		}
+	}
+	first = (uint32)a;
+	last = (uint32)b;
+	return *end == 0 && b >= a && b <= UINT32MAX;
+}
+
+//NOTE: a pl_print per group of options, as pl_print can't print more than BATCH_STATS_BUFFER_SIZE at once
+static void print_batch_render_usage()
+{
+	pl_print(
+		"Usage: ATRay --headless [options]\n"
+		"	--scene <model.obj>             model to render (default %s)\n"
+		"	--camera <px,py,pz,dx,dy,dz>    camera position and facing direction\n"
+		"	--fov <f>                       horizontal field of view (sensor width at distance 1)\n"
+		"	--resolution <WxH>              image size in pixels (default 1280x720)\n"
+		"	--spp <n>                       samples per pixel (max samples with --adaptive)\n"
+		"	--adaptive <threshold>          adaptive sampling error threshold (0 for uniform sampling)\n",
+		DEFAULT_SCENE_PATH);
+	pl_print(
+		"	--threads <n>                   render threads (of every worker with --workers). Default: all cores\n"
+		"	--workers <n>                   splits the tiles between n worker processes\n"
+		"	--worker-command <command>      starts the workers with command (default: this program)\n"
+		"	--seed <n>                      noise seed\n"
+		"	--frame <n>                     frame of a sequence\n"
+		"	--denoise                       write the denoised image\n"
+		"	--output <image.bmp>            output image (overwritten, default Results\\render.bmp)\n"
+		"	--stats <stats.txt>             also write the stats summary to a file\n");
+	pl_print(
+		"Frame sharding:\n"
+		"	--tiles <first-last>            only render these tiles of the tile layout\n"
+		"	--samples <first-last>          only render these samples of every pixel (in place of --spp)\n"
+		"	--tile-layout <n>               tiles are the ones of a render with n threads (default %u)\n"
+		"	--count-tiles                   print the no of tiles of the layout and exit\n"
+		"	--partial <film.partial>        write the rendered film (float radiance and sample counts)\n"
+		"	--merge <a.partial> <b.partial> ...  merge partial films into the output image (and --partial)\n",
+		DEFAULT_SHARD_TILE_LAYOUT);
+	pl_print(
+		"Checkpoints:\n"
+		"	--checkpoint <film.partial>     save the film every --checkpoint-interval seconds and when done\n"
+		"	--checkpoint-interval <s>       default %.0f\n"
+		"	--resume                        continue from the checkpoint if there is one (same options as before)\n",
+		DEFAULT_CHECKPOINT_INTERVAL);
+	pl_print(
+		"Time budget:\n"
+		"	--time <s>                      render for s seconds (from start, loading included), then write what's done.\n"
+		"	                                --spp is the most samples a pixel gets (default %u)\n",
+		TIME_BUDGET_MAX_SAMPLES_PER_PIXEL);
+	pl_print(
+		"Region of interest:\n"
+		"	--region <left,top,right,bottom>  only render these pixels (inclusive, from the top left)\n"
+		"	--crop                          write an image of just the region\n"
+		"	--patch <previous.bmp>          write the region over a previous render of the same resolution\n");
+}
+
+b32 is_batch_render(int32 argc, char** argv)
+{
+	for (int32 i = 1; i < argc; i++)
+	{
+		if (args_match(argv[i], "--headless"))
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+b32 parse_batch_render_options(int32 argc, char** argv, BatchRenderOptions& options)
+{
+	options = {};
+	options.scene_path = DEFAULT_SCENE_PATH;
+	options.output_path = "Results\\render.bmp";
+	options.camera_position = DEFAULT_CAMERA_POSITION;
+	options.camera_direction = DEFAULT_CAMERA_DIRECTION;
+	options.fov = DEFAULT_CAMERA_FOV;
+	options.width = 1280;
+	options.height = 720;
+	options.samples_per_pixel = 16;
+	options.tile_layout = DEFAULT_SHARD_TILE_LAYOUT;
+	options.checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+	b32 sample_range = FALSE;
+	uint32 last_sample = 0;
+	b32 spp_given = FALSE;
+
+	for (int32 i = 1; i < argc; i++)
+	{
+		char* arg = argv[i];
+		if (args_match(arg, "--headless"))
+		{
+			continue;
+		}
+		if (args_match(arg, "--denoise"))
+		{
+			options.denoise = TRUE;
+			continue;
+		}
+		if (args_match(arg, "--worker"))
+		{
+			options.worker = TRUE;
+			continue;
+		}
+		if (args_match(arg, "--resume"))
+		{
+			options.resume = TRUE;
+			continue;
+		}
+		if (args_match(arg, "--crop"))
+		{
+			options.crop = TRUE;
+			continue;
+		}
+		if (args_match(arg, "--count-tiles"))
+		{
+			options.count_tiles = TRUE;
+			continue;
+		}
+		if (args_match(arg, "--merge"))
+		{
+			options.merge = TRUE;
+			continue;
+		}
+		if (options.merge && arg[0] != '-')
+		{
+			//partial films to merge
+			if (!options.merge_paths.front)
+			{
+				options.merge_paths.allocate(argc);
+				options.merge_paths.size = 0;
+			}
+			options.merge_paths.front[options.merge_paths.size++] = arg;
+			continue;
+		}
+		if (args_match(arg, "--help") || args_match(arg, "-h"))
+		{
+			options.help = TRUE;
+			continue;
+		}
+
+		//everything else takes a value
+		if (i + 1 >= argc)
+		{
+			pl_print("Missing value for %s\n", arg);
+			return FALSE;
+		}
+		char* value = argv[++i];
+		b32 valid = TRUE;
+		if (args_match(arg, "--scene"))
+		{
+			options.scene_path = value;
+		}
+		else if (args_match(arg, "--output"))
+		{
+			options.output_path = value;
+		}
+		else if (args_match(arg, "--stats"))
+		{
+			options.stats_path = value;
+		}
+		else if (args_match(arg, "--camera"))
+		{
+			f32 camera[6];
+			valid = parse_f32_list(value, camera, 6);
+			options.camera_position = { camera[0], camera[1], camera[2] };
+			options.camera_direction = { camera[3], camera[4], camera[5] };
+			valid = valid && mag2(options.camera_direction) > 0.0f;
+		}
+		else if (args_match(arg, "--fov"))
+		{
+			valid = parse_f32_list(value, &options.fov, 1) && options.fov > 0.0f;
+		}
+		else if (args_match(arg, "--resolution"))
+		{
+			uint64 width, height;
+			char* end = parse_uint(value, width);
+			valid = end != value && *end == 'x';
+			if (valid)
+			{
+				char* height_start = end + 1;
+				end = parse_uint(height_start, height);
+				valid = end != height_start && *end == 0 && width > 0 && height > 0 && width <= 16384 && height <= 16384;
+				options.width = (uint32)width;
+				options.height = (uint32)height;
+			}
+		}
+		else if (args_match(arg, "--spp"))
+		{
+			valid = parse_uint32_arg(value, options.samples_per_pixel) && options.samples_per_pixel > 0;
+			spp_given = TRUE;
+		}
+		else if (args_match(arg, "--adaptive"))
+		{
+			valid = parse_f32_list(value, &options.adaptive_threshold, 1) && options.adaptive_threshold >= 0.0f;
+		}
+		else if (args_match(arg, "--threads"))
+		{
+			valid = parse_uint32_arg(value, options.threads);
+		}
+		else if (args_match(arg, "--workers"))
+		{
+			valid = parse_uint32_arg(value, options.workers);
+		}
+		else if (args_match(arg, "--worker-command"))
+		{
+			options.worker_command = value;
+		}
+		else if (args_match(arg, "--tiles"))
+		{
+			valid = parse_range_arg(value, options.first_tile, options.last_tile);
+			options.tile_range = TRUE;
+		}
+		else if (args_match(arg, "--samples"))
+		{
+			valid = parse_range_arg(value, options.first_sample, last_sample);
+			sample_range = TRUE;
+		}
+		else if (args_match(arg, "--tile-layout"))
+		{
+			valid = parse_uint32_arg(value, options.tile_layout) && options.tile_layout > 0;
+		}
+		else if (args_match(arg, "--partial"))
+		{
+			options.partial_path = value;
+		}
+		else if (args_match(arg, "--time"))
+		{
+			valid = parse_f32_list(value, &options.time_budget, 1) && options.time_budget > 0.0f;
+		}
+		else if (args_match(arg, "--region"))
+		{
+			valid = parse_uint32_list(value, options.region, 4) && options.region[0] <= options.region[2] && options.region[1] <= options.region[3];
+			options.has_region = TRUE;
+		}
+		else if (args_match(arg, "--patch"))
+		{
+			options.patch_path = value;
+		}
+		else if (args_match(arg, "--checkpoint"))
+		{
+			options.checkpoint_path = value;
+		}
+		else if (args_match(arg, "--checkpoint-interval"))
+		{
+			valid = parse_f32_list(value, &options.checkpoint_interval, 1) && options.checkpoint_interval > 0.0f;
+		}
+		else if (args_match(arg, "--seed"))
+		{
+			valid = parse_uint32_arg(value, options.seed);
+		}
+		else if (args_match(arg, "--frame"))
+		{
+			valid = parse_uint32_arg(value, options.frame);
+		}
+		else
+		{
+			pl_print("Unknown argument: %s\n", arg);
+			return FALSE;
+		}
+		if (!valid)
+		{
+			pl_print("Invalid value for %s: %s\n", arg, value);
+			return FALSE;
+		}
+	}
+
+	if (options.time_budget > 0.0f && !spp_given && !sample_range)
+	{
+		options.samples_per_pixel = TIME_BUDGET_MAX_SAMPLES_PER_PIXEL;
+	}
+	if (sample_range)
+	{
+		options.samples_per_pixel = last_sample - options.first_sample + 1;
+		if (options.adaptive_threshold > 0.0f)
+		{
+			pl_print("--samples can't be used with --adaptive (convergence depends on all samples of a pixel)\n");
+			return FALSE;
+		}
+	}
+	if (options.workers && (options.tile_range || sample_range || options.partial_path || options.checkpoint_path || options.time_budget > 0.0f))
+	{
+		pl_print("--workers renders whole frames. Use --tiles/--samples/--partial/--checkpoint/--time without it.\n");
+		return FALSE;
+	}
+	if (options.has_region && (options.region[2] >= options.width || options.region[3] >= options.height))
+	{
+		pl_print("--region has to be inside the %ux%u image\n", options.width, options.height);
+		return FALSE;
+	}
+	if ((options.crop || options.patch_path) && (!options.has_region || options.partial_path || (options.crop && options.patch_path)))
+	{
+		pl_print("--crop and --patch write the image of a --region (one or the other, and not with --partial)\n");
+		return FALSE;
+	}
+	if (options.resume && !options.checkpoint_path)
+	{
+		pl_print("--resume needs --checkpoint\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+f64 get_seconds(PL_Timing& time)
+{
+	PL_poll_timing(time);
+	return time.fcurrent_seconds;
+}
+
+void set_batch_render_settings(RenderSettings& rs, BatchRenderOptions& options)
+{
+	set_default_render_settings(rs, options.width, options.height);
+	rs.seed = options.seed;
+	rs.frame = options.frame;
+	rs.sample_offset = options.first_sample;
+	rs.adaptive_threshold = options.adaptive_threshold;
+	if (options.adaptive_threshold > 0.0f)
+	{
+		rs.max_samples_per_pixel = options.samples_per_pixel;
+		rs.min_samples_per_pixel = min(rs.min_samples_per_pixel, options.samples_per_pixel);
+	}
+	else
+	{
+		//NOTE: nothing shows the passes, so all samples are done in one pass (no pass barriers)
+		rs.samples_per_pixel = options.samples_per_pixel;
+		rs.samples_per_pass = 0;
+	}
+	if (options.time_budget > 0.0f)
+	{
+		rs.samples_per_pass = TIME_BUDGET_SAMPLES_PER_PASS;
+	}
+}
+
+static uint32 hash_bytes(uint32 hash, const void* data, uint32 size)
+{
+	const uint8* bytes = (const uint8*)data;
+	for (uint32 i = 0; i < size; i++)
+	{
+		hash = hash_combine(hash, bytes[i]);
+	}
+	return hash;
+}
+
+static uint32 hash_string(uint32 hash, const char* string)
+{
+	for (; *string; string++)
+	{
+		hash = hash_combine(hash, (uint8)*string);
+	}
+	return hash;
+}
+
+//Everything but the tiles and samples that changes the image. Seed, frame, resolution and AOVs are in the header already.
+//NOTE: the scene is hashed by its path, not its contents
+static uint32 get_render_hash(BatchRenderOptions& options, RenderSettings& rs)
+{
+	uint32 hash = hash_string(0, options.scene_path);
+	hash = hash_bytes(hash, &options.camera_position, sizeof(options.camera_position));
+	hash = hash_bytes(hash, &options.camera_direction, sizeof(options.camera_direction));
+	hash = hash_bytes(hash, &options.fov, sizeof(options.fov));
+	hash = hash_bytes(hash, &rs.adaptive_threshold, sizeof(rs.adaptive_threshold));
+	hash = hash_combine(hash, rs.min_samples_per_pixel);
+	hash = hash_combine(hash, rs.anti_aliasing);
+	hash = hash_combine(hash, (uint32)rs.bounce_limit);
+	hash = hash_combine(hash, rs.russian_roulette);
+	hash = hash_combine(hash, (uint32)rs.russian_roulette_min_depth);
+	hash = hash_combine(hash, rs.next_event_estimation);
+	return hash_combine(hash, (uint32)rs.sampler);
+}
+
+//NOTE: without --tiles the layout depends on the thread count, but it's always the whole frame
+static uint32 get_tiles_hash(BatchRenderOptions& options, RenderSettings& rs)
+{
+	uint32 hash = hash_combine(0, options.tile_range);
+	if (options.tile_range)
+	{
+		hash = hash_combine(hash, options.tile_layout);
+		hash = hash_combine(hash, (uint32)rs.tile_order);
+		hash = hash_combine(hash, options.first_tile);
+		hash = hash_combine(hash, options.last_tile);
+	}
+	hash = hash_combine(hash, options.has_region);
+	if (options.has_region)
+	{
+		hash = hash_bytes(hash, options.region, sizeof(options.region));
+	}
+	return hash;
+}
+
+//Partial film of the rendered tiles (--partial and checkpoints)
+static b32 write_render_partial_film(const char* path, BatchRenderOptions& options, Film& film, RenderSettings& rs, FDBuffer<RenderTile>& tiles, int64 ray_casts)
+{
+	PartialFilmHeader header = {};
+	header.seed = rs.seed;
+	header.frame = rs.frame;
+	header.first_sample = rs.sample_offset;
+	header.no_samples = get_max_samples_per_pixel(rs);
+	header.no_tiles = tiles.size;
+	header.render_hash = get_render_hash(options, rs);
+	header.tiles_hash = get_tiles_hash(options, rs);
+	header.ray_casts = ray_casts;
+	Tile* rendered_tiles = (Tile*)pl_buffer_alloc(tiles.size * sizeof(Tile));
+	for (int32 i = 0; i < tiles.size; i++)
+	{
+		rendered_tiles[i] = tiles[i].tile;
+	}
+	b32 written = write_partial_film(path, film, header, rendered_tiles);
+	pl_buffer_free(rendered_tiles);
+	return written;
+}
+
+//Written next to the checkpoint and moved over it, so being killed while writing leaves the previous checkpoint
+static b32 write_checkpoint(BatchRenderOptions& options, Film& film, RenderSettings& rs, FDBuffer<RenderTile>& tiles, int64 ray_casts)
+{
+	char tmp_path[1024];
+	pl_format_print(tmp_path, sizeof(tmp_path), "%s.tmp", options.checkpoint_path);
+	return write_render_partial_film(tmp_path, options, film, rs, tiles, ray_casts) && pl_replace_file(tmp_path, (char*)options.checkpoint_path);
+}
+
+//Loads the checkpoint into film if there is one. Returns FALSE if there is one, but it's not from the same render.
+static b32 resume_from_checkpoint(BatchRenderOptions& options, Film& film, Texture& texture, RenderSettings& rs, int64& ray_casts)
+{
+	void* file;
+	if (!pl_get_file_handle((char*)options.checkpoint_path, &file))
+	{
+		pl_print("No checkpoint at %s, starting from the beginning\n", options.checkpoint_path);
+		return TRUE;
+	}
+	pl_close_file_handle(file);
+
+	PartialFilmHeader header;
+	if (!read_partial_film(options.checkpoint_path, film, header))
+	{
+		pl_print("Can't resume from %s: not a checkpoint of this resolution (and --denoise)\n", options.checkpoint_path);
+		return FALSE;
+	}
+	if (header.seed != rs.seed || header.frame != rs.frame || header.first_sample != rs.sample_offset || header.no_samples != get_max_samples_per_pixel(rs))
+	{
+		pl_print("Can't resume from %s: it has different samples (seed, frame or samples per pixel)\n", options.checkpoint_path);
+		clear_film(film);
+		return FALSE;
+	}
+	if (header.render_hash != get_render_hash(options, rs))
+	{
+		pl_print("Can't resume from %s: it's of a different scene, camera or render settings\n", options.checkpoint_path);
+		clear_film(film);
+		return FALSE;
+	}
+	if (header.tiles_hash != get_tiles_hash(options, rs))
+	{
+		pl_print("Can't resume from %s: it has different tiles (--tiles, --tile-layout or --region)\n", options.checkpoint_path);
+		clear_film(film);
+		return FALSE;
+	}
+	ray_casts = header.ray_casts;
+	uint64 total_samples = 0;
+	for (uint32 i = 0; i < film.sample_count.size; i++)
+	{
+		total_samples += film.sample_count[i];
+	}
+	//NOTE: rows are only resolved by the renderer if it samples them
+	resolve_film(film, texture);
+	pl_print("Resuming from %s (mean %.2f spp)\n", options.checkpoint_path, (f64)total_samples / (f64)film.sample_count.size);
+	return TRUE;
+}
+
+Tile get_batch_render_region(BatchRenderOptions& options)
+{
+	Tile region;
+	region.left_bottom = { (int32)options.region[0], (int32)(options.height - 1 - options.region[3]) };
+	region.right_top = { (int32)options.region[2], (int32)(options.height - 1 - options.region[1]) };
+	return region;
+}
+
+b32 load_patch_image(BatchRenderOptions& options, Texture& image)
+{
+	if (!Read_From_Path(image, options.patch_path))
+	{
+		pl_print("Couldn't read the image to patch: %s\n", options.patch_path);
+		return FALSE;
+	}
+	if (image.bmb.width != options.width || image.bmb.height != options.height)
+	{
+		pl_print("%s is %ux%u, not the %ux%u of the render\n", options.patch_path, image.bmb.width, image.bmb.height, options.width, options.height);
+		pl_buffer_free(image.bmb.buffer_memory);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+//Prints a line of the stats summary and appends it to stats_file (0 if there isn't one)
+static void print_stats_line(void* stats_file, const char* line)
+{
+	pl_print("%s", line);
+	if (stats_file)
+	{
+		uint32 length = 0;
+		while (line[length] != 0)
+		{
+			length++;
+		}
+		pl_append_to_file(stats_file, (void*)line, length);
+	}
+}
+
+int32 finish_batch_render(PL& pl, BatchRenderOptions& options, RenderSettings& rs, Film& film, Texture& texture, Texture* patch, FDBuffer<RenderTile>& tiles, BatchRenderStats& stats, JobSystem& job_system)
+{
+	//NOTE: rows are resolved into texture as they finish, so only the denoised image needs another pass over the film.
+	//Partial films are denoised once merged.
+	b32 denoise = options.denoise && !options.partial_path;
+	if (denoise)
+	{
+		DenoiseSettings ds;
+		denoise_film(film, texture, ds, job_system);
+	}
+	f64 denoise_time = get_seconds(pl.time);
+
+	b32 written;
+	if (options.partial_path)
+	{
+		written = write_render_partial_film(options.partial_path, options, film, rs, tiles, stats.resumed_ray_casts + stats.ray_casts);
+	}
+	else if (options.has_region && (options.crop || patch))
+	{
+		Tile region = get_batch_render_region(options);
+		uint32 region_width = region.right_top.x - region.left_bottom.x + 1;
+		uint32 region_height = region.right_top.y - region.left_bottom.y + 1;
+		if (patch)
+		{
+			Copy_Texture_Region(texture, region.left_bottom.x, region.left_bottom.y, *patch, region.left_bottom.x, region.left_bottom.y, region_width, region_height);
+			written = Write_To_Path(*patch, options.output_path);
+		}
+		else
+		{
+			Texture cropped;
+			Setup_Texture(cropped, TextureFileType::BMP, region_width, region_height);
+			Copy_Texture_Region(texture, region.left_bottom.x, region.left_bottom.y, cropped, 0, 0, region_width, region_height);
+			written = Write_To_Path(cropped, options.output_path);
+			pl_buffer_free(cropped.bmb.buffer_memory);
+		}
+	}
+	else
+	{
+		written = Write_To_Path(texture, options.output_path);
+	}
+	f64 end_time = get_seconds(pl.time);
+
+	//NOTE: only pixels of the rendered tiles, so the numbers are about what was rendered (tile shards, regions)
+	uint64 total_samples = 0;
+	uint64 total_pixels = 0;
+	uint32 min_samples = UINT32MAX;
+	uint32 max_samples = 0;
+	for (int32 t = 0; t < tiles.size; t++)
+	{
+		Tile& tile = tiles[t].tile;
+		for (int32 y = tile.left_bottom.y; y <= tile.right_top.y; y++)
+		{
+			for (int32 x = tile.left_bottom.x; x <= tile.right_top.x; x++)
+			{
+				uint32 samples = film.sample_count[y * film.width + x];
+				total_samples += samples;
+				min_samples = min(min_samples, samples);
+				max_samples = max(max_samples, samples);
+			}
+		}
+		total_pixels += (tile.right_top.x - tile.left_bottom.x + 1) * (tile.right_top.y - tile.left_bottom.y + 1);
+	}
+	if (total_pixels == 0)
+	{
+		min_samples = 0;
+	}
+	char region[64] = "";
+	if (options.has_region)
+	{
+		pl_format_print(region, sizeof(region), " | Region: %u,%u-%u,%u%s", options.region[0], options.region[1], options.region[2], options.region[3],
+			options.crop ? " (cropped)" : patch ? " (patched)" : "");
+	}
+	f64 render_seconds = stats.render_time - stats.prep_time;
+
+	char workers[64] = "";
+	if (stats.workers)
+	{
+		pl_format_print(workers, sizeof(workers), " | Workers: %u (%u lost)", stats.workers, stats.workers_lost);
+	}
+	char time_budget[96] = "";
+	if (stats.deadline > 0.0)
+	{
+		f64 overrun = stats.render_time - stats.deadline;
+		pl_format_print(time_budget, sizeof(time_budget), "Time Budget: %.3f s | %s: %.2f ms %s the deadline\n",
+			options.time_budget, stats.out_of_time ? "Stopped" : "Finished", (overrun >= 0.0 ? overrun : -overrun) * 1000.0, overrun >= 0.0 ? "after" : "before");
+	}
+	//NOTE: rays/s is of this run's rays, as the render time is of this run only
+	char resumed_rays[64] = "";
+	if (stats.resumed_ray_casts)
+	{
+		pl_format_print(resumed_rays, sizeof(resumed_rays), " (%lld this run)", stats.ray_casts);
+	}
+	//NOTE: printed and written a line at a time, so only a line with a path in it has to fit in BATCH_STATS_BUFFER_SIZE
+	void* stats_file = 0;
+	b32 stats_failed = options.stats_path && !pl_create_or_overwrite_file(&stats_file, (char*)options.stats_path);
+	if (stats_failed)
+	{
+		pl_print("Couldn't write stats to %s\n", options.stats_path);
+		stats_file = 0;
+	}
+	char line[BATCH_STATS_BUFFER_SIZE];
+	pl_format_print(line, sizeof(line), "Scene: %s\n", options.scene_path);
+	print_stats_line(stats_file, line);
+	pl_format_print(line, sizeof(line), "Output: %s%s\n", options.partial_path ? options.partial_path : options.output_path, written ? "" : " (FAILED TO WRITE)");
+	print_stats_line(stats_file, line);
+	pl_format_print(line, sizeof(line), "Resolution: %ux%u%s\n", options.width, options.height, region);
+	print_stats_line(stats_file, line);
+	//NOTE: out of time, the samples every pixel got (passes that were done) in place of the --spp cap
+	pl_format_print(line, sizeof(line), "Samples Per Pixel: %u (%s%s) | Mean: %.2f | Min: %u | Max: %u\n",
+		stats.out_of_time ? min_samples : options.samples_per_pixel, rs.adaptive_threshold > 0.0f ? "adaptive" : "uniform", stats.out_of_time ? ", out of time" : "",
+		total_pixels ? (f64)total_samples / (f64)total_pixels : 0.0, min_samples, max_samples);
+	print_stats_line(stats_file, line);
+	print_stats_line(stats_file, time_budget);
+	pl_format_print(line, sizeof(line), "Seed: %u | Frame: %u\n", rs.seed, rs.frame);
+	print_stats_line(stats_file, line);
+	pl_format_print(line, sizeof(line), "Threads: %u%s | Tiles: %i | Passes: %u\n", stats.threads, workers, stats.tiles, stats.passes);
+	print_stats_line(stats_file, line);
+	pl_format_print(line, sizeof(line), "Accelerator: %s | Sampler: %s | Denoised: %s\n",
+		get_accelerator_name(rs.accelerator), get_sampler_type_name(rs.sampler), denoise ? "yes" : "no");
+	print_stats_line(stats_file, line);
+	pl_format_print(line, sizeof(line), "Rays: %lld%s | %.2f Mrays/s\n",
+		stats.resumed_ray_casts + stats.ray_casts, resumed_rays, render_seconds > 0.0 ? (f64)stats.ray_casts / render_seconds / 1000000.0 : 0.0);
+	print_stats_line(stats_file, line);
+	pl_format_print(line, sizeof(line), "Load: %.3f s | Prep: %.3f s | Render: %.3f s | Denoise: %.3f s | Write: %.3f s | Total: %.3f s\n",
+		stats.load_time - stats.start_time, stats.prep_time - stats.load_time, render_seconds, denoise_time - stats.render_time, end_time - denoise_time, end_time - stats.start_time);
+	print_stats_line(stats_file, line);
+	if (stats_file)
+	{
+		pl_close_file_handle(stats_file);
+	}
+
+	return written && !stats_failed ? 0 : 1;
+}
+
+int32 run_batch_render(PL& pl, BatchRenderOptions& options)
+{
+	if (options.help)
+	{
+		print_batch_render_usage();
+		return 0;
+	}
+	PL_initialize_timing(pl.time);
+	if (options.worker)
+	{
+		return run_render_worker(pl, options);
+	}
+	if (options.workers)
+	{
+		return run_distributed_render(pl, options);
+	}
+	if (options.merge)
+	{
+		return run_partial_film_merge(pl, options);
+	}
+	if (options.count_tiles)
+	{
+		RenderSettings rs;
+		set_batch_render_settings(rs, options);
+		FDBuffer<RenderTile> tiles;
+		make_render_tiles(tiles, options.width, options.height, options.tile_layout, rs.tile_order);
+		pl_print("%i\n", tiles.size);
+		tiles.clear();
+		return 0;
+	}
+	f64 start_time = get_seconds(pl.time);
+	Texture patch = {};
+	if (options.patch_path && !load_patch_image(options, patch))
+	{
+		return 1;
+	}
+
+	JobSystem job_system;
+	uint32 threads = options.threads ? options.threads : pl.core_count;
+	start_job_system(job_system, threads);
+
+	Scene scene;
+	if (!setup_app_scene(scene, options.scene_path, job_system))
+	{
+		pl_print("Couldn't open scene: %s\n", options.scene_path);
+		if (patch.bmb.buffer_memory)
+		{
+			pl_buffer_free(patch.bmb.buffer_memory);
+		}
+		stop_job_system(job_system);
+		return 1;
+	}
+	f64 load_time = get_seconds(pl.time);
+
+	RenderSettings rs;
+	set_batch_render_settings(rs, options);
+	Camera cm;
+	set_camera(cm, options.camera_position, options.camera_direction, rs, options.fov);
+
+	uint32 kd_tree_max_nodes;
+	prep_scene(scene, rs.accelerator, kd_tree_max_nodes, job_system);
+	f64 prep_time = get_seconds(pl.time);
+
+	Texture texture;
+	Setup_Texture(texture, TextureFileType::BMP, options.width, options.height);
+	Film film;
+	setup_film(film, options.width, options.height, options.denoise ? AOV_DENOISE_GUIDES : AOV_NONE);
+
+	RenderInfo info = {};
+	info.camera_tex = &texture;
+	info.film = &film;
+	info.camera = &cm;
+	info.scene = &scene;
+	info.hit_stack_capacity = kd_tree_max_nodes;
+	info.leaf_stack_capacity = kd_tree_max_nodes;
+	//NOTE: tiles (and --tiles indices) are of the whole image, the renderer cuts them down to the region
+	info.has_region = options.has_region;
+	if (options.has_region)
+	{
+		info.region = get_batch_render_region(options);
+	}
+
+	if (options.tile_range)
+	{
+		FDBuffer<RenderTile> layout;
+		make_render_tiles(layout, options.width, options.height, options.tile_layout, rs.tile_order);
+		if (options.last_tile >= (uint32)layout.size)
+		{
+			pl_print("Tiles %u-%u are out of range. The layout has %i tiles.\n", options.first_tile, options.last_tile, layout.size);
+			layout.clear();
+			free_film(film);
+			free_scene_memory(scene);
+			pl_buffer_free(texture.bmb.buffer_memory);
+			if (patch.bmb.buffer_memory)
+			{
+				pl_buffer_free(patch.bmb.buffer_memory);
+			}
+			stop_job_system(job_system);
+			return 1;
+		}
+		info.tiles.allocate(options.last_tile - options.first_tile + 1);
+		pl_buffer_copy(info.tiles.front, &layout[options.first_tile], info.tiles.size * sizeof(RenderTile));
+		layout.clear();
+	}
+	else
+	{
+		make_render_tiles(info.tiles, options.width, options.height, threads, rs.tile_order);
+	}
+	clear_film(film);
+	int64 resumed_ray_casts = 0;
+	if (options.resume && !resume_from_checkpoint(options, film, texture, rs, resumed_ray_casts))
+	{
+		info.tiles.clear();
+		free_film(film);
+		free_scene_memory(scene);
+		pl_buffer_free(texture.bmb.buffer_memory);
+		if (patch.bmb.buffer_memory)
+		{
+			pl_buffer_free(patch.bmb.buffer_memory);
+		}
+		stop_job_system(job_system);
+		return 1;
+	}
+
+	pl_print("Rendering %s at %ux%u, %u spp, %u threads...\n", options.scene_path, options.width, options.height, options.samples_per_pixel, threads);
+	start_render_of_tiles(info, job_system);
+	f64 last_progress_time = prep_time;
+	f64 last_checkpoint_time = prep_time;
+	f64 deadline = options.time_budget > 0.0f ? start_time + options.time_budget : 0.0;
+	uint32 wait_ms = BATCH_POLL_INTERVAL_MS;
+	b32 out_of_time = FALSE;
+	while (wait_for_render_from_camera_to_finish(info, wait_ms))
+	{
+		if (get_seconds(pl.time) - last_progress_time >= BATCH_PROGRESS_INTERVAL)
+		{
+			last_progress_time = pl.time.fcurrent_seconds;
+			pl_print("	Pass %i/%u | Tiles %i/%i\n", info.current_pass + 1, info.no_passes, info.tiles_done, info.tiles.size);
+		}
+		if (deadline > 0.0)
+		{
+			//NOTE: waits get shorter near the deadline, and the cancel only waits for the pixels being rendered
+			f64 remaining = deadline - pl.time.fcurrent_seconds;
+			if (remaining <= 0.0)
+			{
+				cancel_render_from_camera(info);
+				for (int32 i = 0; i < info.tiles.size; i++)
+				{
+					info.total_ray_casts += info.tiles[i].ray_casts;
+				}
+				out_of_time = TRUE;
+				break;
+			}
+			wait_ms = (uint32)min(remaining * 1000.0, (f64)BATCH_POLL_INTERVAL_MS);
+		}
+		//NOTE: the render is stopped for the checkpoint, so no pixel is half written. Pixels already started are finished
+		//first, and the restarted render skips the samples that are done.
+		if (options.checkpoint_path && pl.time.fcurrent_seconds - last_checkpoint_time >= options.checkpoint_interval)
+		{
+			cancel_render_from_camera(info);
+			int64 ray_casts = resumed_ray_casts;
+			for (int32 i = 0; i < info.tiles.size; i++)
+			{
+				ray_casts += info.tiles[i].ray_casts;
+			}
+			if (!write_checkpoint(options, film, rs, info.tiles, ray_casts))
+			{
+				pl_print("Couldn't write checkpoint %s\n", options.checkpoint_path);
+			}
+			last_checkpoint_time = get_seconds(pl.time);
+			start_render_of_tiles(info, job_system);
+		}
+	}
+	if (options.checkpoint_path && !write_checkpoint(options, film, rs, info.tiles, resumed_ray_casts + info.total_ray_casts))
+	{
+		pl_print("Couldn't write checkpoint %s\n", options.checkpoint_path);
+	}
+	BatchRenderStats stats = {};
+	stats.threads = threads;
+	stats.tiles = info.tiles.size;
+	stats.passes = out_of_time ? info.current_pass + 1 : info.no_passes;	//the last one can be part done
+	stats.ray_casts = info.total_ray_casts;
+	stats.resumed_ray_casts = resumed_ray_casts;
+	stats.start_time = start_time;
+	stats.load_time = load_time;
+	stats.prep_time = prep_time;
+	stats.render_time = get_seconds(pl.time);
+	stats.deadline = deadline;
+	stats.out_of_time = out_of_time;
+	int32 exit_code = finish_batch_render(pl, options, rs, film, texture, options.patch_path ? &patch : 0, info.tiles, stats, job_system);
+
+	info.tiles.clear();
+	free_film(film);
+	free_scene_memory(scene);
+	pl_buffer_free(texture.bmb.buffer_memory);
+	if (patch.bmb.buffer_memory)
+	{
+		pl_buffer_free(patch.bmb.buffer_memory);
+	}
+	stop_job_system(job_system);
+	return exit_code;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "PL/pl.h"
+#include "PL/PL_math.h"
+#include "renderer/renderer.h"
+
+//Headless render: everything comes from the command line, nothing is shown. Renders once, writes the image and a stats
+//summary, and exits. For machines without a display (render farm nodes).
+//
+//	ATRay --headless [--scene model.obj] [--camera px,py,pz,dx,dy,dz] [--fov f] [--resolution WxH] [--spp n]
+//		[--adaptive threshold] [--threads n] [--seed n] [--frame n] [--denoise] [--output image.bmp] [--stats stats.txt]
+//		[--workers n] [--worker-command command]
+//		[--tiles first-last] [--samples first-last] [--tile-layout n] [--partial film.partial] [--count-tiles]
+//		[--checkpoint film.partial] [--checkpoint-interval seconds] [--resume] [--time seconds]
+//		[--region left,top,right,bottom] [--crop | --patch previous.bmp]
+//	ATRay --headless --merge a.partial b.partial ... [--denoise] [--output image.bmp] [--partial merged.partial]
+
+struct BatchRenderOptions
+{
+	const char* scene_path;
+	const char* output_path;
+	const char* stats_path;		//0 only prints the stats
+	vec3f camera_position;
+	vec3f camera_direction;
+	f32 fov;
+	uint32 width;
+	uint32 height;
+	uint32 samples_per_pixel;	//max samples per pixel if adaptive_threshold isn't 0
+	f32 adaptive_threshold;		//0 gives every pixel samples_per_pixel samples
+	uint32 threads;				//0 uses every core. Threads of every worker process if workers isn't 0.
+	uint32 workers;				//worker processes the tiles are split between (see distributed_render.h). 0 renders in this process.
+	const char* worker_command;	//program (and arguments before ours) started for every worker. 0 starts this program.
+	b32 worker;					//this process is a worker of a coordinator (--worker, only passed by the coordinator)
+
+	//Frame sharding (see partial_film.h)
+	uint32 tile_layout;			//tile indices are from make_render_tiles for this many threads (DEFAULT_SHARD_TILE_LAYOUT)
+	b32 tile_range;				//only render tiles first_tile-last_tile
+	uint32 first_tile;
+	uint32 last_tile;
+	uint32 first_sample;		//samples first_sample to first_sample + samples_per_pixel - 1 of every pixel are rendered
+	const char* partial_path;	//writes the film to this partial film file. 0 doesn't.
+	b32 count_tiles;			//only print the no of tiles of the layout
+	b32 merge;					//merges merge_paths into an image instead of rendering
+	FDBuffer<const char*> merge_paths;
+
+	//Checkpoints (see run_batch_render)
+	const char* checkpoint_path;	//the film is saved here every checkpoint_interval seconds and at the end. 0 doesn't.
+	f32 checkpoint_interval;
+	b32 resume;						//continue from checkpoint_path if it exists
+
+	//Time budget: passes of 1 sample per pixel till the render has taken time_budget seconds (from the start, loading included),
+	//or samples_per_pixel is reached. 0 renders all samples.
+	f32 time_budget;
+
+	//Region of interest (see RenderInfo::region): only these pixels are rendered. The rest of the image is black, cut off
+	//(crop), or comes from a previous render (patch_path).
+	b32 has_region;
+	uint32 region[4];			//left, top, right, bottom: inclusive, from the top left of the image
+	b32 crop;					//writes an image of just the region
+	const char* patch_path;		//writes the region over this image (same resolution). 0 doesn't.
+
+	uint32 seed;
+	uint32 frame;
+	b32 denoise;
+	b32 help;					//only print the usage
+};
+
+//TRUE if the command line asks for a batch render (--headless)
+b32 is_batch_render(int32 argc, char** argv);
+
+//Fills options from the command line, starting from the defaults of the window render.
+//Prints what's wrong and returns FALSE if an argument is unknown or malformed.
+b32 parse_batch_render_options(int32 argc, char** argv, BatchRenderOptions& options);
+
+//Returns the process exit code (0 if the image was written)
+//NOTE: a checkpoint is a partial film (see partial_film.h) of the tiles being rendered. Samples are seeded from their pixel
+//and sample index, so the per pixel sample counts are all the state needed to continue: a resumed render skips the
+//samples pixels already have and gives the same image as one that wasn't stopped.
+int32 run_batch_render(PL& pl, BatchRenderOptions& options);
+
+//----<Shared by the batch renders>----
+struct BatchRenderStats
+{
+	uint32 threads;			//render threads of all processes
+	uint32 workers;			//worker processes. 0 if rendered in this process.
+	uint32 workers_lost;	//workers that died during the render (their tiles were rendered by the others)
+	int32 tiles;
+	uint32 passes;
+	int64 ray_casts;			//of this run
+	int64 resumed_ray_casts;	//of the runs before a resume. 0 if not resumed.
+	//seconds from PL_Timing at the end of each step
+	f64 start_time;
+	f64 load_time;
+	f64 prep_time;
+	f64 render_time;
+	f64 deadline;	//time budget deadline. 0 if there wasn't one.
+	b32 out_of_time;	//the deadline stopped the render before all samples were done
+};
+
+f64 get_seconds(PL_Timing& time);
+
+//Render settings of the window render with what the command line overrides
+void set_batch_render_settings(RenderSettings& rs, BatchRenderOptions& options);
+
+//Region of the options in film pixels (rows from the bottom)
+Tile get_batch_render_region(BatchRenderOptions& options);
+
+//Loads options.patch_path. Prints what's wrong and returns FALSE if it can't be read or isn't the size of the render.
+//NOTE: loaded before rendering, so a wrong path doesn't waste the render.
+b32 load_patch_image(BatchRenderOptions& options, Texture& image);
+
+//Denoises film into texture if asked for, writes the image (or the partial film of tiles) and prints the stats summary
+//(and writes it to options.stats_path). Returns the process exit code.
+//patch is the image from load_patch_image (0 without --patch). The region is copied into it and it's written instead.
+int32 finish_batch_render(PL& pl, BatchRenderOptions& options, RenderSettings& rs, Film& film, Texture& texture, Texture* patch, FDBuffer<RenderTile>& tiles, BatchRenderStats& stats, JobSystem& job_system);
+//----</Shared by the batch renders>----
@@ -0,0 +1,468 @@
+#include "distributed_render.h"
+#include "scene_setup.h"
+
+#define WORKER_MESSAGE_MAGIC 0x4B524F57	//"WORK"
+#define WORKER_COMMAND_LINE_SIZE 8192
+#define DISTRIBUTED_POLL_INTERVAL_MS 20
+#define DISTRIBUTED_PROGRESS_INTERVAL 1.0
+
+//----<Messages>----
+struct WorkerReady
+{
+	uint32 magic;
+	b32 loaded;	//FALSE if the scene couldn't be opened. The worker exits after sending it.
+};
+
+//followed by no_tiles Tiles
+struct TileRangeRequest
+{
+	uint32 no_tiles;	//0 tells the worker to quit
+};
+
+//followed by the packed film data of every tile of the request, in request order
+struct TileRangeResult
+{
+	uint32 magic;
+	uint32 no_tiles;
+	int64 ray_casts;
+};
+//----</Messages>----
+
+
+//----<Worker>----
+int32 run_render_worker(PL& pl, BatchRenderOptions& options)
+{
+	void* input = pl_get_standard_input();
+	void* output = pl_get_standard_output();
+
+	JobSystem job_system;
+	start_job_system(job_system, options.threads ? options.threads : pl.core_count);
+
+	WorkerReady ready = { WORKER_MESSAGE_MAGIC, TRUE };
+	Scene scene;
+	if (!setup_app_scene(scene, options.scene_path, job_system))
+	{
+		ready.loaded = FALSE;
+		pl_write_to_pipe(output, &ready, sizeof(ready));
+		stop_job_system(job_system);
+		return 1;
+	}
+	RenderSettings rs;
+	set_batch_render_settings(rs, options);
+	Camera cm;
+	set_camera(cm, options.camera_position, options.camera_direction, rs, options.fov);
+	uint32 kd_tree_max_nodes;
+	prep_scene(scene, rs.accelerator, kd_tree_max_nodes, job_system);
+
+	//NOTE: full size, so tiles are rendered at their place in the image. Only the requested tiles ever get samples.
+	Texture texture;
+	Setup_Texture(texture, TextureFileType::BMP, options.width, options.height);
+	Film film;
+	setup_film(film, options.width, options.height, options.denoise ? AOV_DENOISE_GUIDES : AOV_NONE);
+
+	RenderInfo info = {};
+	info.camera_tex = &texture;
+	info.film = &film;
+	info.camera = &cm;
+	info.scene = &scene;
+	info.hit_stack_capacity = kd_tree_max_nodes;
+	info.leaf_stack_capacity = kd_tree_max_nodes;
+
+	int32 exit_code = 0;
+	b32 running = pl_write_to_pipe(output, &ready, sizeof(ready));
+	while (running)
+	{
+		TileRangeRequest request;
+		if (!pl_read_from_pipe(input, &request, sizeof(request)) || request.no_tiles == 0)
+		{
+			break;	//coordinator is done (or gone)
+		}
+		Tile* tiles = (Tile*)pl_buffer_alloc(request.no_tiles * sizeof(Tile));
+		running = pl_read_from_pipe(input, tiles, request.no_tiles * sizeof(Tile));
+		for (uint32 i = 0; i < request.no_tiles && running; i++)
+		{
+			Tile& tile = tiles[i];
+			running = tile.left_bottom.x >= 0 && tile.left_bottom.y >= 0 && tile.left_bottom.x <= tile.right_top.x && tile.left_bottom.y <= tile.right_top.y
+				&& tile.right_top.x < (int32)options.width && tile.right_top.y < (int32)options.height;
+		}
+		if (!running)
+		{
+			pl_buffer_free(tiles);
+			exit_code = 1;
+			break;
+		}
+
+		info.tiles.allocate(request.no_tiles);
+		for (uint32 i = 0; i < request.no_tiles; i++)
+		{
+			info.tiles[i].tile = tiles[i];
+		}
+		start_render_of_tiles(info, job_system);
+		wait_for_counter(job_system, info.render_counter);
+		wait_for_render_from_camera_to_finish(info, 0);
+
+		TileRangeResult result = { WORKER_MESSAGE_MAGIC, request.no_tiles, info.total_ray_casts };
+		uint32 data_size = 0;
+		for (uint32 i = 0; i < request.no_tiles; i++)
+		{
+			data_size += get_film_tile_data_size(film, tiles[i]);
+		}
+		uint8* data = (uint8*)pl_buffer_alloc(data_size);
+		uint8* tile_data = data;
+		for (uint32 i = 0; i < request.no_tiles; i++)
+		{
+			pack_film_tile(film, tiles[i], tile_data);
+			tile_data += get_film_tile_data_size(film, tiles[i]);
+		}
+		running = pl_write_to_pipe(output, &result, sizeof(result)) && pl_write_to_pipe(output, data, data_size);
+
+		pl_buffer_free(data);
+		pl_buffer_free(tiles);
+		info.tiles.clear();
+	}
+
+	free_film(film);
+	free_scene_memory(scene);
+	pl_buffer_free(texture.bmb.buffer_memory);
+	stop_job_system(job_system);
+	return exit_code;
+}
+//----</Worker>----
+
+
+//----<Coordinator>----
+enum TileRangeState : int32
+{
+	TILE_RANGE_PENDING,
+	TILE_RANGE_RENDERING,
+	TILE_RANGE_DONE
+};
+
+struct DistributedRender;
+
+struct WorkerLink
+{
+	DistributedRender* render;
+	ProcessHandle process;
+	ThreadHandle thread;
+	volatile b32 ready;
+	volatile b32 died;	//process exited or sent something unexpected. Its range was put back.
+	b32 reported;		//the main thread printed that it died
+};
+
+struct DistributedRender
+{
+	FDBuffer<RenderTile> tiles;
+	uint32 tiles_per_range;
+	uint32 no_ranges;
+	volatile int32* range_states;	//TileRangeState of every range
+	volatile int32 ranges_done;
+	volatile int32 tiles_done;
+	volatile int32 workers_alive;
+	volatile int64 ray_casts;
+
+	Film* film;
+	Texture* texture;
+	FDBuffer<WorkerLink> workers;
+};
+
+//Returns -1 if every range is taken or done
+static int32 take_pending_range(DistributedRender& dr)
+{
+	for (uint32 i = 0; i < dr.no_ranges; i++)
+	{
+		if (dr.range_states[i] == TILE_RANGE_PENDING &&
+			interlocked_compare_exchange_i32(&dr.range_states[i], TILE_RANGE_RENDERING, TILE_RANGE_PENDING) == TILE_RANGE_PENDING)
+		{
+			return (int32)i;
+		}
+	}
+	return -1;
+}
+
+//Sends the range to the worker and puts the result in the film. Returns FALSE if the worker died.
+static b32 render_range_on_worker(WorkerLink& link, DistributedRender& dr, uint32 range)
+{
+	uint32 first_tile = range * dr.tiles_per_range;
+	uint32 no_tiles = min(dr.tiles_per_range, (uint32)dr.tiles.size - first_tile);
+
+	TileRangeRequest request = { no_tiles };
+	Tile* tiles = (Tile*)pl_buffer_alloc(no_tiles * sizeof(Tile));
+	uint32 data_size = 0;
+	for (uint32 i = 0; i < no_tiles; i++)
+	{
+		tiles[i] = dr.tiles[first_tile + i].tile;
+		data_size += get_film_tile_data_size(*dr.film, tiles[i]);
+	}
+	b32 success = pl_write_to_pipe(link.process.input_pipe, &request, sizeof(request))
+		&& pl_write_to_pipe(link.process.input_pipe, tiles, no_tiles * sizeof(Tile));
+
+	TileRangeResult result = {};
+	success = success && pl_read_from_pipe(link.process.output_pipe, &result, sizeof(result))
+		&& result.magic == WORKER_MESSAGE_MAGIC && result.no_tiles == no_tiles;
+
+	//NOTE: read whole before touching the film, so a worker dying halfway doesn't leave half a tile behind
+	uint8* data = success ? (uint8*)pl_buffer_alloc(data_size) : 0;
+	success = success && pl_read_from_pipe(link.process.output_pipe, data, data_size);
+	if (success)
+	{
+		uint8* tile_data = data;
+		for (uint32 i = 0; i < no_tiles; i++)
+		{
+			Tile& tile = tiles[i];
+			unpack_film_tile(*dr.film, tile, tile_data);
+			tile_data += get_film_tile_data_size(*dr.film, tile);
+			for (int32 y = tile.left_bottom.y; y <= tile.right_top.y; y++)
+			{
+				resolve_film_row(*dr.film, *dr.texture, tile.left_bottom.x, y, tile.right_top.x - tile.left_bottom.x + 1);
+			}
+		}
+		interlocked_add_i64(&dr.ray_casts, result.ray_casts);
+		interlocked_add_i32(&dr.tiles_done, (int32)no_tiles);
+	}
+	if (data)
+	{
+		pl_buffer_free(data);
+	}
+	pl_buffer_free(tiles);
+	return success;
+}
+
+//One thread per worker, feeding it ranges till all of them are done
+static void worker_link_thread(void* data)
+{
+	WorkerLink& link = *(WorkerLink*)data;
+	DistributedRender& dr = *link.render;
+
+	WorkerReady ready = {};
+	if (!pl_read_from_pipe(link.process.output_pipe, &ready, sizeof(ready)) || ready.magic != WORKER_MESSAGE_MAGIC || !ready.loaded)
+	{
+		link.died = TRUE;
+		interlocked_decrement_i32(&dr.workers_alive);
+		return;
+	}
+	link.ready = TRUE;
+
+	while (dr.ranges_done < (int32)dr.no_ranges)
+	{
+		int32 range = take_pending_range(dr);
+		if (range == -1)
+		{
+			//the rest are being rendered, but one of them can still come back from a worker that dies
+			pl_sleep_thread(1);
+			continue;
+		}
+		if (!render_range_on_worker(link, dr, range))
+		{
+			interlocked_exchange_i32(&dr.range_states[range], TILE_RANGE_PENDING);
+			link.died = TRUE;
+			interlocked_decrement_i32(&dr.workers_alive);
+			return;
+		}
+		interlocked_exchange_i32(&dr.range_states[range], TILE_RANGE_DONE);
+		interlocked_increment_i32(&dr.ranges_done);
+	}
+	TileRangeRequest quit = { 0 };
+	pl_write_to_pipe(link.process.input_pipe, &quit, sizeof(quit));
+}
+
+static b32 append_to_command_line(char* command_line, uint32& length, const char* arg, b32 quote)
+{
+	uint32 arg_length = 0;
+	while (arg[arg_length] != 0)
+	{
+		arg_length++;
+	}
+	if (length + arg_length + 4 > WORKER_COMMAND_LINE_SIZE)
+	{
+		return FALSE;
+	}
+	if (length > 0)
+	{
+		command_line[length++] = ' ';
+	}
+	if (quote)
+	{
+		command_line[length++] = '"';
+	}
+	pl_buffer_copy(command_line + length, (void*)arg, arg_length);
+	length += arg_length;
+	if (quote)
+	{
+		command_line[length++] = '"';
+	}
+	command_line[length] = 0;
+	return TRUE;
+}
+
+//The coordinator's command line with what only the coordinator does taken out, and --worker --threads n added
+static b32 make_worker_command_line(PL& pl, BatchRenderOptions& options, uint32 worker_threads, char* command_line)
+{
+	uint32 length = 0;
+	command_line[0] = 0;
+	b32 success = options.worker_command ? append_to_command_line(command_line, length, options.worker_command, FALSE)
+		: append_to_command_line(command_line, length, pl.argv[0], TRUE);
+
+	const char* coordinator_args[] = { "--workers", "--worker-command", "--output", "--stats", "--threads" };
+	for (int32 i = 1; i < pl.argc && success; i++)
+	{
+		b32 skip = FALSE;
+		for (uint32 j = 0; j < ArrayCount(coordinator_args) && !skip; j++)
+		{
+			const char* a = pl.argv[i];
+			const char* b = coordinator_args[j];
+			while (*a && *a == *b)
+			{
+				a++;
+				b++;
+			}
+			skip = *a == *b;
+		}
+		if (skip)
+		{
+			i++;	//and its value
+			continue;
+		}
+		success = append_to_command_line(command_line, length, pl.argv[i], TRUE);
+	}
+
+	char threads[16];
+	pl_format_print(threads, sizeof(threads), "%u", worker_threads);
+	return success && append_to_command_line(command_line, length, "--worker", FALSE)
+		&& append_to_command_line(command_line, length, "--threads", FALSE)
+		&& append_to_command_line(command_line, length, threads, FALSE);
+}
+
+int32 run_distributed_render(PL& pl, BatchRenderOptions& options)
+{
+	f64 start_time = get_seconds(pl.time);
+	uint32 worker_threads = options.threads ? options.threads : max(pl.core_count / options.workers, 1u);
+
+	char* command_line = (char*)pl_buffer_alloc(WORKER_COMMAND_LINE_SIZE);
+	if (!make_worker_command_line(pl, options, worker_threads, command_line))
+	{
+		pl_print("Command line is too long for the workers\n");
+		pl_buffer_free(command_line);
+		return 1;
+	}
+
+	Texture patch = {};
+	if (options.patch_path && !load_patch_image(options, patch))
+	{
+		pl_buffer_free(command_line);
+		return 1;
+	}
+	RenderSettings rs;
+	set_batch_render_settings(rs, options);
+
+	Texture texture;
+	Setup_Texture(texture, TextureFileType::BMP, options.width, options.height);
+	Film film;
+	setup_film(film, options.width, options.height, options.denoise ? AOV_DENOISE_GUIDES : AOV_NONE);
+
+	//NOTE: the same tiles a single process with all the workers' threads would render. A range is a tile per worker thread,
+	//so every thread of a worker has a tile to start with (the row splitting of the renderer evens out the rest).
+	DistributedRender dr = {};
+	dr.film = &film;
+	dr.texture = &texture;
+	make_render_tiles(dr.tiles, options.width, options.height, options.workers * worker_threads, rs.tile_order);
+	if (options.has_region)
+	{
+		Tile region = get_batch_render_region(options);
+		crop_render_tiles(dr.tiles, region);
+	}
+	dr.tiles_per_range = worker_threads;
+	dr.no_ranges = (dr.tiles.size + dr.tiles_per_range - 1) / dr.tiles_per_range;
+	dr.range_states = (volatile int32*)pl_buffer_alloc(dr.no_ranges * sizeof(int32));	//all TILE_RANGE_PENDING
+
+	pl_print("Rendering %s at %ux%u, %u spp, %u workers x %u threads...\n", options.scene_path, options.width, options.height,
+		options.samples_per_pixel, options.workers, worker_threads);
+	dr.workers.allocate(options.workers);
+	for (uint32 i = 0; i < options.workers; i++)
+	{
+		WorkerLink& link = dr.workers[i];
+		link.render = &dr;
+		if (!pl_create_process(&link.process, command_line))
+		{
+			pl_print("Couldn't start worker %u: %s\n", i, command_line);
+			link.died = TRUE;
+			link.reported = TRUE;
+			continue;
+		}
+		dr.workers_alive++;
+		link.thread = pl_create_thread(worker_link_thread, &link);
+	}
+	pl_buffer_free(command_line);
+	//NOTE: workers load and prep the scene themselves, so that's part of the render time
+	f64 prep_time = get_seconds(pl.time);
+
+	f64 last_progress_time = prep_time;
+	while (dr.ranges_done < (int32)dr.no_ranges && dr.workers_alive > 0)
+	{
+		pl_sleep_thread(DISTRIBUTED_POLL_INTERVAL_MS);
+		for (uint32 i = 0; i < options.workers; i++)
+		{
+			WorkerLink& link = dr.workers[i];
+			if (link.died && !link.reported)
+			{
+				link.reported = TRUE;
+				pl_print(link.ready ? "	Worker %u died. Its tiles go to the other workers.\n" : "	Worker %u didn't start or couldn't load the scene.\n", i);
+			}
+		}
+		if (get_seconds(pl.time) - last_progress_time >= DISTRIBUTED_PROGRESS_INTERVAL)
+		{
+			last_progress_time = pl.time.fcurrent_seconds;
+			pl_print("	Tiles %i/%i | Workers %i/%u\n", dr.tiles_done, dr.tiles.size, dr.workers_alive, options.workers);
+		}
+	}
+	b32 finished = dr.ranges_done == (int32)dr.no_ranges;
+
+	//NOTE: every link thread returns once all ranges are done (after sending its worker quit) or its worker died
+	BatchRenderStats stats = {};
+	stats.workers = options.workers;
+	for (uint32 i = 0; i < options.workers; i++)
+	{
+		WorkerLink& link = dr.workers[i];
+		if (link.process.process_handle)
+		{
+			pl_wait_for_thread(&link.thread, UINT32MAX);
+			pl_close_thread(&link.thread);
+			pl_close_process(&link.process);
+		}
+		stats.workers_lost += link.died;
+	}
+
+	int32 exit_code = 1;
+	if (finished)
+	{
+		JobSystem job_system;
+		start_job_system(job_system, pl.core_count);
+		stats.threads = (options.workers - stats.workers_lost) * worker_threads;
+		stats.tiles = dr.tiles.size;
+		uint32 max_samples = get_max_samples_per_pixel(rs);
+		stats.passes = (max_samples + (rs.samples_per_pass ? rs.samples_per_pass : max_samples) - 1) / (rs.samples_per_pass ? rs.samples_per_pass : max_samples);
+		stats.ray_casts = dr.ray_casts;
+		stats.start_time = start_time;
+		stats.load_time = start_time;
+		stats.prep_time = prep_time;
+		stats.render_time = get_seconds(pl.time);
+		exit_code = finish_batch_render(pl, options, rs, film, texture, options.patch_path ? &patch : 0, dr.tiles, stats, job_system);
+		stop_job_system(job_system);
+	}
+	else
+	{
+		pl_print("All workers died. %i/%i tiles were rendered, no image was written.\n", dr.tiles_done, dr.tiles.size);
+	}
+
+	dr.workers.clear();
+	pl_buffer_free((void*)dr.range_states);
+	dr.tiles.clear();
+	free_film(film);
+	pl_buffer_free(texture.bmb.buffer_memory);
+	if (patch.bmb.buffer_memory)
+	{
+		pl_buffer_free(patch.bmb.buffer_memory);
+	}
+	return exit_code;
+}
+//----</Coordinator>----
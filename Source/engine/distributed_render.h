@@ -0,0 +1,19 @@
+#pragma once
+#include "batch_render.h"
+
+//Batch render split between worker processes (--workers n). The coordinator starts the workers with the same command line
+//plus --worker, and talks to each of them through its standard input/output:
+//	worker -> coordinator: WorkerReady once the scene is loaded and prepped
+//	coordinator -> worker: a range of tiles to render (0 tiles: quit)
+//	worker -> coordinator: the film data of the tiles (see pack_film_tile)
+//Ranges are handed out as workers finish the previous one. If a worker dies, its range goes back to be rendered by another.
+//NOTE: samples are seeded from the pixel, so the image is the same whichever worker renders a tile (and the same as a
+//single process render with the same tiles).
+//--worker-command can start the workers through anything that forwards standard input/output (ex: ssh to another node).
+
+//Coordinator. Returns the process exit code.
+int32 run_distributed_render(PL& pl, BatchRenderOptions& options);
+
+//Worker. Renders the tile ranges it's sent till the coordinator says to quit or closes the pipe. Returns the process exit code.
+//NOTE: standard output is the pipe to the coordinator, so nothing else can be printed to it.
+int32 run_render_worker(PL& pl, BatchRenderOptions& options);
@@ -0,0 +1,299 @@
+#include "partial_film.h"
+#include "renderer/denoiser.h"
+
+b32 write_partial_film(const char* path, Film& film, PartialFilmHeader& header, Tile* tiles)
+{
+	header.magic = PARTIAL_FILM_MAGIC;
+	header.version = PARTIAL_FILM_VERSION;
+	header.width = film.width;
+	header.height = film.height;
+	header.aovs = film.aovs;
+
+	void* file;
+	if (!pl_create_or_overwrite_file(&file, (char*)path))
+	{
+		return FALSE;
+	}
+	b32 written = pl_append_to_file(file, &header, sizeof(header)) && pl_append_to_file(file, tiles, header.no_tiles * sizeof(Tile));
+	uint32 max_data_size = 0;
+	for (uint32 i = 0; i < header.no_tiles; i++)
+	{
+		max_data_size = max(max_data_size, get_film_tile_data_size(film, tiles[i]));
+	}
+	uint8* data = (uint8*)pl_buffer_alloc(max_data_size);
+	for (uint32 i = 0; i < header.no_tiles && written; i++)
+	{
+		pack_film_tile(film, tiles[i], data);
+		written = pl_append_to_file(file, data, get_film_tile_data_size(film, tiles[i]));
+	}
+	pl_buffer_free(data);
+	pl_close_file_handle(file);
+	return written;
+}
+
+struct PartialFilmInput
+{
+	const char* path;
+	PartialFilmHeader header;
+};
+
+static b32 read_partial_film_header(const char* path, PartialFilmHeader& header)
+{
+	void* file;
+	if (!pl_get_file_handle((char*)path, &file))
+	{
+		return FALSE;
+	}
+	b32 read = pl_get_file_size(file) >= sizeof(header) && pl_load_file_into(file, &header, sizeof(header));
+	pl_close_file_handle(file);
+	return read && header.magic == PARTIAL_FILM_MAGIC && header.version == PARTIAL_FILM_VERSION && header.width > 0 && header.height > 0;
+}
+
+//Loads the whole file and checks its size against its tiles. Returns 0 if it's not a valid partial film for film.
+static uint8* load_partial_film(const char* path, Film& film)
+{
+	void* file;
+	if (!pl_get_file_handle((char*)path, &file))
+	{
+		return 0;
+	}
+	uint64 file_size = pl_get_file_size(file);
+	uint8* contents = 0;
+	if (file_size >= sizeof(PartialFilmHeader) && file_size <= UINT32MAX)
+	{
+		contents = (uint8*)pl_buffer_alloc(file_size);
+		if (!pl_load_file_into(file, contents, (uint32)file_size))
+		{
+			pl_buffer_free(contents);
+			contents = 0;
+		}
+	}
+	pl_close_file_handle(file);
+	if (!contents)
+	{
+		return 0;
+	}
+
+	PartialFilmHeader& header = *(PartialFilmHeader*)contents;
+	uint64 expected_size = sizeof(PartialFilmHeader) + (uint64)header.no_tiles * sizeof(Tile);
+	b32 valid = expected_size <= file_size;
+	Tile* tiles = (Tile*)(contents + sizeof(PartialFilmHeader));
+	for (uint32 i = 0; i < header.no_tiles && valid; i++)
+	{
+		Tile& tile = tiles[i];
+		valid = tile.left_bottom.x >= 0 && tile.left_bottom.y >= 0 && tile.left_bottom.x <= tile.right_top.x && tile.left_bottom.y <= tile.right_top.y
+			&& tile.right_top.x < (int32)film.width && tile.right_top.y < (int32)film.height;
+		expected_size += valid ? get_film_tile_data_size(film, tile) : 0;
+	}
+	if (!valid || expected_size != file_size)
+	{
+		pl_buffer_free(contents);
+		return 0;
+	}
+	return contents;
+}
+
+b32 read_partial_film(const char* path, Film& film, PartialFilmHeader& header)
+{
+	if (!read_partial_film_header(path, header) || header.width != film.width || header.height != film.height || header.aovs != film.aovs)
+	{
+		return FALSE;
+	}
+	uint8* contents = load_partial_film(path, film);
+	if (!contents)
+	{
+		return FALSE;
+	}
+	Tile* tiles = (Tile*)(contents + sizeof(PartialFilmHeader));
+	uint8* data = (uint8*)(tiles + header.no_tiles);
+	for (uint32 i = 0; i < header.no_tiles; i++)
+	{
+		unpack_film_tile(film, tiles[i], data);
+		data += get_film_tile_data_size(film, tiles[i]);
+	}
+	pl_buffer_free(contents);
+	return TRUE;
+}
+
+int32 run_partial_film_merge(PL& pl, BatchRenderOptions& options)
+{
+	f64 start_time = get_seconds(pl.time);
+	uint32 no_inputs = options.merge_paths.size;
+	if (no_inputs == 0)
+	{
+		pl_print("Nothing to merge. Pass the partial films after --merge.\n");
+		return 1;
+	}
+
+	FDBuffer<PartialFilmInput, uint32> inputs;
+	inputs.allocate(no_inputs);
+	for (uint32 i = 0; i < no_inputs; i++)
+	{
+		inputs[i].path = options.merge_paths[i];
+		if (!read_partial_film_header(inputs[i].path, inputs[i].header))
+		{
+			pl_print("Not a partial film: %s\n", inputs[i].path);
+			inputs.clear();
+			return 1;
+		}
+		PartialFilmHeader& first = inputs[0].header;
+		PartialFilmHeader& header = inputs[i].header;
+		if (header.width != first.width || header.height != first.height || header.aovs != first.aovs || header.seed != first.seed || header.frame != first.frame
+			|| header.render_hash != first.render_hash)
+		{
+			pl_print("%s is from a different render than %s (resolution, AOVs, seed, frame, scene, camera or render settings)\n", inputs[i].path, inputs[0].path);
+			inputs.clear();
+			return 1;
+		}
+	}
+
+	//NOTE: sorted by first sample (insertion sort, stable), as float sums of a pixel depend on the order. Partials with the
+	//same first sample can't share pixels (checked below), so their order doesn't matter.
+	for (uint32 i = 1; i < no_inputs; i++)
+	{
+		PartialFilmInput input = inputs[i];
+		int32 j = (int32)i - 1;
+		while (j >= 0 && inputs[j].header.first_sample > input.header.first_sample)
+		{
+			inputs[j + 1] = inputs[j];
+			j--;
+		}
+		inputs[j + 1] = input;
+	}
+
+	PartialFilmHeader& first = inputs[0].header;
+	uint32 width = first.width;
+	uint32 height = first.height;
+	Film film;
+	setup_film(film, width, height, first.aovs);
+	clear_film(film);
+	Film partial;
+	setup_film(partial, width, height, first.aovs);
+	//next sample index every pixel needs, so overlapping or missing sample ranges are caught
+	FDBuffer<uint32, uint32> next_sample;
+	next_sample.allocate(width * height);
+	pl_buffer_set(next_sample.front, 0xFF, next_sample.size * sizeof(uint32));	//no samples yet
+
+	b32 success = TRUE;
+	int64 ray_casts = 0;
+	uint32 end_sample = 0;
+	for (uint32 i = 0; i < no_inputs && success; i++)
+	{
+		uint8* contents = load_partial_film(inputs[i].path, partial);
+		if (!contents)
+		{
+			pl_print("%s is truncated or corrupt\n", inputs[i].path);
+			success = FALSE;
+			break;
+		}
+		PartialFilmHeader& header = *(PartialFilmHeader*)contents;
+		Tile* tiles = (Tile*)(contents + sizeof(PartialFilmHeader));
+		uint8* data = (uint8*)(tiles + header.no_tiles);
+		for (uint32 t = 0; t < header.no_tiles && success; t++)
+		{
+			Tile& tile = tiles[t];
+			for (int32 y = tile.left_bottom.y; y <= tile.right_top.y && success; y++)
+			{
+				for (int32 x = tile.left_bottom.x; x <= tile.right_top.x; x++)
+				{
+					uint32& next = next_sample[y * width + x];
+					uint32 expected = next == UINT32MAX ? first.first_sample : next;
+					if (header.first_sample != expected)
+					{
+						pl_print(header.first_sample < expected ? "%s has samples of pixel [%i,%i] that another partial film already has\n"
+							: "%s starts at a later sample than pixel [%i,%i] has (some samples are missing)\n", inputs[i].path, x, y);
+						success = FALSE;
+						break;
+					}
+					next = header.first_sample + header.no_samples;
+				}
+			}
+			if (success)
+			{
+				unpack_film_tile(partial, tile, data);
+				add_film_tile(film, partial, tile);
+				data += get_film_tile_data_size(partial, tile);
+			}
+		}
+		ray_casts += header.ray_casts;
+		end_sample = max(end_sample, header.first_sample + header.no_samples);
+		pl_buffer_free(contents);
+	}
+
+	uint32 missing_pixels = 0;
+	for (uint32 i = 0; i < next_sample.size && success; i++)
+	{
+		missing_pixels += next_sample[i] != end_sample;
+	}
+	if (success && missing_pixels)
+	{
+		pl_print("%u pixels don't have all samples %u-%u. Partial films are missing.\n", missing_pixels, first.first_sample, end_sample - 1);
+		success = FALSE;
+	}
+
+	int32 exit_code = 1;
+	if (success)
+	{
+		Texture texture;
+		Setup_Texture(texture, TextureFileType::BMP, width, height);
+		resolve_film(film, texture);
+		b32 denoised = options.denoise && (film.aovs & AOV_DENOISE_GUIDES) == AOV_DENOISE_GUIDES;
+		if (options.denoise && !denoised)
+		{
+			pl_print("Partial films don't have the denoise guides (render them with --denoise). Writing the noisy image.\n");
+		}
+		if (denoised)
+		{
+			JobSystem job_system;
+			start_job_system(job_system, options.threads ? options.threads : pl.core_count);
+			DenoiseSettings ds;
+			denoise_film(film, texture, ds, job_system);
+			stop_job_system(job_system);
+		}
+		b32 written = Write_To_Path(texture, options.output_path);
+		pl_buffer_free(texture.bmb.buffer_memory);
+
+		//all of the merged film as a single tile, for merging it again with other samples
+		if (options.partial_path)
+		{
+			PartialFilmHeader merged = first;
+			merged.no_samples = end_sample - first.first_sample;
+			merged.no_tiles = 1;
+			merged.ray_casts = ray_casts;
+			Tile whole = {};
+			whole.right_top = { (int32)width - 1, (int32)height - 1 };
+			if (!write_partial_film(options.partial_path, film, merged, &whole))
+			{
+				pl_print("Couldn't write the merged partial film to %s\n", options.partial_path);
+				written = FALSE;
+			}
+		}
+
+		uint64 total_samples = 0;
+		for (uint32 i = 0; i < film.sample_count.size; i++)
+		{
+			total_samples += film.sample_count[i];
+		}
+		pl_print(
+			"Merged: %u partial films\n"
+			"Output: %s%s\n"
+			"Resolution: %ux%u\n"
+			"Samples: %u-%u | Mean: %.2f\n"
+			"Seed: %u | Frame: %u | Denoised: %s\n"
+			"Rays: %lld\n"
+			"Total: %.3f s\n",
+			no_inputs, options.output_path, written ? "" : " (FAILED TO WRITE)",
+			width, height,
+			first.first_sample, end_sample - 1, (f64)total_samples / (f64)film.sample_count.size,
+			first.seed, first.frame, denoised ? "yes" : "no",
+			ray_casts,
+			get_seconds(pl.time) - start_time);
+		exit_code = written ? 0 : 1;
+	}
+
+	next_sample.clear();
+	free_film(partial);
+	free_film(film);
+	inputs.clear();
+	return exit_code;
+}
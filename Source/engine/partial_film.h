@@ -0,0 +1,46 @@
+#pragma once
+#include "batch_render.h"
+
+//Frame sharding: a batch render can do only some tiles (--tiles first-last) and/or some samples (--samples first-last)
+//of a frame, and write what it rendered to a partial film file (--partial) instead of an image. --merge adds the partial
+//films of a frame together and writes the image. Every shard is an independent job that can be retried on its own.
+//
+//	ATRay --headless [render options] --tiles 0-99 --samples 0-31 --partial frame_a.partial
+//	ATRay --headless --merge frame_a.partial frame_b.partial ... [--denoise] [--output image.bmp] [--partial merged.partial]
+//
+//NOTE: tiles are indices into the layout of make_render_tiles for --tile-layout threads (DEFAULT_SHARD_TILE_LAYOUT),
+//in the tile order of the render settings. --count-tiles prints how many there are.
+//The merge adds partials in order of their first sample, so the same partials always give the same image.
+//Tile shards give the same image as a single render; splitting samples only changes the float rounding of the sums.
+
+#define DEFAULT_SHARD_TILE_LAYOUT 16
+#define PARTIAL_FILM_MAGIC 0x46505441	//"ATPF"
+#define PARTIAL_FILM_VERSION 2
+
+//Followed by no_tiles Tiles, then the packed film data (see pack_film_tile) of every tile
+struct PartialFilmHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint32 width;
+	uint32 height;
+	uint32 aovs;			//AOV_Flags of the film
+	uint32 seed;
+	uint32 frame;
+	uint32 first_sample;	//the tiles have samples [first_sample, first_sample + no_samples) of their pixels
+	uint32 no_samples;		//with adaptive sampling, pixels can have fewer
+	uint32 no_tiles;
+	uint32 render_hash;		//scene, camera and render settings. Only partials of the same render can be merged.
+	uint32 tiles_hash;		//--tiles and --region. A checkpoint is only resumed by a render of the same tiles.
+	int64 ray_casts;
+};
+
+//Writes the tiles of film to path (overwritten). Returns FALSE if the file couldn't be written.
+b32 write_partial_film(const char* path, Film& film, PartialFilmHeader& header, Tile* tiles);
+
+//Overwrites the pixels of film with the tiles of the partial film at path. Returns FALSE if the file can't be read or
+//isn't a partial film of the same size and AOVs as film (film is left as it was then).
+b32 read_partial_film(const char* path, Film& film, PartialFilmHeader& header);
+
+//Merges options.merge_paths into an image. Returns the process exit code.
+int32 run_partial_film_merge(PL& pl, BatchRenderOptions& options);
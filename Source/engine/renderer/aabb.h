@@ -4,16 +4,12 @@
 
 struct AABB
 {
-    union 
-    {
-        vec3f bounds[2];
-        struct
-        {
-            //NOTE:dont change order. ray_aabb_intersection uses bounds as optimization.
-            vec3f min;
-            vec3f max;
-        };
-    };
+	//NOTE:dont change order. ray_aabb_intersection uses bounds as optimization.
+	//(not a union with vec3f bounds[2]: vec3f has default member initializers, which GCC/Clang don't allow in anonymous structs)
+	vec3f min;
+	vec3f max;
+
+	FORCEDINLINE vec3f& bounds(int32 i) { return (&min)[i]; }	//0 is min, 1 is max
 };
 
 static inline b8 is_inside(vec3f point, AABB box)
@@ -26,15 +22,49 @@ static inline b8 is_inside(vec3f point, AABB box)
 	return(x_check && y_check && z_check);
 }
 
+static inline AABB get_surrounding_AABB(AABB& a, AABB& b)
+{
+	AABB ret;
+	ret.min = { min(a.min.x, b.min.x), min(a.min.y, b.min.y), min(a.min.z, b.min.z) };
+	ret.max = { max(a.max.x, b.max.x), max(a.max.y, b.max.y), max(a.max.z, b.max.z) };
+	return ret;
+}
+
+static inline f32 get_surface_area(AABB& box)
+{
+	vec3f d = box.max - box.min;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+//Returns TRUE if ray enters box before t_max. t_entry is set to the entry distance (0 if ray origin is inside box).
+//NOTE: unlike get_ray_AABB_intersection, this doesn't return the exit distance when inside, so it can be used to cull nodes against the closest hit.
+static inline b32 get_ray_AABB_entry_distance(Optimized_Ray& r, AABB& bb, f32 t_max, f32& t_entry)
+{
+	f32 tmin, tmax, tymin, tymax, tzmin, tzmax;
+
+	tmin = (bb.bounds(r.inv_signs[0]).x - r.ray.origin.x) * r.inv_ray_d.x;
+	tmax = (bb.bounds(1 - r.inv_signs[0]).x - r.ray.origin.x) * r.inv_ray_d.x;
+	tymin = (bb.bounds(r.inv_signs[1]).y - r.ray.origin.y) * r.inv_ray_d.y;
+	tymax = (bb.bounds(1 - r.inv_signs[1]).y - r.ray.origin.y) * r.inv_ray_d.y;
+	tzmin = (bb.bounds(r.inv_signs[2]).z - r.ray.origin.z) * r.inv_ray_d.z;
+	tzmax = (bb.bounds(1 - r.inv_signs[2]).z - r.ray.origin.z) * r.inv_ray_d.z;
+
+	tmin = max(max(tmin, tymin), max(tzmin, 0.0f));
+	tmax = min(min(tmax, tymax), min(tzmax, t_max));
+
+	t_entry = tmin;
+	return (tmin <= tmax);
+}
+
 static inline f32 get_ray_AABB_intersection(Optimized_Ray& r, AABB& bb)
 {
 	//optimized version 
 	f32 tmin, tmax, tymin, tymax, tzmin, tzmax;
 
-	tmin = (bb.bounds[r.inv_signs[0]].x - r.ray.origin.x) * r.inv_ray_d.x;
-	tmax = (bb.bounds[1 - r.inv_signs[0]].x - r.ray.origin.x) * r.inv_ray_d.x;
-	tymin = (bb.bounds[r.inv_signs[1]].y - r.ray.origin.y) * r.inv_ray_d.y;
-	tymax = (bb.bounds[1 - r.inv_signs[1]].y - r.ray.origin.y) * r.inv_ray_d.y;
+	tmin = (bb.bounds(r.inv_signs[0]).x - r.ray.origin.x) * r.inv_ray_d.x;
+	tmax = (bb.bounds(1 - r.inv_signs[0]).x - r.ray.origin.x) * r.inv_ray_d.x;
+	tymin = (bb.bounds(r.inv_signs[1]).y - r.ray.origin.y) * r.inv_ray_d.y;
+	tymax = (bb.bounds(1 - r.inv_signs[1]).y - r.ray.origin.y) * r.inv_ray_d.y;
 
 	if ((tmin > tymax) || (tymin > tmax))
 		return 0;
@@ -43,8 +73,8 @@ static inline f32 get_ray_AABB_intersection(Optimized_Ray& r, AABB& bb)
 	if (tymax < tmax)
 		tmax = tymax;
 
-	tzmin = (bb.bounds[r.inv_signs[2]].z - r.ray.origin.z) * r.inv_ray_d.z;
-	tzmax = (bb.bounds[1 - r.inv_signs[2]].z - r.ray.origin.z) * r.inv_ray_d.z;
+	tzmin = (bb.bounds(r.inv_signs[2]).z - r.ray.origin.z) * r.inv_ray_d.z;
+	tzmax = (bb.bounds(1 - r.inv_signs[2]).z - r.ray.origin.z) * r.inv_ray_d.z;
 
 	if ((tmin > tzmax) || (tzmin > tmax))
 		return 0;
@@ -67,10 +97,10 @@ static inline b32 check_ray_AABB_intersection(Optimized_Ray& r, AABB& bb)
 	//optimized version 
 	float tmin, tmax, tymin, tymax, tzmin, tzmax;
 
-	tmin = (bb.bounds[r.inv_signs[0]].x - r.ray.origin.x) * r.inv_ray_d.x;
-	tmax = (bb.bounds[1 - r.inv_signs[0]].x - r.ray.origin.x) * r.inv_ray_d.x;
-	tymin = (bb.bounds[r.inv_signs[1]].y - r.ray.origin.y) * r.inv_ray_d.y;
-	tymax = (bb.bounds[1 - r.inv_signs[1]].y - r.ray.origin.y) * r.inv_ray_d.y;
+	tmin = (bb.bounds(r.inv_signs[0]).x - r.ray.origin.x) * r.inv_ray_d.x;
+	tmax = (bb.bounds(1 - r.inv_signs[0]).x - r.ray.origin.x) * r.inv_ray_d.x;
+	tymin = (bb.bounds(r.inv_signs[1]).y - r.ray.origin.y) * r.inv_ray_d.y;
+	tymax = (bb.bounds(1 - r.inv_signs[1]).y - r.ray.origin.y) * r.inv_ray_d.y;
 
 	if ((tmin > tymax) || (tymin > tmax))
 		return FALSE;
@@ -79,8 +109,8 @@ static inline b32 check_ray_AABB_intersection(Optimized_Ray& r, AABB& bb)
 	if (tymax < tmax)
 		tmax = tymax;
 
-	tzmin = (bb.bounds[r.inv_signs[2]].z - r.ray.origin.z) * r.inv_ray_d.z;
-	tzmax = (bb.bounds[1 - r.inv_signs[2]].z - r.ray.origin.z) * r.inv_ray_d.z;
+	tzmin = (bb.bounds(r.inv_signs[2]).z - r.ray.origin.z) * r.inv_ray_d.z;
+	tzmax = (bb.bounds(1 - r.inv_signs[2]).z - r.ray.origin.z) * r.inv_ray_d.z;
 
 	if ((tmin > tzmax) || (tzmin > tmax))
 		return FALSE;/*
@@ -0,0 +1,112 @@
+#pragma once
+#include "material.h"
+#include "sampling.h"
+
+//Every material is a mix of a lambertian (diffuse) lobe and a GGX (glossy) lobe, both tinted by reflection_color.
+//scatter is the fraction of the glossy lobe, and also how smooth it is (scatter 1 is a mirror).
+//NOTE: wo points away from the surface (towards where the ray came from), wi towards where light comes from.
+//		normal is expected to face wo.
+
+#define GGX_MIN_ALPHA 0.001f	//keeps mirrors (scatter == 1) from dividing by 0
+
+struct BSDF_Sample
+{
+	vec3f direction;
+	vec3f weight;	//bsdf * cos / pdf. What the path weight gets multiplied by.
+	f32 pdf;		//solid angle pdf of direction (both lobes)
+};
+
+FORCEDINLINE f32 get_glossy_probability(Material& material)
+{
+	return min(max(material.scatter, 0.0f), 1.0f);
+}
+
+FORCEDINLINE f32 get_ggx_alpha(Material& material)
+{
+	f32 roughness = 1.0f - get_glossy_probability(material);
+	return max(roughness * roughness, GGX_MIN_ALPHA);
+}
+
+//GGX normal distribution
+FORCEDINLINE f32 get_ggx_d(f32 cos_h, f32 alpha_sqr)
+{
+	f32 d = cos_h * cos_h * (alpha_sqr - 1.0f) + 1.0f;
+	return alpha_sqr / (PI32 * d * d);
+}
+
+//Smith masking for one direction
+FORCEDINLINE f32 get_ggx_g1(f32 cos_v, f32 alpha_sqr)
+{
+	f32 cos_sqr = cos_v * cos_v;
+	f32 tan_sqr = max(1.0f - cos_sqr, 0.0f) / cos_sqr;
+	return 2.0f / (1.0f + sqroot(1.0f + alpha_sqr * tan_sqr));
+}
+
+//Returns bsdf * cos(wi) and sets pdf to the pdf sample_bsdf would have picked wi with
+static inline vec3f evaluate_bsdf(Material& material, vec3f normal, vec3f wo, vec3f wi, f32& pdf)
+{
+	pdf = 0.0f;
+	f32 cos_i = dot(normal, wi);
+	f32 cos_o = dot(normal, wo);
+	if (cos_i <= 0.0f || cos_o <= 0.0f)
+	{
+		return { 0,0,0 };
+	}
+	f32 glossy = get_glossy_probability(material);
+
+	//diffuse
+	f32 value = (1.0f - glossy) * INV_PI32 * cos_i;
+	pdf = (1.0f - glossy) * get_cosine_hemisphere_pdf(cos_i);
+
+	//glossy
+	if (glossy > 0.0f)
+	{
+		vec3f h = wo + wi;
+		normalize(h);
+		f32 cos_h = dot(normal, h);
+		f32 wo_dot_h = dot(wo, h);
+		if (cos_h > 0.0f && wo_dot_h > 0.0f)
+		{
+			f32 alpha = get_ggx_alpha(material);
+			f32 alpha_sqr = alpha * alpha;
+			f32 d = get_ggx_d(cos_h, alpha_sqr);
+			f32 g = get_ggx_g1(cos_o, alpha_sqr) * get_ggx_g1(cos_i, alpha_sqr);
+			value += glossy * d * g / (4.0f * cos_o);	//(D * G / (4 * cos_o * cos_i)) * cos_i
+			pdf += glossy * d * cos_h / (4.0f * wo_dot_h);
+		}
+	}
+	return material.reflection_color * value;
+}
+
+//Picks a lobe with u_lobe and a direction in it with u1, u2. Returns FALSE if the direction is below the surface (path ends).
+static inline b32 sample_bsdf(Material& material, vec3f normal, vec3f wo, f32 u_lobe, f32 u1, f32 u2, BSDF_Sample& sample)
+{
+	f32 glossy = get_glossy_probability(material);
+	if (u_lobe < glossy)
+	{
+		//half vector from the GGX distribution (pdf D(h) * cos_h), reflected about it
+		f32 alpha = get_ggx_alpha(material);
+		f32 cos_h_sqr = (1.0f - u1) / (1.0f + (alpha * alpha - 1.0f) * u1);
+		f32 cos_h = sqroot(cos_h_sqr);
+		f32 sin_h = sqroot(max(1.0f - cos_h_sqr, 0.0f));
+		f32 phi = 2.0f * PI32 * u2;
+		vec3f tangent, bitangent;
+		make_orthonormal_basis(normal, tangent, bitangent);
+		vec3f h = tangent * (sin_h * fcos(phi)) + bitangent * (sin_h * fsin(phi)) + normal * cos_h;
+		sample.direction = h * (2.0f * dot(wo, h)) - wo;
+	}
+	else
+	{
+		sample.direction = sample_cosine_hemisphere(normal, u1, u2);
+	}
+	normalize(sample.direction);
+
+	//NOTE: evaluating both lobes (instead of just the picked one) so the pdf matches the one used for light samples
+	vec3f value = evaluate_bsdf(material, normal, wo, sample.direction, sample.pdf);
+	if (sample.pdf <= 0.0f)
+	{
+		return FALSE;
+	}
+	sample.weight = value / sample.pdf;
+	return TRUE;
+}
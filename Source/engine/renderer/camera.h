@@ -43,3 +43,25 @@ static inline void set_camera(Camera& cm, vec3f eye, vec3f facing_towards, Rende
 	cm.half_pixel_width = (0.5f * cm.h_fov) / (f32)render_settings.resolution.x;
 	cm.half_pixel_height = 0.5f / (f32)render_settings.resolution.y;
 }
+
+//Pixel of cm that sees along direction (from cm.eye). Returns FALSE if that's behind the camera or outside the image.
+//NOTE: inverse of how render_tile_row places pixels on the frame (pixel x at film x = -1 + 2x/width, scaled by the fov)
+static inline b32 get_camera_pixel(Camera& cm, vec3f direction, int32& x, int32& y)
+{
+	f32 forward = -dot(direction, cm.camera_z);
+	if (forward <= 0.0f)
+	{
+		return FALSE;
+	}
+	f32 film_x = dot(direction, cm.camera_x) / forward;
+	f32 film_y = dot(direction, cm.camera_y) / forward;
+	f32 pixel_x = (film_x / (cm.h_fov * cm.aspect_ratio) + 1.0f) * 0.5f * (f32)cm.render_settings.resolution.x + 0.5f;
+	f32 pixel_y = (film_y + 1.0f) * 0.5f * (f32)cm.render_settings.resolution.y + 0.5f;
+	if (pixel_x < 0.0f || pixel_y < 0.0f || pixel_x >= (f32)cm.render_settings.resolution.x || pixel_y >= (f32)cm.render_settings.resolution.y)
+	{
+		return FALSE;
+	}
+	x = (int32)pixel_x;
+	y = (int32)pixel_y;
+	return TRUE;
+}
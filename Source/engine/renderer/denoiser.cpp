@@ -0,0 +1,197 @@
+#include "denoiser.h"
+
+struct DenoiseContext
+{
+	Film* film;
+	Texture* texture;
+	DenoiseSettings* settings;
+
+	//guides, averaged over the samples of each pixel
+	FDBuffer<vec3f, uint32> albedo;
+	FDBuffer<vec3f, uint32> normal;
+	FDBuffer<f32, uint32> depth;
+
+	//color and variance are filtered back and forth between [0] and [1] every iteration
+	FDBuffer<vec3f, uint32> color[2];
+	FDBuffer<f32, uint32> variance[2];
+};
+
+struct DenoiseTileJob
+{
+	DenoiseContext* context;
+	uint32 min_x, min_y;
+	uint32 max_x, max_y;	//exclusive
+	uint32 iteration;
+};
+
+static void prepare_denoise_tile_job(void* payload)
+{
+	DenoiseTileJob& job = *(DenoiseTileJob*)payload;
+	DenoiseContext& ctx = *job.context;
+	Film& film = *ctx.film;
+	for (uint32 y = job.min_y; y < job.max_y; y++)
+	{
+		for (uint32 x = job.min_x; x < job.max_x; x++)
+		{
+			uint32 index = y * film.width + x;
+			uint32 n = film.sample_count[index];
+			if (n == 0)
+			{
+				continue;	//buffers are allocated zeroed
+			}
+			f32 inv_n = 1.0f / (f32)n;
+			ctx.color[0][index] = film.accumulated[index] * inv_n;
+			ctx.variance[0][index] = get_film_pixel_variance(film, index);
+			ctx.albedo[index] = film.albedo[index] * inv_n;
+			ctx.depth[index] = film.depth[index] * inv_n;
+			vec3f normal = film.normal[index];
+			if (mag2(normal) > 0.0f)
+			{
+				normalize(normal);
+			}
+			ctx.normal[index] = normal;
+		}
+	}
+}
+
+static const f32 b3_spline_kernel[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+static FORCEDINLINE f32 get_normal_weight(vec3f a, vec3f b, f32 power)
+{
+	b32 a_is_sky = mag2(a) == 0.0f;
+	b32 b_is_sky = mag2(b) == 0.0f;
+	if (a_is_sky || b_is_sky)
+	{
+		return a_is_sky == b_is_sky ? 1.0f : 0.0f;
+	}
+	return fpow(max(dot(a, b), 0.0f), power);
+}
+
+static void filter_denoise_tile_job(void* payload)
+{
+	DenoiseTileJob& job = *(DenoiseTileJob*)payload;
+	DenoiseContext& ctx = *job.context;
+	DenoiseSettings& ds = *ctx.settings;
+	uint32 width = ctx.film->width;
+	uint32 height = ctx.film->height;
+	uint32 src = job.iteration & 1;
+	uint32 dst = src ^ 1;
+	int32 step = 1 << job.iteration;
+	b32 last_iteration = job.iteration + 1 == ds.iterations;
+	f32 inv_albedo_sigma_sqr = 1.0f / (ds.albedo_sigma * ds.albedo_sigma);
+
+	for (uint32 y = job.min_y; y < job.max_y; y++)
+	{
+		for (uint32 x = job.min_x; x < job.max_x; x++)
+		{
+			uint32 p = y * width + x;
+			vec3f color_p = ctx.color[src][p];
+			f32 luminance_p = luminance(color_p);
+			f32 luminance_sigma = ds.color_sigma * sqroot(ctx.variance[src][p]) + 0.0001f;
+			vec3f normal_p = ctx.normal[p];
+			vec3f albedo_p = ctx.albedo[p];
+			f32 depth_p = ctx.depth[p];
+			f32 depth_sigma = ds.depth_sigma * depth_p * (f32)step + 0.0001f;
+
+			vec3f color_sum = { 0,0,0 };
+			f32 variance_sum = 0;
+			f32 weight_sum = 0;
+			for (int32 j = -2; j <= 2; j++)
+			{
+				int32 qy = (int32)y + j * step;
+				if (qy < 0 || qy >= (int32)height)
+				{
+					continue;
+				}
+				for (int32 i = -2; i <= 2; i++)
+				{
+					int32 qx = (int32)x + i * step;
+					if (qx < 0 || qx >= (int32)width)
+					{
+						continue;
+					}
+					uint32 q = qy * width + qx;
+					vec3f color_q = ctx.color[src][q];
+					f32 weight = b3_spline_kernel[i + 2] * b3_spline_kernel[j + 2];
+					if (q != p)
+					{
+						f32 luminance_diff = luminance_p - luminance(color_q);
+						luminance_diff = luminance_diff < 0 ? -luminance_diff : luminance_diff;
+						f32 depth_diff = depth_p - ctx.depth[q];
+						depth_diff = depth_diff < 0 ? -depth_diff : depth_diff;
+						weight *= get_normal_weight(normal_p, ctx.normal[q], ds.normal_power) *
+							fexp(-luminance_diff / luminance_sigma - depth_diff / depth_sigma - mag2(albedo_p - ctx.albedo[q]) * inv_albedo_sigma_sqr);
+					}
+					color_sum += color_q * weight;
+					variance_sum += ctx.variance[src][q] * weight * weight;
+					weight_sum += weight;
+				}
+			}
+			//NOTE: weight_sum can't be 0, the pixel itself always counts
+			ctx.color[dst][p] = color_sum / weight_sum;
+			if (!last_iteration)
+			{
+				ctx.variance[dst][p] = variance_sum / (weight_sum * weight_sum);
+			}
+		}
+		if (last_iteration)
+		{
+			uint32 row = y * width + job.min_x;
+			uint32* pixels = (uint32*)ctx.texture->bmb.buffer_memory + y * ctx.texture->bmb.width + job.min_x;
+			convert_radiance_to_bgra(ctx.film->display, &ctx.color[dst][row], 0, job.max_x - job.min_x, pixels);
+		}
+	}
+}
+
+//Runs proc as one job per tile and waits for all of them
+static void run_denoise_tiles(DenoiseContext& ctx, JobProc proc, uint32 iteration, JobSystem& job_system)
+{
+	JobCounter counter = {};
+	for (uint32 y = 0; y < ctx.film->height; y += DENOISE_TILE_SIZE)
+	{
+		for (uint32 x = 0; x < ctx.film->width; x += DENOISE_TILE_SIZE)
+		{
+			DenoiseTileJob job = { &ctx, x, y, min(x + DENOISE_TILE_SIZE, ctx.film->width), min(y + DENOISE_TILE_SIZE, ctx.film->height), iteration };
+			submit_job(job_system, proc, &job, sizeof(job), &counter);
+		}
+	}
+	wait_for_counter(job_system, counter);
+}
+
+void denoise_film(Film& film, Texture& texture, DenoiseSettings& settings, JobSystem& job_system)
+{
+	//NOTE: needs the guide AOVs. Film is just resolved without them.
+	if (settings.iterations == 0 || (film.aovs & AOV_DENOISE_GUIDES) != AOV_DENOISE_GUIDES)
+	{
+		resolve_film(film, texture);
+		return;
+	}
+	uint32 size = film.width * film.height;
+	DenoiseContext ctx = {};
+	ctx.film = &film;
+	ctx.texture = &texture;
+	ctx.settings = &settings;
+	ctx.albedo.allocate(size);
+	ctx.normal.allocate(size);
+	ctx.depth.allocate(size);
+	for (uint32 i = 0; i < 2; i++)
+	{
+		ctx.color[i].allocate(size);
+		ctx.variance[i].allocate(size);
+	}
+
+	run_denoise_tiles(ctx, prepare_denoise_tile_job, 0, job_system);
+	for (uint32 iteration = 0; iteration < settings.iterations; iteration++)
+	{
+		run_denoise_tiles(ctx, filter_denoise_tile_job, iteration, job_system);
+	}
+
+	ctx.albedo.clear();
+	ctx.normal.clear();
+	ctx.depth.clear();
+	for (uint32 i = 0; i < 2; i++)
+	{
+		ctx.color[i].clear();
+		ctx.variance[i].clear();
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "film.h"
+#include "engine/tools/job_system.h"
+
+//Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) over the film's averaged radiance, with the luminance
+//weight scaled by each pixel's variance like SVGF (Schied et al. 2017).
+//Every iteration is a 5x5 B3-spline blur with taps spread 2^iteration pixels apart. Neighbours only count if their
+//first hit albedo, normal and depth are close to the pixel's, so edges and texture detail aren't blurred away.
+//Iterations are run as a job per tile.
+
+#define DENOISE_TILE_SIZE 64
+
+struct DenoiseSettings
+{
+	uint32 iterations = 5;		//filter radius is 2^iterations pixels
+	f32 color_sigma = 4.0f;		//in standard deviations of the pixel's noise
+	f32 normal_power = 64.0f;	//higher keeps sharper creases
+	f32 depth_sigma = 0.05f;	//relative to the pixel's depth (per tap step)
+	f32 albedo_sigma = 0.1f;
+};
+
+//Denoises film and writes the result to texture. Film is left untouched.
+//Film needs the AOV_DENOISE_GUIDES AOVs.
+void denoise_film(Film& film, Texture& texture, DenoiseSettings& settings, JobSystem& job_system);
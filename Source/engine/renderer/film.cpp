@@ -0,0 +1,194 @@
+#include "film.h"
+#include "sampler.h"
+
+static FORCEDINLINE vec3f get_id_color(int32 id)
+{
+	if (id < 0)
+	{
+		return { 0,0,0 };
+	}
+	uint32 h = hash_u32((uint32)id + 1);	//id 0 would hash to black
+	return { (f32)(h & 0xFF) / 255.0f, (f32)((h >> 8) & 0xFF) / 255.0f, (f32)((h >> 16) & 0xFF) / 255.0f };
+}
+
+struct FilmBufferView
+{
+	uint8* front;
+	uint32 pixel_size;
+};
+
+//every buffer of the film that's allocated, in the order their pixels are packed
+static uint32 get_film_buffers(Film& film, FilmBufferView* buffers)
+{
+	uint32 count = 0;
+	buffers[count++] = { (uint8*)film.accumulated.front, sizeof(vec3f) };
+	buffers[count++] = { (uint8*)film.sample_count.front, sizeof(uint32) };
+	buffers[count++] = { (uint8*)film.luminance_sqr.front, sizeof(f32) };
+	if (film.aovs & AOV_DEPTH) buffers[count++] = { (uint8*)film.depth.front, sizeof(f32) };
+	if (film.aovs & AOV_NORMAL) buffers[count++] = { (uint8*)film.normal.front, sizeof(vec3f) };
+	if (film.aovs & AOV_ALBEDO) buffers[count++] = { (uint8*)film.albedo.front, sizeof(vec3f) };
+	if (film.aovs & AOV_POSITION) buffers[count++] = { (uint8*)film.position.front, sizeof(vec3f) };
+	if (film.aovs & AOV_OBJECT_ID) buffers[count++] = { (uint8*)film.object_id.front, sizeof(int32) };
+	if (film.aovs & AOV_FACE_ID) buffers[count++] = { (uint8*)film.face_id.front, sizeof(int32) };
+	return count;
+}
+
+#define MAX_FILM_BUFFERS 9
+
+uint32 get_film_tile_data_size(Film& film, Tile& tile)
+{
+	FilmBufferView buffers[MAX_FILM_BUFFERS];
+	uint32 no_buffers = get_film_buffers(film, buffers);
+	uint32 no_pixels = (tile.right_top.x - tile.left_bottom.x + 1) * (tile.right_top.y - tile.left_bottom.y + 1);
+	uint32 size = 0;
+	for (uint32 i = 0; i < no_buffers; i++)
+	{
+		size += no_pixels * buffers[i].pixel_size;
+	}
+	return size;
+}
+
+static void copy_film_tile(Film& film, Tile& tile, uint8* data, b32 pack)
+{
+	FilmBufferView buffers[MAX_FILM_BUFFERS];
+	uint32 no_buffers = get_film_buffers(film, buffers);
+	uint32 row_pixels = tile.right_top.x - tile.left_bottom.x + 1;
+	for (uint32 i = 0; i < no_buffers; i++)
+	{
+		uint32 row_size = row_pixels * buffers[i].pixel_size;
+		for (int32 y = tile.left_bottom.y; y <= tile.right_top.y; y++)
+		{
+			uint8* row = buffers[i].front + ((uint32)y * film.width + tile.left_bottom.x) * buffers[i].pixel_size;
+			if (pack)
+			{
+				pl_buffer_copy(data, row, row_size);
+			}
+			else
+			{
+				pl_buffer_copy(row, data, row_size);
+			}
+			data += row_size;
+		}
+	}
+}
+
+void pack_film_tile(Film& film, Tile& tile, uint8* data)
+{
+	copy_film_tile(film, tile, data, TRUE);
+}
+
+void unpack_film_tile(Film& film, Tile& tile, uint8* data)
+{
+	copy_film_tile(film, tile, data, FALSE);
+}
+
+void add_film_tile(Film& film, Film& from, Tile& tile)
+{
+	ASSERT(film.width == from.width && film.height == from.height && film.aovs == from.aovs);
+	for (int32 y = tile.left_bottom.y; y <= tile.right_top.y; y++)
+	{
+		for (int32 x = tile.left_bottom.x; x <= tile.right_top.x; x++)
+		{
+			uint32 i = y * film.width + x;
+			film.accumulated[i] += from.accumulated[i];
+			film.sample_count[i] += from.sample_count[i];
+			film.luminance_sqr[i] += from.luminance_sqr[i];
+			if (film.aovs & AOV_DEPTH) film.depth[i] += from.depth[i];
+			if (film.aovs & AOV_NORMAL) film.normal[i] += from.normal[i];
+			if (film.aovs & AOV_ALBEDO) film.albedo[i] += from.albedo[i];
+			if (film.aovs & AOV_POSITION) film.position[i] += from.position[i];
+			if ((film.aovs & AOV_OBJECT_ID) && film.object_id[i] == -1) film.object_id[i] = from.object_id[i];
+			if ((film.aovs & AOV_FACE_ID) && film.face_id[i] == -1) film.face_id[i] = from.face_id[i];
+		}
+	}
+}
+
+void resolve_film_aov(Film& film, AOV_Flags aov, Texture& texture)
+{
+	if (!(film.aovs & aov))
+	{
+		return;
+	}
+	uint32 size = film.width * film.height;
+
+	//used for scaling depth and positions
+	f64 depth_sum = 0;
+	uint32 no_depths = 0;
+	vec3f min_position = { MAX_FLOAT, MAX_FLOAT, MAX_FLOAT };
+	vec3f max_position = { -MAX_FLOAT, -MAX_FLOAT, -MAX_FLOAT };
+	for (uint32 i = 0; i < size && (aov == AOV_DEPTH || aov == AOV_POSITION); i++)
+	{
+		uint32 n = film.sample_count[i];
+		if (n == 0)
+		{
+			continue;
+		}
+		if (aov == AOV_DEPTH)
+		{
+			if (film.depth[i] > 0.0f)
+			{
+				depth_sum += film.depth[i] / (f32)n;
+				no_depths++;
+			}
+		}
+		else
+		{
+			vec3f p = film.position[i] / (f32)n;
+			min_position = { min(min_position.x, p.x), min(min_position.y, p.y), min(min_position.z, p.z) };
+			max_position = { max(max_position.x, p.x), max(max_position.y, p.y), max(max_position.z, p.z) };
+		}
+	}
+	f32 mean_depth = no_depths ? (f32)(depth_sum / (f64)no_depths) : 1.0f;
+	vec3f position_extent = max_position - min_position;
+	position_extent = { max(position_extent.x, 0.0001f), max(position_extent.y, 0.0001f), max(position_extent.z, 0.0001f) };
+
+	for (uint32 y = 0; y < film.height; y++)
+	{
+		for (uint32 x = 0; x < film.width; x++)
+		{
+			uint32 i = y * film.width + x;
+			uint32 n = film.sample_count[i];
+			f32 inv_n = n ? 1.0f / (f32)n : 0.0f;
+			vec3f color = { 0,0,0 };
+			switch (aov)
+			{
+			case AOV_DEPTH:
+			{
+				f32 depth = film.depth[i] * inv_n;
+				//NOTE: not scaled by max depth, as planes go on till the horizon. Mean depth maps to 0.5.
+				f32 value = depth > 0.0f ? mean_depth / (mean_depth + depth) : 0.0f;
+				color = { value, value, value };
+			} break;
+			case AOV_NORMAL:
+			{
+				vec3f normal = film.normal[i];
+				if (mag2(normal) > 0.0f)
+				{
+					normalize(normal);
+					color = normal * 0.5f + vec3f{ 0.5f, 0.5f, 0.5f };
+				}
+			} break;
+			case AOV_ALBEDO:
+			{
+				color = film.albedo[i] * inv_n;
+			} break;
+			case AOV_POSITION:
+			{
+				vec3f p = film.position[i] * inv_n - min_position;
+				color = { p.x / position_extent.x, p.y / position_extent.y, p.z / position_extent.z };
+			} break;
+			case AOV_OBJECT_ID:
+			{
+				color = get_id_color(film.object_id[i]);
+			} break;
+			case AOV_FACE_ID:
+			{
+				color = get_id_color(film.face_id[i]);
+			} break;
+			default:
+				break;
+			}
+			set_texture_pixel_from_linear(texture, x, y, color);
+		}
+	}
+}
@@ -0,0 +1,236 @@
+#pragma once
+#include "PL/PL_math.h"
+#include "PL/pl_utils.h"
+#include "engine/tools/texture.h"
+#include "tone_mapping.h"
+
+//Arbitrary output variables: optional per pixel buffers filled from the first hit of every camera ray (no extra rays).
+//Used for compositing and as denoiser guides.
+enum AOV_Flags : uint32
+{
+	AOV_NONE = 0,
+	AOV_DEPTH = 1 << 0,		//distance from the camera. 0 for the skybox.
+	AOV_NORMAL = 1 << 1,	//world space shading normal, facing the camera. 0 for the skybox.
+	AOV_ALBEDO = 1 << 2,	//reflection_color of the material (skybox gives its emission)
+	AOV_POSITION = 1 << 3,	//world space hit position. 0 for the skybox.
+	AOV_OBJECT_ID = 1 << 4,	//models, then spheres, then planes, in scene order. -1 for the skybox.
+	AOV_FACE_ID = 1 << 5,	//face index in the model. -1 if a model wasn't hit.
+
+	AOV_DENOISE_GUIDES = AOV_DEPTH | AOV_NORMAL | AOV_ALBEDO,
+	AOV_ALL = AOV_DEPTH | AOV_NORMAL | AOV_ALBEDO | AOV_POSITION | AOV_OBJECT_ID | AOV_FACE_ID
+};
+
+//Float framebuffer that the renderer accumulates samples into. The Texture only ever gets the resolved 8-bit colour,
+//so samples can keep being added to a pixel over multiple passes.
+//Radiance is kept as unbounded linear HDR. It only goes through exposure, tone mapping and sRGB (display) when resolved.
+struct Film
+{
+	uint32 width;
+	uint32 height;
+	DisplaySettings display;
+	FDBuffer<vec3f, uint32> accumulated;	//sum of all samples of a pixel (linear color)
+	FDBuffer<uint32, uint32> sample_count;	//no of samples summed into accumulated
+	FDBuffer<f32, uint32> luminance_sqr;	//sum of squared luminance of all samples of a pixel. Used for variance.
+
+	//AOVs. Only the ones in aovs are allocated.
+	//depth, normal, albedo and position are summed over the samples like accumulated. IDs are from the pixel's first sample.
+	uint32 aovs;
+	FDBuffer<f32, uint32> depth;
+	FDBuffer<vec3f, uint32> normal;
+	FDBuffer<vec3f, uint32> albedo;
+	FDBuffer<vec3f, uint32> position;
+	FDBuffer<int32, uint32> object_id;
+	FDBuffer<int32, uint32> face_id;
+};
+
+//What the camera ray of a sample hit first (see AOV_Flags)
+struct FirstHit
+{
+	f32 depth;
+	vec3f normal;
+	vec3f albedo;
+	vec3f position;
+	int32 object_id;
+	int32 face_id;
+};
+
+//aovs are the AOV_Flags of the buffers to keep
+inline void setup_film(Film& film, uint32 width, uint32 height, uint32 aovs)
+{
+	film.width = width;
+	film.height = height;
+	film.aovs = aovs;
+	setup_tone_mapping();
+	film.accumulated.allocate(width * height);
+	film.sample_count.allocate(width * height);
+	film.luminance_sqr.allocate(width * height);
+	if (aovs & AOV_DEPTH) film.depth.allocate(width * height);
+	if (aovs & AOV_NORMAL) film.normal.allocate(width * height);
+	if (aovs & AOV_ALBEDO) film.albedo.allocate(width * height);
+	if (aovs & AOV_POSITION) film.position.allocate(width * height);
+	if (aovs & AOV_OBJECT_ID) film.object_id.allocate(width * height);
+	if (aovs & AOV_FACE_ID) film.face_id.allocate(width * height);
+}
+
+//Resets accumulation without reallocating
+inline void clear_film(Film& film)
+{
+	pl_buffer_set(film.accumulated.front, 0, film.accumulated.size * sizeof(vec3f));
+	pl_buffer_set(film.sample_count.front, 0, film.sample_count.size * sizeof(uint32));
+	pl_buffer_set(film.luminance_sqr.front, 0, film.luminance_sqr.size * sizeof(f32));
+	//NOTE: buffers that weren't allocated have size 0
+	pl_buffer_set(film.depth.front, 0, film.depth.size * sizeof(f32));
+	pl_buffer_set(film.normal.front, 0, film.normal.size * sizeof(vec3f));
+	pl_buffer_set(film.albedo.front, 0, film.albedo.size * sizeof(vec3f));
+	pl_buffer_set(film.position.front, 0, film.position.size * sizeof(vec3f));
+	pl_buffer_set(film.object_id.front, 0xFF, film.object_id.size * sizeof(int32));	//-1
+	pl_buffer_set(film.face_id.front, 0xFF, film.face_id.size * sizeof(int32));
+}
+
+inline void free_film(Film& film)
+{
+	film.accumulated.clear();
+	film.sample_count.clear();
+	film.luminance_sqr.clear();
+	if (film.aovs & AOV_DEPTH) film.depth.clear();
+	if (film.aovs & AOV_NORMAL) film.normal.clear();
+	if (film.aovs & AOV_ALBEDO) film.albedo.clear();
+	if (film.aovs & AOV_POSITION) film.position.clear();
+	if (film.aovs & AOV_OBJECT_ID) film.object_id.clear();
+	if (film.aovs & AOV_FACE_ID) film.face_id.clear();
+	film.aovs = AOV_NONE;
+}
+
+//luminance_sqr_sum is the sum of luminance(sample)^2 of the samples in samples_sum
+FORCEDINLINE void add_samples_to_film(Film& film, int32 x, int32 y, vec3f samples_sum, f32 luminance_sqr_sum, uint32 no_samples)
+{
+	uint32 index = y * film.width + x;
+	film.accumulated[index] += samples_sum;
+	film.luminance_sqr[index] += luminance_sqr_sum;
+	film.sample_count[index] += no_samples;
+}
+
+//first_hit_sum is the sum of the first hits of the same samples added with add_samples_to_film (IDs aren't summed).
+//first_hit is one of those samples, and gives the IDs if the pixel doesn't have any yet.
+FORCEDINLINE void add_first_hits_to_film(Film& film, int32 x, int32 y, FirstHit& first_hit_sum, FirstHit& first_hit)
+{
+	uint32 index = y * film.width + x;
+	if (film.aovs & AOV_DEPTH) film.depth[index] += first_hit_sum.depth;
+	if (film.aovs & AOV_NORMAL) film.normal[index] += first_hit_sum.normal;
+	if (film.aovs & AOV_ALBEDO) film.albedo[index] += first_hit_sum.albedo;
+	if (film.aovs & AOV_POSITION) film.position[index] += first_hit_sum.position;
+	if ((film.aovs & AOV_OBJECT_ID) && film.object_id[index] == -1) film.object_id[index] = first_hit.object_id;
+	if ((film.aovs & AOV_FACE_ID) && film.face_id[index] == -1) film.face_id[index] = first_hit.face_id;
+}
+
+//Variance of the mean luminance of a pixel (how noisy the pixel still is)
+FORCEDINLINE f32 get_film_pixel_variance(Film& film, uint32 index)
+{
+	uint32 n = film.sample_count[index];
+	if (n < 2)
+	{
+		return 0.0f;
+	}
+	f32 mean = luminance(film.accumulated[index]) / (f32)n;
+	f32 variance = max((film.luminance_sqr[index] - mean * mean * (f32)n) / (f32)(n - 1), 0.0f);
+	return variance / (f32)n;
+}
+
+//A pixel is converged when the standard error of its mean luminance is below threshold * mean.
+//NOTE: mean is clamped to a small value so near black pixels don't need a near zero error to converge.
+FORCEDINLINE b32 is_film_pixel_converged(Film& film, int32 x, int32 y, f32 threshold, uint32 min_samples)
+{
+	uint32 index = y * film.width + x;
+	uint32 n = film.sample_count[index];
+	if (n < min_samples || n < 2)
+	{
+		return FALSE;
+	}
+	f32 mean = luminance(film.accumulated[index]) / (f32)n;
+	f32 allowed_error = threshold * max(mean, 0.01f);
+	return get_film_pixel_variance(film, index) <= allowed_error * allowed_error;
+}
+
+//Converts linear color to 8-bit and writes it to the texture. No tone mapping or sRGB, used for AOVs and debug views.
+FORCEDINLINE void set_texture_pixel_from_linear(Texture& texture, int32 x, int32 y, vec3f flt_pixel_color)
+{
+	flt_pixel_color = clamp(flt_pixel_color, 0.0f, 1.0f);
+	//flt_pixel_color = rgb_gamma_correct(flt_pixel_color);
+	//flt_pixel_color = linear_to_srgb(flt_pixel_color);
+	vec3b pixel_color = rgb_float_to_byte(flt_pixel_color);
+
+	Set_Pixel(pixel_color, texture, x, y);
+}
+
+//Averages accumulated samples of the pixel and writes it to the texture through film.display
+FORCEDINLINE void resolve_film_pixel(Film& film, Texture& texture, int32 x, int32 y)
+{
+	uint32 index = y * film.width + x;
+	if (film.sample_count[index] == 0)
+	{
+		return;
+	}
+	uint32* pixels = (uint32*)texture.bmb.buffer_memory;
+	pixels[y * texture.bmb.width + x] = radiance_to_bgra(film.display, film.accumulated[index] / (f32)film.sample_count[index]);
+}
+
+//Same as resolve_film_pixel for a run of count pixels starting at [x,y] (vectorized)
+FORCEDINLINE void resolve_film_row(Film& film, Texture& texture, int32 x, int32 y, uint32 count)
+{
+	uint32 index = y * film.width + x;
+	uint32* pixels = (uint32*)texture.bmb.buffer_memory;
+	convert_radiance_to_bgra(film.display, &film.accumulated[index], &film.sample_count[index], count, pixels + y * texture.bmb.width + x);
+}
+
+inline void resolve_film(Film& film, Texture& texture)
+{
+	for (uint32 y = 0; y < film.height; y++)
+	{
+		resolve_film_row(film, texture, 0, y, film.width);
+	}
+}
+
+//Writes no of samples per pixel as grayscale (white = max_samples) to texture. For checking where adaptive sampling spent its samples.
+inline void resolve_film_sample_count_map(Film& film, Texture& texture, uint32 max_samples)
+{
+	f32 scale = max_samples ? 255.0f / (f32)max_samples : 0.0f;
+	for (uint32 y = 0; y < film.height; y++)
+	{
+		for (uint32 x = 0; x < film.width; x++)
+		{
+			uint8 value = (uint8)min((f32)film.sample_count[y * film.width + x] * scale, 255.0f);
+			Set_Pixel({ value, value, value }, texture, x, y);
+		}
+	}
+}
+
+//----<Film tiles>----
+//For moving the pixels of a tile between films in different processes. The data is every allocated buffer of the film
+//(accumulation, then AOVs in AOV_Flags order), each one row by row. Both films need the same size and aovs.
+
+//Bytes pack_film_tile writes for tile
+uint32 get_film_tile_data_size(Film& film, Tile& tile);
+void pack_film_tile(Film& film, Tile& tile, uint8* data);
+//Overwrites the tile's pixels of film with data from pack_film_tile
+void unpack_film_tile(Film& film, Tile& tile, uint8* data);
+//Adds the samples (and AOV sums) of the tile's pixels in from to film. IDs are only taken where film doesn't have any yet.
+void add_film_tile(Film& film, Film& from, Tile& tile);
+//----</Film tiles>----
+
+inline const char* get_aov_name(AOV_Flags aov)
+{
+	switch (aov)
+	{
+	case AOV_DEPTH: return "depth";
+	case AOV_NORMAL: return "normal";
+	case AOV_ALBEDO: return "albedo";
+	case AOV_POSITION: return "position";
+	case AOV_OBJECT_ID: return "object_id";
+	case AOV_FACE_ID: return "face_id";
+	default: return "unknown";
+	}
+}
+
+//Writes a viewable version of a single AOV to texture:
+//depth as grayscale (white is near, mean depth is half gray), normals as normal * 0.5 + 0.5, positions scaled to their bounds, and IDs as random colors.
+void resolve_film_aov(Film& film, AOV_Flags aov, Texture& texture);
@@ -15,9 +15,10 @@ FORCEDINLINE b8 is_inside(TriangleVertices t, AABB box)
 	c = is_inside(t.c, box);
 	return (a || b || c);
 }
-static void build_oct_kd_tree(KD_Tree* tree);
+static void build_oct_kd_tree(KD_Tree* tree, JobSystem& job_system);
+static void pack_leaf_primitives(KD_Tree& tree);
 
-void build_KD_tree(ModelData mdl, KD_Tree& tree)
+void build_KD_tree(ModelData mdl, KD_Tree& tree, JobSystem& job_system)
 {
 	KD_Node root = {};
 	root.aabb = get_AABB(mdl);
@@ -42,7 +43,8 @@ void build_KD_tree(ModelData mdl, KD_Tree& tree)
 	}
 	tree.tree.add_nocpy(root);
 
-	build_oct_kd_tree(&tree);
+	build_oct_kd_tree(&tree, job_system);
+	pack_leaf_primitives(tree);
 	
 	//switch (tree.max_divisions)
 	//{
@@ -64,7 +66,140 @@ void build_KD_tree(ModelData mdl, KD_Tree& tree)
 }
 
 
-static void build_oct_kd_tree(KD_Tree* tree)
+//Moves the primitives of every leaf into TrianglePackets, 4 triangles to a packet
+static void pack_leaf_primitives(KD_Tree& tree)
+{
+	for (int32 i = 0; i < tree.tree.length; i++)
+	{
+		KD_Node& node = tree.tree[i];
+		if (node.has_children)
+		{
+			continue;
+		}
+		uint32 no_primitives = node.primitives.size;
+		TrianglePacket* packet = node.packets.allocate((no_primitives + 3) / 4);	//NOTE: allocated zeroed, so empty lanes are degenerate
+		for (uint32 p = 0; p < no_primitives; p += 4)
+		{
+			for (uint32 lane = 0; lane < 4; lane++)
+			{
+				if (p + lane < no_primitives)
+				{
+					KD_Primitive& prim = node.primitives[p + lane];
+					set_lane(packet->a, lane, prim.face_vertices.a);
+					set_lane(packet->b, lane, prim.face_vertices.b);
+					set_lane(packet->c, lane, prim.face_vertices.c);
+					packet->face_index[lane] = prim.face_index;
+				}
+				else
+				{
+					packet->face_index[lane] = TRIANGLE_PACKET_EMPTY_LANE;
+				}
+			}
+			packet++;
+		}
+		node.primitives.clear();
+	}
+}
+
+#define KD_PRIMITIVES_PER_CLASSIFY_JOB 16384
+
+typedef DBuffer<KD_Primitive, 0, 0, uint32> KD_PrimitiveList;
+
+//Adds every primitive to the lists of all the children (8) it touches
+static void classify_primitives(KD_Primitive* primitives, uint32 count, KD_Node** children, KD_PrimitiveList* lists)
+{
+	uint32 temp_buffer_cap_and_addon = count / 8 + 1;	//using an 8th of the parent nodes primitive size as a cap and overflow addon value
+	for (int32 c = 0; c < 8; c++)
+	{
+		lists[c].capacity = temp_buffer_cap_and_addon;
+		lists[c].overflow_addon = temp_buffer_cap_and_addon;
+	}
+
+	for (uint32 i = 0; i < count; i++)
+	{
+		//ASSESS: Maybe a faster way of doin this is a loop that checks if any of the vertices are in 
+		//			any of the aabbs, or inlining the is_inside directly into the ifs that add the primitives
+		for (int32 c = 0; c < 8; c++)
+		{
+			if (is_inside(primitives[i].face_vertices, children[c]->aabb))
+			{
+				lists[c].add(primitives[i]);
+			}
+		}
+	}
+}
+
+struct KD_ClassifyJob
+{
+	KD_Primitive* primitives;
+	uint32 count;
+	KD_Node** children;
+	KD_PrimitiveList* lists;	//8 lists for this job
+};
+
+static void classify_primitives_job(void* payload)
+{
+	KD_ClassifyJob* job = (KD_ClassifyJob*)payload;
+	classify_primitives(job->primitives, job->count, job->children, job->lists);
+}
+
+static void fill_children_primitives(KD_Node& node, KD_Node** children, JobSystem& job_system)
+{
+	uint32 no_chunks = (node.primitives.size + KD_PRIMITIVES_PER_CLASSIFY_JOB - 1) / KD_PRIMITIVES_PER_CLASSIFY_JOB;
+	if (no_chunks <= 1)
+	{
+		KD_PrimitiveList lists[8];
+		classify_primitives(node.primitives.front, node.primitives.size, children, lists);
+		for (int32 c = 0; c < 8; c++)
+		{
+			children[c]->primitives.size = lists[c].length;
+			children[c]->primitives.front = lists[c].front;
+		}
+		return;
+	}
+
+	//Every chunk of primitives fills its own 8 lists. They're joined in chunk order, so children end up the same as when done serially.
+	FDBuffer<KD_PrimitiveList, uint32> lists;
+	lists.allocate(no_chunks * 8);
+	JobCounter counter = {};
+	for (uint32 i = 0; i < no_chunks; i++)
+	{
+		KD_ClassifyJob job;
+		job.primitives = node.primitives.front + i * KD_PRIMITIVES_PER_CLASSIFY_JOB;
+		job.count = min(node.primitives.size - i * KD_PRIMITIVES_PER_CLASSIFY_JOB, (uint32)KD_PRIMITIVES_PER_CLASSIFY_JOB);
+		job.children = children;
+		job.lists = &lists[i * 8];
+		submit_job(job_system, classify_primitives_job, &job, sizeof(job), &counter);
+	}
+	wait_for_counter(job_system, counter);
+
+	for (int32 c = 0; c < 8; c++)
+	{
+		uint32 total = 0;
+		for (uint32 i = 0; i < no_chunks; i++)
+		{
+			total += lists[i * 8 + c].length;
+		}
+		if (total == 0)
+		{
+			continue;
+		}
+		KD_Primitive* dest = children[c]->primitives.allocate(total);
+		for (uint32 i = 0; i < no_chunks; i++)
+		{
+			KD_PrimitiveList& list = lists[i * 8 + c];
+			if (list.length > 0)
+			{
+				pl_buffer_copy(dest, list.front, list.length * sizeof(KD_Primitive));
+				dest += list.length;
+			}
+			list.clear_buffer();
+		}
+	}
+	lists.clear();
+}
+
+static void build_oct_kd_tree(KD_Tree* tree, JobSystem& job_system)
 {
 	DBuffer<uint32, 1000, 1000> node_stack;
 
@@ -149,107 +284,8 @@ static void build_oct_kd_tree(KD_Tree* tree)
 
 
 			//filling subnode primitives
-			DBuffer<KD_Primitive, 0, 0, uint32> prim_bbleft, prim_bfleft, prim_tbleft, prim_tfleft, prim_bbright, prim_bfright, prim_tbright, prim_tfright;
-			uint32 temp_buffer_cap_and_addon = (current_node->primitives.size / 8);	//using an 8th of the parent nodes primitive size as a cap and overflow addon value
-			prim_bbleft.capacity = temp_buffer_cap_and_addon;
-			prim_bbleft.overflow_addon = temp_buffer_cap_and_addon;
-
-			prim_bfleft.capacity = temp_buffer_cap_and_addon;
-			prim_bfleft.overflow_addon = temp_buffer_cap_and_addon;
-
-			prim_tbleft.capacity = temp_buffer_cap_and_addon;
-			prim_tbleft.overflow_addon = temp_buffer_cap_and_addon;
-
-			prim_tfleft.capacity = temp_buffer_cap_and_addon;
-			prim_tfleft.overflow_addon = temp_buffer_cap_and_addon;
-
-			prim_bbright.capacity = temp_buffer_cap_and_addon;
-			prim_bbright.overflow_addon = temp_buffer_cap_and_addon;
-				   
-			prim_bfright.capacity = temp_buffer_cap_and_addon;
-			prim_bfright.overflow_addon = temp_buffer_cap_and_addon;
-				   
-			prim_tbright.capacity = temp_buffer_cap_and_addon;
-			prim_tbright.overflow_addon = temp_buffer_cap_and_addon;
-				   
-			prim_tfright.capacity = temp_buffer_cap_and_addon;
-			prim_tfright.overflow_addon = temp_buffer_cap_and_addon;
-
-
-
-
-			for (uint32 i = 0; i < current_node->primitives.size; i++)
-			{
-				//ASSESS: Maybe a faster way of doin this is a loop that checks if any of the vertices are in 
-				//			any of the aabbs, or inlining the is_inside directly into the ifs that add the primitives
-				b8 in_bbleft, in_bfleft, in_tbleft, in_tfleft, in_bbright, in_bfright, in_tbright, in_tfright;
-
-				in_bbleft = is_inside(current_node->primitives[i].face_vertices, bb_left.aabb);
-				in_bfleft = is_inside(current_node->primitives[i].face_vertices, bf_left.aabb);
-				in_tbleft = is_inside(current_node->primitives[i].face_vertices, tb_left.aabb);
-				in_tfleft = is_inside(current_node->primitives[i].face_vertices, tf_left.aabb);
-				in_bbright = is_inside(current_node->primitives[i].face_vertices, bb_right.aabb);
-				in_bfright = is_inside(current_node->primitives[i].face_vertices, bf_right.aabb);
-				in_tbright = is_inside(current_node->primitives[i].face_vertices, tb_right.aabb);
-				in_tfright = is_inside(current_node->primitives[i].face_vertices, tf_right.aabb);
-
-				if (in_bbleft)	
-				{
-					prim_bbleft.add(current_node->primitives[i]);
-				}
-				if (in_bfleft) 
-				{
-					prim_bfleft.add(current_node->primitives[i]);
-				}
-				if (in_tbleft)	
-				{
-					prim_tbleft.add(current_node->primitives[i]);
-				}
-				if (in_tfleft) 
-				{
-					prim_tfleft.add(current_node->primitives[i]);
-				}
-				if (in_bbright)	
-				{
-					prim_bbright.add(current_node->primitives[i]);
-				}
-				if (in_bfright) 
-				{
-					prim_bfright.add(current_node->primitives[i]);
-				}
-				if (in_tbright)	
-				{
-					prim_tbright.add(current_node->primitives[i]);
-				}
-				if (in_tfright) 
-				{
-					prim_tfright.add(current_node->primitives[i]);
-				}
-			}
-
-			bb_left.primitives.size = prim_bbleft.length;
-			bb_left.primitives.front = prim_bbleft.front;
-
-			bf_left.primitives.size = prim_bfleft.length;
-			bf_left.primitives.front = prim_bfleft.front;
-			
-			tb_left.primitives.size = prim_tbleft.length;
-			tb_left.primitives.front = prim_tbleft.front;
-			
-			tf_left.primitives.size = prim_tfleft.length;
-			tf_left.primitives.front = prim_tfleft.front;
-			
-			bb_right.primitives.size = prim_bbright.length;
-			bb_right.primitives.front = prim_bbright.front;
-
-			bf_right.primitives.size = prim_bfright.length;
-			bf_right.primitives.front = prim_bfright.front;
-
-			tb_right.primitives.size = prim_tbright.length;
-			tb_right.primitives.front = prim_tbright.front;
-
-			tf_right.primitives.size = prim_tfright.length;
-			tf_right.primitives.front = prim_tfright.front;
+			KD_Node* children[8] = { &bb_left, &bf_left, &tb_left, &tf_left, &bb_right, &bf_right, &tb_right, &tf_right };
+			fill_children_primitives(*current_node, children, job_system);
 
 			ASSERT(bb_left.primitives.size + bf_left.primitives.size + tb_left.primitives.size + 
 				tf_left.primitives.size + bb_right.primitives.size + bf_right.primitives.size + tb_right.primitives.size +
@@ -290,26 +326,79 @@ static void build_oct_kd_tree(KD_Tree* tree)
 struct TraversalData
 {
 	Optimized_Ray* ray;
+	Ray_4x* ray_4x;
+	Watertight_Ray* wt_ray;	//only set up for TriangleCullMode::WATERTIGHT
 	KD_Tree* tree;
 	TriangleIntersectionData* tri_data;
 	f32* closest;
 };
+
+//Tests the triangles of a leaf, a packet at a time. Returns TRUE if one closer than td.closest was hit.
+template<TriangleCullMode mode>
+static FORCEDINLINE b32 intersect_leaf(TraversalData& td, KD_Node* leaf)
+{
+	b32 hit = FALSE;
+	TrianglePacket* packet = leaf->packets.front;
+	for (uint32 i = 0; i < leaf->packets.size; i++)
+	{
+		f32_4x t, u, v;
+		uint32 hits = TriangleKernel<mode>::intersect_4x(*td.ray_4x, *td.wt_ray, *packet, *td.closest, t, u, v);
+		for (int32 lane = 0; hits; lane++, hits >>= 1)
+		{
+			if ((hits & 1) && t[lane] < *td.closest)
+			{
+				*td.closest = t[lane];
+				td.tri_data->face_index = packet->face_index[lane];
+				td.tri_data->u = u[lane];
+				td.tri_data->v = v[lane];
+				hit = TRUE;
+			}
+		}
+		packet++;
+	}
+	return hit;
+}
 //defined in renderer.cpp
 
 
+template<TriangleCullMode mode>
 static void traverse_oct_tree_new(TraversalData& td, KD_Tree& tree, KD_Node** hit_stack_front, LeafNodePair* leaf_stack_front);
 
-f32 get_ray_kd_tree_intersection(Optimized_Ray& op_ray, KD_Tree& tree, TriangleIntersectionData& tri_data, KD_Node** hit_stack_front, LeafNodePair* leaf_stack_front)
+f32 get_ray_kd_tree_intersection(Optimized_Ray& op_ray, KD_Tree& tree, TriangleCullMode cull_mode, TriangleIntersectionData& tri_data, KD_Node** hit_stack_front, LeafNodePair* leaf_stack_front)
 {
 	f32 closest = MAX_FLOAT;
 
+	Watertight_Ray wt_ray;
+	Ray_4x ray_4x;
+	SetRay4x(ray_4x, op_ray.ray);
 	TraversalData td;
 	td.closest = &closest;
 	td.ray = &op_ray;
+	td.ray_4x = &ray_4x;
+	td.wt_ray = &wt_ray;
 	td.tri_data = &tri_data;
 	td.tree = &tree;
 	
-	traverse_oct_tree_new(td, tree, hit_stack_front, leaf_stack_front);
+	//NOTE: mode is resolved once per model here so the traversal loops don't branch on it.
+	switch (cull_mode)
+	{
+	case TriangleCullMode::CULLED:
+	{
+		traverse_oct_tree_new<TriangleCullMode::CULLED>(td, tree, hit_stack_front, leaf_stack_front);
+	}break;
+	case TriangleCullMode::TWO_SIDED:
+	{
+		traverse_oct_tree_new<TriangleCullMode::TWO_SIDED>(td, tree, hit_stack_front, leaf_stack_front);
+	}break;
+	case TriangleCullMode::WATERTIGHT:
+	{
+		SetWatertightRay(wt_ray, op_ray.ray);
+		traverse_oct_tree_new<TriangleCullMode::WATERTIGHT>(td, tree, hit_stack_front, leaf_stack_front);
+	}break;
+	default:
+		ASSERT(FALSE);	//cull mode traversal isn't defined
+		break;
+	}
 	return closest;
 	
 	//switch (tree.max_divisions)
@@ -334,6 +423,7 @@ f32 get_ray_kd_tree_intersection(Optimized_Ray& op_ray, KD_Tree& tree, TriangleI
 	//}
 }
 
+template<TriangleCullMode mode>
 static void traverse_oct_tree_new(TraversalData& td, KD_Tree& tree, KD_Node** hit_stack_front, LeafNodePair* leaf_stack_front)
 {
 	if (!check_ray_AABB_intersection(*td.ray, tree.tree.front->aabb))
@@ -343,20 +433,7 @@ static void traverse_oct_tree_new(TraversalData& td, KD_Tree& tree, KD_Node** hi
 
 	if (tree.tree.front->has_children == 0)	//if there is no nodes other than root
 	{
-		KD_Primitive* prim = tree.tree.front->primitives.front;
-		for (uint32 i = 0; i < tree.tree.front->primitives.size; i++)
-		{
-			f32 u, v;
-			f32 distance = get_triangle_ray_intersection_culled(td.ray->ray, prim->face_vertices, u, v);
-			if (distance < *td.closest && distance > tolerance)
-			{
-				*td.closest = distance;
-				td.tri_data->face_index = tree.tree.front->primitives[i].face_index;
-				td.tri_data->u = u;
-				td.tri_data->v = v;
-			}
-			prim++;
-		}
+		intersect_leaf<mode>(td, tree.tree.front);
 		return;
 	}
 
@@ -418,7 +495,7 @@ static void traverse_oct_tree_new(TraversalData& td, KD_Tree& tree, KD_Node** hi
 					for (uint32 i = 0; i < children->primitives.size; i++)
 					{
 						f32 u, v;
-						f32 distance = get_triangle_ray_intersection_culled(td.ray->ray, prim->face_vertices, u, v);
+						f32 distance = TriangleKernel<mode>::intersect(td.ray->ray, *td.wt_ray, prim->face_vertices, u, v);
 						if (distance < *td.closest && distance > tolerance)
 						{
 							*td.closest = distance;
@@ -439,21 +516,7 @@ static void traverse_oct_tree_new(TraversalData& td, KD_Tree& tree, KD_Node** hi
 	b32 hit = FALSE;
 	for (int j = 0; j < leaf_stack_length; j++)
 	{
-		KD_Primitive* prim = cur->node->primitives.front;
-		for (uint32 i = 0; i < cur->node->primitives.size; i++)
-		{
-			f32 u, v;
-			f32 distance = get_triangle_ray_intersection_culled(td.ray->ray, prim->face_vertices, u, v);
-			if (distance < *td.closest && distance > tolerance)
-			{
-				*td.closest = distance;
-				td.tri_data->face_index = cur->node->primitives[i].face_index;
-				td.tri_data->u = u;
-				td.tri_data->v = v;
-				hit = TRUE;
-			}
-			prim++;
-		}
+		hit = intersect_leaf<mode>(td, cur->node);
 		if (hit)
 		{
 			break;
@@ -476,20 +539,7 @@ static void traverse_binary_tree(TraversalData& td, KD_Node* current_node)
 	}
 	else   //is leaf node
 	{
-		KD_Primitive* prim = current_node->primitives.front;
-		for (uint32 i = 0; i < current_node->primitives.size; i++)
-		{
-			f32 u, v;
-			f32 distance = get_triangle_ray_intersection_culled(td.ray->ray, prim->face_vertices, u, v);
-			if (distance < *td.closest && distance > tolerance)
-			{
-				*td.closest = distance;
-				td.tri_data->face_index = current_node->primitives[i].face_index;
-				td.tri_data->u = u;
-				td.tri_data->v = v;
-			}
-			prim++;
-		}
+		intersect_leaf<TriangleCullMode::CULLED>(td, current_node);
 	}
 }
 
@@ -508,20 +558,7 @@ static void traverse_quad_tree(TraversalData& td, KD_Node* current_node)
 	}
 	else   //is leaf node
 	{
-		KD_Primitive* prim = current_node->primitives.front;
-		for (uint32 i = 0; i < current_node->primitives.size; i++)
-		{
-			f32 u, v;
-			f32 distance = get_triangle_ray_intersection_culled(td.ray->ray, prim->face_vertices, u, v);
-			if (distance < *td.closest && distance > tolerance)
-			{
-				*td.closest = distance;
-				td.tri_data->face_index = current_node->primitives[i].face_index;
-				td.tri_data->u = u;
-				td.tri_data->v = v;
-			}
-			prim++;
-		}
+		intersect_leaf<TriangleCullMode::CULLED>(td, current_node);
 	}
 }
 
@@ -545,20 +582,7 @@ static void traverse_oct_tree_recursive(TraversalData& td, KD_Node* current_node
 	}
 	else   //is leaf node
 	{
-		KD_Primitive* prim = current_node->primitives.front;
-		for (uint32 i = 0; i < current_node->primitives.size; i++)
-		{
-			f32 u, v;
-			f32 distance = get_triangle_ray_intersection_culled(td.ray->ray, prim->face_vertices, u, v);
-			if (distance < *td.closest && distance > tolerance)
-			{
-				*td.closest = distance;
-				td.tri_data->face_index = current_node->primitives[i].face_index;
-				td.tri_data->u = u;
-				td.tri_data->v = v;
-			}
-			prim++;
-		}
+		intersect_leaf<TriangleCullMode::CULLED>(td, current_node);
 	}
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "ray.h"
+#include "engine/tools/job_system.h"
 
 //This KD tree supports a single model.
 //
@@ -32,7 +33,8 @@ struct KD_Node
 		b32 has_children;	//same as !is_leaf_node
 		int32 children_start_position;	//position in tree buffer where children are
 	};
-	FDBuffer<KD_Primitive,uint32> primitives;
+	FDBuffer<KD_Primitive,uint32> primitives;	//only used while building. Leaves keep theirs as packets.
+	FDBuffer<TrianglePacket, uint32> packets;
 	//uint32 pad[7];
 };
 struct KD_Tree
@@ -51,6 +53,7 @@ struct LeafNodePair
 	KD_Node* node;
 	f32 distance_from_ray;
 };
-void build_KD_tree(ModelData mdl, KD_Tree& tree);
+//Big nodes near the top of the tree get their primitives sorted into the children as parallel jobs
+void build_KD_tree(ModelData mdl, KD_Tree& tree, JobSystem& job_system);
 
-f32 get_ray_kd_tree_intersection(Optimized_Ray& op_ray, KD_Tree& tree, TriangleIntersectionData& tri_data, KD_Node** hit_stack_front, LeafNodePair* leaf_stack_front);
+f32 get_ray_kd_tree_intersection(Optimized_Ray& op_ray, KD_Tree& tree, TriangleCullMode cull_mode, TriangleIntersectionData& tri_data, KD_Node** hit_stack_front, LeafNodePair* leaf_stack_front);
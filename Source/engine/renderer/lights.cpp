@@ -0,0 +1,121 @@
+#include "lights.h"
+#include "sampling.h"
+
+void build_light_list(LightList& light_list, DBuffer<Sphere>& spheres, DBuffer<Model>& models)
+{
+	free_light_list(light_list);
+
+	for (int32 i = 0; i < spheres.length; i++)
+	{
+		Sphere& spr = spheres[i];
+		if (!spr.material || luminance(spr.material->emission_color) <= 0.0f || spr.radius <= 0.0f)
+		{
+			continue;
+		}
+		Light light = {};
+		light.type = LightType::SPHERE;
+		light.material = spr.material;
+		light.a = spr.center;
+		light.radius = spr.radius;
+		light.area = 4.0f * PI32 * spr.radius * spr.radius;
+		light_list.lights.add_nocpy(light);
+	}
+
+	for (int32 i = 0; i < models.length; i++)
+	{
+		ModelData& data = models[i].data;
+		if (!data.material || luminance(data.material->emission_color) <= 0.0f)
+		{
+			continue;
+		}
+		ASSERT(data.faces_vertices.size > 0);	//vertices were already freed
+		for (uint32 j = 0; j < data.faces_vertices.size; j++)
+		{
+			Light light = {};
+			light.type = LightType::TRIANGLE;
+			light.material = data.material;
+			light.a = data.vertices[data.faces_vertices[j].vertex_indices[0]];
+			light.b = data.vertices[data.faces_vertices[j].vertex_indices[1]];
+			light.c = data.vertices[data.faces_vertices[j].vertex_indices[2]];
+			light.area = 0.5f * mag(cross(light.b - light.a, light.c - light.a));
+			light.one_sided = models[i].cull_mode == TriangleCullMode::CULLED;
+			if (light.area > 0.0f)
+			{
+				light_list.lights.add_nocpy(light);
+			}
+		}
+	}
+
+	if (light_list.lights.length == 0)
+	{
+		return;
+	}
+
+	light_list.cdf.allocate(light_list.lights.length);
+	f32 total = 0.0f;
+	for (int32 i = 0; i < light_list.lights.length; i++)
+	{
+		total += luminance(light_list.lights[i].material->emission_color) * light_list.lights[i].area;
+		light_list.cdf[i] = total;
+	}
+	for (int32 i = 0; i < light_list.lights.length; i++)
+	{
+		light_list.cdf[i] /= total;
+	}
+	light_list.cdf[light_list.cdf.size - 1] = 1.0f;
+	light_list.total_power = total;
+}
+
+void free_light_list(LightList& light_list)
+{
+	light_list.lights.clear_buffer();
+	light_list.cdf.clear();
+	light_list.total_power = 0.0f;
+}
+
+b32 sample_light(LightList& light_list, vec3f shading_point, f32 u_light, f32 u1, f32 u2, LightSample& sample)
+{
+	if (light_list.total_power <= 0.0f)
+	{
+		return FALSE;
+	}
+
+	//binary search for the first light whose cdf is above u_light
+	uint32 lo = 0, hi = light_list.cdf.size - 1;
+	while (lo < hi)
+	{
+		uint32 mid = (lo + hi) / 2;
+		if (light_list.cdf[mid] <= u_light)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	Light& light = light_list.lights[lo];
+
+	if (light.type == LightType::SPHERE)
+	{
+		vec3f to_point = shading_point - light.a;
+		normalize(to_point);
+		sample.normal = sample_uniform_hemisphere(to_point, u1, u2);
+		sample.position = light.a + sample.normal * light.radius;
+		sample.pdf_area = get_light_pdf_area(light_list, *light.material, TRUE);
+	}
+	else
+	{
+		//uniform point on the triangle
+		f32 su = sqroot(u1);
+		f32 b0 = 1.0f - su;
+		f32 b1 = u2 * su;
+		sample.position = light.a * b0 + light.b * b1 + light.c * (1.0f - b0 - b1);
+		sample.normal = cross(light.b - light.a, light.c - light.a);
+		normalize(sample.normal);
+		sample.pdf_area = get_light_pdf_area(light_list, *light.material, FALSE);
+	}
+	sample.emission = light.material->emission_color;
+	sample.one_sided = light.one_sided;
+	return TRUE;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "sphere.h"
+#include "model.h"
+
+//Every emissive sphere and triangle in the scene, so lights can be sampled directly (next event estimation).
+//Lights are picked with a chance proportional to their power (emission luminance * area).
+//NOTE: planes are infinite so they can't be sampled. Emissive planes and the skybox only light the scene when paths hit them.
+
+enum class LightType
+{
+	SPHERE, TRIANGLE
+};
+
+struct Light
+{
+	LightType type;
+	Material* material;
+	vec3f a, b, c;		//triangle vertices. a is the center for spheres.
+	f32 radius;
+	f32 area;
+	b32 one_sided;		//triangles of CULLED models only emit from their front face, the only one rays can hit
+};
+
+struct LightList
+{
+	DBuffer<Light, 0, 16> lights;
+	FDBuffer<f32, uint32> cdf;	//cumulative power of lights[0..i], normalized to 1
+	f32 total_power = 0;
+};
+
+//A point on a light, picked for a shading point
+struct LightSample
+{
+	vec3f position;
+	vec3f normal;
+	vec3f emission;
+	b32 one_sided;
+	f32 pdf_area;	//pdf of picking this point (per unit area), including the chance of picking the light
+};
+
+//NOTE: triangles are copied out of the models, so this has to be called before prep_scene frees their vertices.
+void build_light_list(LightList& light_list, DBuffer<Sphere>& spheres, DBuffer<Model>& models);
+
+void free_light_list(LightList& light_list);
+
+//Picks a light with u_light and a point on it with u1, u2. Returns FALSE if there are no lights.
+//NOTE: spheres are sampled on the half facing shading_point (no point on the other half can be seen from it)
+b32 sample_light(LightList& light_list, vec3f shading_point, f32 u_light, f32 u1, f32 u2, LightSample& sample);
+
+//pdf (per unit area) sample_light would have given a point on an emitter with this material. Used to weigh hits on
+//emitters found by bounces against light samples (multiple importance sampling).
+FORCEDINLINE f32 get_light_pdf_area(LightList& light_list, Material& material, b32 is_sphere)
+{
+	if (light_list.total_power <= 0.0f)
+	{
+		return 0.0f;
+	}
+	//power_i / total_power * 1 / sampled_area_i. A sphere's sampled area is half its area.
+	return (is_sphere ? 2.0f : 1.0f) * luminance(material.emission_color) / light_list.total_power;
+}
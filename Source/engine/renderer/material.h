@@ -5,5 +5,5 @@ struct Material
 {
 	vec3f emission_color;
 	vec3f reflection_color;
-	f32 scatter;
+	f32 scatter;	//0 is fully diffuse, 1 is a mirror. In between mixes in a glossy lobe (see bsdf.h)
 };
\ No newline at end of file
@@ -10,6 +10,18 @@ struct TriangleVertices
 	vec3f c;
 };
 
+#define TRIANGLE_PACKET_EMPTY_LANE 0xFFFFFFFF
+
+//4 triangles in SoA layout, so they're intersected together (see TriangleKernel::intersect_4x).
+//Lanes after the last triangle are degenerate (all 0) with face_index TRIANGLE_PACKET_EMPTY_LANE.
+struct TrianglePacket
+{
+	vec3f_4x a;
+	vec3f_4x b;
+	vec3f_4x c;
+	uint32 face_index[4];
+};
+
 struct FaceVertices
 {
 	int32 vertex_indices[3] = { 0 };
@@ -60,6 +72,15 @@ inline AABB get_AABB(ModelData& data)
 	return (ret);
 }
 
+//How the triangles of a model are intersected. Picked per model; traversal is templated on it so the
+//hot loop is specialised at compile time (see get_ray_kd_tree_intersection).
+enum class TriangleCullMode
+{
+	CULLED,		//back faces are skipped. Fastest, only correct for closed meshes.
+	TWO_SIDED,	//both faces are hit (open meshes, planes made of triangles, etc..)
+	WATERTIGHT	//both faces are hit and rays can't slip through shared edges/vertices
+};
+
 //NOTE: Placed here cause file uses definitions defined above
 #include "kd_tree.h"
 
@@ -68,6 +89,7 @@ struct Model
 	KD_Tree kd_tree;
 	ModelData data;			
 	AABB surrounding_aabb;
+	TriangleCullMode cull_mode = TriangleCullMode::CULLED;
 };
 
 //Uses Moller-Trumbore intersection algorithm
@@ -102,6 +124,255 @@ static FORCEDINLINE f32 get_triangle_ray_intersection_culled(Ray& ray, TriangleV
 
 }
 
+//Same as get_triangle_ray_intersection_culled but hits both faces
+static FORCEDINLINE f32 get_triangle_ray_intersection_two_sided(Ray& ray, TriangleVertices& tri, f32& u, f32& v)
+{
+	vec3f ab, ac;
+	ab = tri.b - tri.a;
+	ac = tri.c - tri.a;
+
+	vec3f pvec = cross(ray.direction, ac);
+	f32 det = dot(ab, pvec);
+
+	//ray is parallel to triangle
+	if (det > -tolerance && det < tolerance)
+	{
+		return 0;
+	}
+
+	f32 det_inv = 1 / det;
+
+	vec3f tvec = ray.origin - tri.a;
+	u = dot(tvec, pvec) * det_inv;
+	if (u < 0 || u > 1) return 0;
+
+	vec3f qvec = cross(tvec, ab);
+	v = dot(ray.direction, qvec) * det_inv;
+	if (v < 0 || u + v > 1) return 0;
+
+	return dot(qvec, ac) * det_inv; //t
+}
+
+//Per ray data for the watertight test. Made once per ray with SetWatertightRay() before traversal. 
+struct Watertight_Ray
+{
+	int32 kx, ky, kz;	//axis permutation so kz is the dominant axis of the ray direction
+	f32 sx, sy, sz;		//shear constants
+};
+
+FORCEDINLINE void SetWatertightRay(Watertight_Ray& wt, Ray& ray)
+{
+	f32 ax = ray.direction.x < 0 ? -ray.direction.x : ray.direction.x;
+	f32 ay = ray.direction.y < 0 ? -ray.direction.y : ray.direction.y;
+	f32 az = ray.direction.z < 0 ? -ray.direction.z : ray.direction.z;
+	wt.kz = (ax > ay) ? ((ax > az) ? 0 : 2) : ((ay > az) ? 1 : 2);
+	wt.kx = wt.kz + 1 == 3 ? 0 : wt.kz + 1;
+	wt.ky = wt.kx + 1 == 3 ? 0 : wt.kx + 1;
+	if (ray.direction[wt.kz] < 0)	//keeping winding order
+	{
+		int32 tmp = wt.kx;
+		wt.kx = wt.ky;
+		wt.ky = tmp;
+	}
+	wt.sx = ray.direction[wt.kx] / ray.direction[wt.kz];
+	wt.sy = ray.direction[wt.ky] / ray.direction[wt.kz];
+	wt.sz = 1.0f / ray.direction[wt.kz];
+}
+
+//Watertight ray/triangle intersection (Woop, Benthin, Wald 2013). Hits both faces.
+//Triangle is moved into ray space so edge tests of neighbouring triangles are done with the exact same numbers.
+static FORCEDINLINE f32 get_triangle_ray_intersection_watertight(Ray& ray, Watertight_Ray& wt, TriangleVertices& tri, f32& u, f32& v)
+{
+	vec3f a = tri.a - ray.origin;
+	vec3f b = tri.b - ray.origin;
+	vec3f c = tri.c - ray.origin;
+
+	f32 a_x = a[wt.kx] - wt.sx * a[wt.kz];
+	f32 a_y = a[wt.ky] - wt.sy * a[wt.kz];
+	f32 b_x = b[wt.kx] - wt.sx * b[wt.kz];
+	f32 b_y = b[wt.ky] - wt.sy * b[wt.kz];
+	f32 c_x = c[wt.kx] - wt.sx * c[wt.kz];
+	f32 c_y = c[wt.ky] - wt.sy * c[wt.kz];
+
+	//scaled barycentrics
+	f32 e_u = c_x * b_y - c_y * b_x;
+	f32 e_v = a_x * c_y - a_y * c_x;
+	f32 e_w = b_x * a_y - b_y * a_x;
+
+	//ray goes exactly through an edge. Redoing in double precision to get a consistent answer.
+	if (e_u == 0.0f || e_v == 0.0f || e_w == 0.0f)
+	{
+		e_u = (f32)((f64)c_x * (f64)b_y - (f64)c_y * (f64)b_x);
+		e_v = (f32)((f64)a_x * (f64)c_y - (f64)a_y * (f64)c_x);
+		e_w = (f32)((f64)b_x * (f64)a_y - (f64)b_y * (f64)a_x);
+	}
+
+	if ((e_u < 0.0f || e_v < 0.0f || e_w < 0.0f) && (e_u > 0.0f || e_v > 0.0f || e_w > 0.0f))
+	{
+		return 0;
+	}
+
+	f32 det = e_u + e_v + e_w;
+	if (det == 0.0f)
+	{
+		return 0;
+	}
+
+	f32 a_z = wt.sz * a[wt.kz];
+	f32 b_z = wt.sz * b[wt.kz];
+	f32 c_z = wt.sz * c[wt.kz];
+	f32 det_inv = 1.0f / det;
+
+	//intersection_point = (1-u-v)*tri.a + u*tri.b + v*tri.c
+	u = e_v * det_inv;
+	v = e_w * det_inv;
+	return (e_u * a_z + e_v * b_z + e_w * c_z) * det_inv; //t
+}
+
+//Ray broadcast to every lane, made once per ray for the packet kernels
+struct Ray_4x
+{
+	vec3f_4x origin;
+	vec3f_4x direction;
+};
+
+FORCEDINLINE void SetRay4x(Ray_4x& ray_4x, Ray& ray)
+{
+	ray_4x.origin = set_vec3f_4x(ray.origin);
+	ray_4x.direction = set_vec3f_4x(ray.direction);
+}
+
+//get_triangle_ray_intersection_culled/two_sided on the 4 triangles of a packet.
+//Returns the lane bits of triangles hit between tolerance and t_max, with their t, u and v in the lanes.
+template<b32 culled>
+static FORCEDINLINE uint32 get_triangle_ray_intersection_4x(Ray_4x& ray, TrianglePacket& packet, f32_4x t_max, f32_4x& t, f32_4x& u, f32_4x& v)
+{
+	vec3f_4x ab = packet.b - packet.a;
+	vec3f_4x ac = packet.c - packet.a;
+
+	vec3f_4x pvec = cross(ray.direction, ac);
+	f32_4x det = dot(ab, pvec);
+
+	f32_4x tolerance_4x = set_f32_4x(tolerance);
+	f32_4x hit = culled ? det >= tolerance_4x : (det >= tolerance_4x) | (det <= -tolerance_4x);
+
+	//NOTE: missed lanes can divide by 0, they're masked out anyway
+	f32_4x det_inv = set_f32_4x(1.0f) / det;
+
+	vec3f_4x tvec = ray.origin - packet.a;
+	u = dot(tvec, pvec) * det_inv;
+
+	vec3f_4x qvec = cross(tvec, ab);
+	v = dot(ray.direction, qvec) * det_inv;
+
+	t = dot(qvec, ac) * det_inv;
+
+	f32_4x zero = set_f32_4x(0.0f);
+	f32_4x one = set_f32_4x(1.0f);
+	hit = hit & (u >= zero) & (u <= one) & (v >= zero) & ((u + v) <= one) & (t > tolerance_4x) & (t < t_max);
+	return get_mask_bits(hit);
+}
+
+//get_triangle_ray_intersection_watertight on the 4 triangles of a packet. Same results as the scalar test, lane for lane.
+static FORCEDINLINE uint32 get_triangle_ray_intersection_watertight_4x(Ray_4x& ray, Watertight_Ray& wt, TrianglePacket& packet, f32_4x t_max, f32_4x& t, f32_4x& u, f32_4x& v)
+{
+	vec3f_4x a = packet.a - ray.origin;
+	vec3f_4x b = packet.b - ray.origin;
+	vec3f_4x c = packet.c - ray.origin;
+	//NOTE: x, y and z are laid out like an array, so the axis permutation can index them
+	f32_4x* a_axes = &a.x;
+	f32_4x* b_axes = &b.x;
+	f32_4x* c_axes = &c.x;
+
+	f32_4x sx = set_f32_4x(wt.sx);
+	f32_4x sy = set_f32_4x(wt.sy);
+	f32_4x a_x = a_axes[wt.kx] - sx * a_axes[wt.kz];
+	f32_4x a_y = a_axes[wt.ky] - sy * a_axes[wt.kz];
+	f32_4x b_x = b_axes[wt.kx] - sx * b_axes[wt.kz];
+	f32_4x b_y = b_axes[wt.ky] - sy * b_axes[wt.kz];
+	f32_4x c_x = c_axes[wt.kx] - sx * c_axes[wt.kz];
+	f32_4x c_y = c_axes[wt.ky] - sy * c_axes[wt.kz];
+
+	//scaled barycentrics
+	f32_4x e_u = c_x * b_y - c_y * b_x;
+	f32_4x e_v = a_x * c_y - a_y * c_x;
+	f32_4x e_w = b_x * a_y - b_y * a_x;
+
+	f32_4x zero = set_f32_4x(0.0f);
+	//lanes where the ray goes exactly through an edge are redone in double precision (rare)
+	uint32 on_edge = get_mask_bits((e_u == zero) | (e_v == zero) | (e_w == zero));
+	for (int32 lane = 0; on_edge; lane++, on_edge >>= 1)
+	{
+		if (on_edge & 1)
+		{
+			e_u[lane] = (f32)((f64)c_x[lane] * (f64)b_y[lane] - (f64)c_y[lane] * (f64)b_x[lane]);
+			e_v[lane] = (f32)((f64)a_x[lane] * (f64)c_y[lane] - (f64)a_y[lane] * (f64)c_x[lane]);
+			e_w[lane] = (f32)((f64)b_x[lane] * (f64)a_y[lane] - (f64)b_y[lane] * (f64)a_x[lane]);
+		}
+	}
+
+	f32_4x outside = ((e_u < zero) | (e_v < zero) | (e_w < zero)) & ((e_u > zero) | (e_v > zero) | (e_w > zero));
+	f32_4x det = e_u + e_v + e_w;
+
+	f32_4x sz = set_f32_4x(wt.sz);
+	f32_4x a_z = sz * a_axes[wt.kz];
+	f32_4x b_z = sz * b_axes[wt.kz];
+	f32_4x c_z = sz * c_axes[wt.kz];
+	f32_4x det_inv = set_f32_4x(1.0f) / det;
+
+	u = e_v * det_inv;
+	v = e_w * det_inv;
+	t = (e_u * a_z + e_v * b_z + e_w * c_z) * det_inv;
+
+	f32_4x hit = and_not(det != zero, outside) & (t > set_f32_4x(tolerance)) & (t < t_max);
+	return get_mask_bits(hit);
+}
+
+//Kernel family selected at compile time.
+//intersect returns t (<= 0 if missed) and sets u,v.
+//intersect_4x does the same for a packet and returns the lane bits of hits closer than t_max.
+template<TriangleCullMode mode>
+struct TriangleKernel;
+
+template<>
+struct TriangleKernel<TriangleCullMode::CULLED>
+{
+	static FORCEDINLINE f32 intersect(Ray& ray, Watertight_Ray&, TriangleVertices& tri, f32& u, f32& v)
+	{
+		return get_triangle_ray_intersection_culled(ray, tri, u, v);
+	}
+	static FORCEDINLINE uint32 intersect_4x(Ray_4x& ray_4x, Watertight_Ray&, TrianglePacket& packet, f32 t_max, f32_4x& t, f32_4x& u, f32_4x& v)
+	{
+		return get_triangle_ray_intersection_4x<TRUE>(ray_4x, packet, set_f32_4x(t_max), t, u, v);
+	}
+};
+
+template<>
+struct TriangleKernel<TriangleCullMode::TWO_SIDED>
+{
+	static FORCEDINLINE f32 intersect(Ray& ray, Watertight_Ray&, TriangleVertices& tri, f32& u, f32& v)
+	{
+		return get_triangle_ray_intersection_two_sided(ray, tri, u, v);
+	}
+	static FORCEDINLINE uint32 intersect_4x(Ray_4x& ray_4x, Watertight_Ray&, TrianglePacket& packet, f32 t_max, f32_4x& t, f32_4x& u, f32_4x& v)
+	{
+		return get_triangle_ray_intersection_4x<FALSE>(ray_4x, packet, set_f32_4x(t_max), t, u, v);
+	}
+};
+
+template<>
+struct TriangleKernel<TriangleCullMode::WATERTIGHT>
+{
+	static FORCEDINLINE f32 intersect(Ray& ray, Watertight_Ray& wt, TriangleVertices& tri, f32& u, f32& v)
+	{
+		return get_triangle_ray_intersection_watertight(ray, wt, tri, u, v);
+	}
+	static FORCEDINLINE uint32 intersect_4x(Ray_4x& ray_4x, Watertight_Ray& wt, TrianglePacket& packet, f32 t_max, f32_4x& t, f32_4x& u, f32_4x& v)
+	{
+		return get_triangle_ray_intersection_watertight_4x(ray_4x, wt, packet, set_f32_4x(t_max), t, u, v);
+	}
+};
+
 
 
 //Resizes the model into a max scale 
@@ -1,4 +1,6 @@
 #include "renderer.h"
+#include "bsdf.h"
+#include "sampler.h"
 #include "utilities/ATP/atp.h"
 
 static FORCEDINLINE vec3f get_reflection(vec3f incident, vec3f normal)
@@ -20,18 +22,52 @@ struct IntersectionData
 	f32 distance_at_intersection = 0;
 	vec3f normal = {0};
 	Material* hit_material = 0;
+	int32 object_id = -1;	//models, then spheres, then planes, in scene order (-1 for skybox)
 
 	TriangleIntersectionData tid = { 0 };
 };
 
 struct RayCastTools
 {
-	RNG_Stream* rng_stream;
+	Sampler* sampler;
 	DBuffer<KD_Node*>* hit_stack;
 	DBuffer<LeafNodePair>* leaf_stack;
 };
 
-void get_intersection_data(Ray& casted_ray, Scene& scene, IntersectionData& intersection_data, RayCastTools& tools)
+//Checks every face of the model. Returns TRUE if a face closer than intersection_data.distance_at_intersection was hit.
+template<TriangleCullMode mode>
+static b32 get_model_intersection_brute_force(Ray& casted_ray, Model& model, IntersectionData& intersection_data)
+{
+	b32 hit = FALSE;
+	Watertight_Ray wt_ray;
+	if (mode == TriangleCullMode::WATERTIGHT)
+	{
+		SetWatertightRay(wt_ray, casted_ray);
+	}
+	for (uint32 j = 0; j < model.data.faces_vertices.size; j++)
+	{
+		TriangleVertices tri;
+		tri.a = model.data.vertices[model.data.faces_vertices[j].vertex_indices[0]];
+		tri.b = model.data.vertices[model.data.faces_vertices[j].vertex_indices[1]];
+		tri.c = model.data.vertices[model.data.faces_vertices[j].vertex_indices[2]];
+
+		f32 u, v;
+		//TODO: check if passing by value or manually inlining is faster for checking intersection
+		f32 t = TriangleKernel<mode>::intersect(casted_ray, wt_ray, tri, u, v);
+		if (t > tolerance && t < intersection_data.distance_at_intersection)
+		{
+			intersection_data.distance_at_intersection = t;
+			intersection_data.tid.u = u;
+			intersection_data.tid.v = v;
+			intersection_data.tid.face_index = j;
+			hit = TRUE;
+		}
+	}
+	return hit;
+}
+
+template<Accelerator accelerator>
+static void get_intersection_data(Ray& casted_ray, Scene& scene, IntersectionData& intersection_data, RayCastTools& tools)
 {
 	intersection_data.distance_at_intersection = MAX_FLOAT;
 	Sphere* nearest_sphere = nullptr;
@@ -46,53 +82,45 @@ void get_intersection_data(Ray& casted_ray, Scene& scene, IntersectionData& inte
 	
 	for (int32 i = 0; i < scene.models.length; i++)
 	{
-#if defined(USE_KD_TREE)
-		TriangleIntersectionData td;
-		f32 t = get_ray_kd_tree_intersection(op_ray, scene.models[i].kd_tree, td, tools.hit_stack->front, tools.leaf_stack->front);
-		if (t > tolerance && t < intersection_data.distance_at_intersection)
+		if (accelerator == Accelerator::KD_TREE)
 		{
-			intersection_data.distance_at_intersection = t;
-			intersection_data.tid = td;
-			nearest_model = &scene.models[i];
+			TriangleIntersectionData td;
+			f32 t = get_ray_kd_tree_intersection(op_ray, scene.models[i].kd_tree, scene.models[i].cull_mode, td, tools.hit_stack->front, tools.leaf_stack->front);
+			if (t > tolerance && t < intersection_data.distance_at_intersection)
+			{
+				intersection_data.distance_at_intersection = t;
+				intersection_data.tid = td;
+				nearest_model = &scene.models[i];
+			}
 		}
-#else
-		if (get_ray_AABB_intersection(op_ray, scene.models[i].surrounding_aabb))
+		else if (get_ray_AABB_intersection(op_ray, scene.models[i].surrounding_aabb))
 		{
-			for (uint32 j = 0; j < scene.models[i].data.faces_vertices.size; j++)
+			b32 hit = FALSE;
+			switch (scene.models[i].cull_mode)
 			{
-				TriangleVertices tri;
-				tri.a = scene.models[i].data.vertices[scene.models[i].data.faces_vertices[j].vertex_indices[0]];
-				tri.b = scene.models[i].data.vertices[scene.models[i].data.faces_vertices[j].vertex_indices[1]];
-				tri.c = scene.models[i].data.vertices[scene.models[i].data.faces_vertices[j].vertex_indices[2]];
-
-				f32 u, v;
-				//TODO: check if passing by value or manually inlining is faster for checking intersection
-				f32 t = get_triangle_ray_intersection_culled(casted_ray, tri, u, v);
-				if (t > tolerance && t < intersection_data.distance_at_intersection)
-				{
-					intersection_data.distance_at_intersection = t;
-					intersection_data.tid.u = u;
-					intersection_data.tid.v = v;
-					intersection_data.tid.face_index = j;
-					nearest_model = &scene.models[i];
-				}
+			case TriangleCullMode::CULLED:
+				hit = get_model_intersection_brute_force<TriangleCullMode::CULLED>(casted_ray, scene.models[i], intersection_data);
+				break;
+			case TriangleCullMode::TWO_SIDED:
+				hit = get_model_intersection_brute_force<TriangleCullMode::TWO_SIDED>(casted_ray, scene.models[i], intersection_data);
+				break;
+			case TriangleCullMode::WATERTIGHT:
+				hit = get_model_intersection_brute_force<TriangleCullMode::WATERTIGHT>(casted_ray, scene.models[i], intersection_data);
+				break;
 			}
-			
-		}		
-#endif
-
+			if (hit)
+			{
+				nearest_model = &scene.models[i];
+			}
+		}
 	}
 
-	for (int i = 0; i < scene.spheres.length; i++)
+	int32 sphere_index;
+	f32 sphere_t = get_ray_sphere_bvh_intersection(op_ray, scene.sphere_bvh, intersection_data.distance_at_intersection, sphere_index);
+	if (sphere_index != -1)
 	{
-		Sphere* spr = &scene.spheres[i];
-
-		f32 t = get_sphere_ray_intersection(casted_ray, *spr);
-		if (t > tolerance && t < intersection_data.distance_at_intersection)
-		{
-			intersection_data.distance_at_intersection = t;
-			nearest_sphere = spr;
-		}
+		intersection_data.distance_at_intersection = sphere_t;
+		nearest_sphere = &scene.spheres[sphere_index];
 	}
 	for (int i = 0; i < scene.planes.length; i++)
 	{
@@ -111,12 +139,14 @@ void get_intersection_data(Ray& casted_ray, Scene& scene, IntersectionData& inte
 	if (nearest_plane != nullptr)	//nearest hit is a plane
 	{
 		intersection_data.type = ObjectType::PLANE;
+		intersection_data.object_id = scene.models.length + scene.spheres.length + (int32)(nearest_plane - scene.planes.front);
 		intersection_data.normal = nearest_plane->normal;
 		intersection_data.hit_material = nearest_plane->material;
 	}
 	else if (nearest_sphere != nullptr)	//nearest hit is a sphere
 	{
 		intersection_data.type = ObjectType::SPHERE;
+		intersection_data.object_id = scene.models.length + (int32)(nearest_sphere - scene.spheres.front);
 		intersection_data.normal = casted_ray.at(intersection_data.distance_at_intersection) - nearest_sphere->center;
 		intersection_data.hit_material = nearest_sphere->material;
 	}
@@ -124,6 +154,7 @@ void get_intersection_data(Ray& casted_ray, Scene& scene, IntersectionData& inte
 	else if (nearest_model != nullptr)	//nearest hit is a triangle
 	{
 		intersection_data.type = ObjectType::TRIANGLE;
+		intersection_data.object_id = (int32)(nearest_model - scene.models.front);
 		//Smooth Shading
 		vec3f normal_a, normal_b, normal_c;
 		if (nearest_model->data.normals.size > 0)
@@ -153,6 +184,7 @@ void get_intersection_data(Ray& casted_ray, Scene& scene, IntersectionData& inte
 		//TODO: proper skybox intersection. Maybe cube map
 		intersection_data.hit_material = &scene.materials[0];	//material 0 is skybox
 		intersection_data.type = ObjectType::SKYBOX;
+		intersection_data.object_id = -1;
 	}
 	normalize(intersection_data.normal);
 
@@ -209,218 +241,823 @@ void get_intersection_data(Ray& casted_ray, Scene& scene, IntersectionData& inte
 //}
 
 
-//returns color from casting ray into scene
-static vec3f cast_ray(Ray& ray, Scene& scene, int32 bounce_limit, int64& ray_casts, RayCastTools& tools )
+//Samples a point on a light and returns its contribution to the surface at hit_point (not scaled by the path weight).
+//Weighted against the chance of the bsdf sample finding the same light (multiple importance sampling), unless
+//last_bounce: no bsdf sample is traced after the last bounce, so the light sample gets all the weight then.
+template<Accelerator accelerator>
+static vec3f sample_direct_light(Scene& scene, vec3f hit_point, vec3f normal, vec3f wo, Material& material, b32 last_bounce, int64& ray_casts, RayCastTools& tools)
 {
+	LightSample ls;
+	f32 u_light = get_sample_1d(*tools.sampler);
+	vec2f u = get_sample_2d(*tools.sampler);
+	if (!sample_light(scene.lights, hit_point, u_light, u.x, u.y, ls))
+	{
+		return { 0,0,0 };
+	}
+	vec3f to_light = ls.position - hit_point;
+	f32 dist_sqr = mag2(to_light);
+	f32 dist = sqroot(dist_sqr);
+	to_light = to_light / dist;
+	f32 cos_light = -dot(ls.normal, to_light);
+	if (cos_light < 0 && !ls.one_sided)
+	{
+		cos_light = -cos_light;	//two sided emitters emit from both faces
+	}
+	if (cos_light <= tolerance)
+	{
+		return { 0,0,0 };
+	}
+	f32 bsdf_pdf;
+	vec3f bsdf_cos = evaluate_bsdf(material, normal, wo, to_light, bsdf_pdf);
+	if (bsdf_pdf <= 0.0f)
+	{
+		return { 0,0,0 };
+	}
+
+	//shadow ray. Light is visible if nothing is hit before reaching the sampled point.
+	Ray shadow_ray = { hit_point, to_light };
+	IntersectionData shadow_id;
+	get_intersection_data<accelerator>(shadow_ray, scene, shadow_id, tools);
+	ray_casts++;
+	if (shadow_id.distance_at_intersection < dist * 0.999f)
+	{
+		return { 0,0,0 };
+	}
+
+	f32 light_pdf = ls.pdf_area * dist_sqr / cos_light;	//converted to solid angle
+	f32 mis = last_bounce ? 1.0f : get_mis_weight(light_pdf, bsdf_pdf);
+	return hadamard(ls.emission, bsdf_cos) * (mis / light_pdf);
+}
+
+//Render kernels are compiled separately for paths that end at the first hit (no bsdf sampling at all) and ones that bounce
+enum class BounceClass
+{
+	SINGLE,		//bounce_limit of 1
+	MULTIPLE
+};
+
+//returns color from casting ray into scene. first_hit gets what the ray hit first (before bouncing).
+//NOTE: next_event_estimation and russian_roulette are the settings of rs, passed in as template parameters.
+template<Accelerator accelerator, BounceClass bounce_class, b32 next_event_estimation, b32 russian_roulette>
+static vec3f cast_ray(Ray& ray, Scene& scene, RenderSettings& rs, int64& ray_casts, RayCastTools& tools, FirstHit& first_hit)
+{
+	int32 bounce_limit = bounce_class == BounceClass::SINGLE ? 1 : rs.bounce_limit;
 	int i;
 	vec3f return_color = { 0,0,0 };
 	vec3f weight = { 1.0f,1.0f,1.0f };
 	Ray casted_ray = ray;
 	IntersectionData id;
+	b32 sample_lights = next_event_estimation && scene.lights.total_power > 0.0f;
+	f32 bounce_pdf = 0;	//solid angle pdf of the last bounce if lights were sampled where it started, 0 otherwise
 
 
 	for (i = 0; i < bounce_limit; i++)
 	{
 		
-		get_intersection_data(casted_ray, scene, id, tools);
+		get_intersection_data<accelerator>(casted_ray, scene, id, tools);
 
 		if (id.type == ObjectType::SKYBOX)
 		{
 			return_color += hadamard(weight , id.hit_material->emission_color);	
+			if (i == 0)
+			{
+				first_hit.depth = 0;
+				first_hit.normal = { 0,0,0 };
+				first_hit.albedo = id.hit_material->emission_color;
+				first_hit.position = { 0,0,0 };
+				first_hit.object_id = -1;
+				first_hit.face_id = -1;
+			}
 			break;
 		}
 
+		//hit the back face (two-sided triangles, inside of spheres, planes from behind). Shading it as the front face.
 		f32 attenuation = dot(-casted_ray.direction, id.normal);
-		if (attenuation < 0)
+		b32 back_face = attenuation < 0;
+		if (back_face)
 		{
 			id.normal = -id.normal;
-			attenuation = 0;
+			attenuation = -attenuation;
+		}
+		if (i == 0)
+		{
+			first_hit.depth = id.distance_at_intersection;
+			first_hit.normal = id.normal;
+			first_hit.albedo = id.hit_material->reflection_color;
+			first_hit.position = casted_ray.at(id.distance_at_intersection);
+			first_hit.object_id = id.object_id;
+			first_hit.face_id = id.type == ObjectType::TRIANGLE ? (int32)id.tid.face_index : -1;
 		}
 
-		//reflected ray
-		vec3f pure_bounce;
-		pure_bounce = casted_ray.direction - (id.normal * (2 * dot(casted_ray.direction, id.normal)));
-		normalize(pure_bounce);
-			
-		//random ray
-		vec3f random_bounce = {rand_bi(tools.rng_stream), rand_bi(tools.rng_stream), rand_bi(tools.rng_stream)};
-		random_bounce += id.normal;
-		normalize(random_bounce);
+		//Emission. If the light was also sampled at the last bounce, only the MIS weighted part is added here.
+		Material& material = *id.hit_material;
+		if (bounce_pdf > 0.0f && (id.type == ObjectType::SPHERE || id.type == ObjectType::TRIANGLE) && attenuation > tolerance)
+		{
+			//NOTE: light samples never reach the back face of a one sided emitter, so hits on one get all the weight here
+			b32 one_sided_back_face = back_face && id.type == ObjectType::TRIANGLE && scene.models[id.object_id].cull_mode == TriangleCullMode::CULLED;
+			f32 light_pdf = one_sided_back_face ? 0.0f : get_light_pdf_area(scene.lights, material, id.type == ObjectType::SPHERE) * 
+				id.distance_at_intersection * id.distance_at_intersection / attenuation;
+			return_color += hadamard(weight, material.emission_color) * get_mis_weight(bounce_pdf, light_pdf);
+		}
+		else
+		{
+			return_color += hadamard(weight, material.emission_color);
+		}
 
-		//final reflected ray
+		vec3f wo = -casted_ray.direction;
 		casted_ray.origin = casted_ray.at(id.distance_at_intersection);
-		casted_ray.direction = lerp(random_bounce, pure_bounce, id.hit_material->scatter);
-		normalize(casted_ray.direction);
 
-		//Shading
-		vec3f reflection_amount = id.hit_material->reflection_color;
-		return_color += hadamard(weight, id.hit_material->emission_color);
-		weight = hadamard(weight, id.hit_material->reflection_color * attenuation);
+		b32 last_bounce = bounce_class == BounceClass::SINGLE || i + 1 == bounce_limit;
+		if (sample_lights)
+		{
+			return_color += hadamard(weight, sample_direct_light<accelerator>(scene, casted_ray.origin, id.normal, wo, material, last_bounce, ray_casts, tools));
+		}
+		//no need to pick the next direction after the last bounce
+		if (last_bounce)
+		{
+			i++;	//ray of this bounce was still cast
+			break;
+		}
+
+		BSDF_Sample bs;
+		f32 u_lobe = get_sample_1d(*tools.sampler);
+		vec2f u = get_sample_2d(*tools.sampler);
+		if (!sample_bsdf(material, id.normal, wo, u_lobe, u.x, u.y, bs))
+		{
+			i++;	//ray of this bounce was still cast
+			break;
+		}
+		casted_ray.direction = bs.direction;
+		bounce_pdf = sample_lights ? bs.pdf : 0.0f;
+		weight = hadamard(weight, bs.weight);
+
+		//Russian roulette: ending low contribution paths at random. Survivors are scaled by 1/survival so the result stays unbiased.
+		if (russian_roulette && i + 1 >= rs.russian_roulette_min_depth)
+		{
+			f32 survival = min(max(weight.x, max(weight.y, weight.z)), 0.95f);
+			if (get_sample_1d(*tools.sampler) >= survival)
+			{
+				i++;	//ray of this bounce was still cast
+				break;
+			}
+			weight = weight / survival;
+		}
 	}
 	ray_casts += i;
 	return  return_color;
 }
 
-void prep_scene(Scene &scene, uint32& kd_tree_max_nodes)
+struct BuildSphereBVHJob
+{
+	Scene* scene;
+};
+
+static void build_sphere_BVH_job(void* payload)
+{
+	BuildSphereBVHJob* job = (BuildSphereBVHJob*)payload;
+	build_sphere_BVH(job->scene->spheres, job->scene->sphere_bvh);
+}
+
+struct BuildKDTreeJob
+{
+	Model* model;
+	JobSystem* job_system;
+};
+
+static void build_KD_tree_job(void* payload)
+{
+	BuildKDTreeJob* job = (BuildKDTreeJob*)payload;
+	Model& model = *job->model;
+	build_KD_tree(model.data, model.kd_tree, *job->job_system);
+	if (model.data.normals.size > 0)
+	{
+		model.data.faces_vertices.clear();
+		model.data.vertices.clear();
+	}
+}
+
+//Builds the acceleration structures of the scene. Every tree is built as a job.
+void prep_scene(Scene &scene, Accelerator accelerator, uint32& kd_tree_max_nodes, JobSystem& job_system)
 {
 	kd_tree_max_nodes = 0;
 	for (int32 i = 0; i < scene.planes.length; i++)
 	{
 		normalize(scene.planes[i].normal);
 	}
-	for (int32 i = 0; i < scene.models.length; i++)
+
+	//NOTE: before the KD trees are built, as those free the vertices of models with normals
+	build_light_list(scene.lights, scene.spheres, scene.models);
+
+	JobCounter build_counter = {};
+	BuildSphereBVHJob sphere_job = { &scene };
+	submit_job(job_system, build_sphere_BVH_job, &sphere_job, sizeof(sphere_job), &build_counter);
+	//NOTE: brute force needs the vertices, which building a tree can free. So the trees are only built if they're used.
+	for (int32 i = 0; i < scene.models.length && accelerator == Accelerator::KD_TREE; i++)
 	{
-#if defined USE_KD_TREE
 		if (scene.models[i].kd_tree.tree.front == 0)
 		{
-			build_KD_tree(scene.models[i].data, scene.models[i].kd_tree);
-			if (scene.models[i].data.normals.size > 0)
-			{
-				scene.models[i].data.faces_vertices.clear();
-				scene.models[i].data.vertices.clear();
-			}
+			BuildKDTreeJob job = { &scene.models[i], &job_system };
+			submit_job(job_system, build_KD_tree_job, &job, sizeof(job), &build_counter);
 		}
+	}
+	wait_for_counter(job_system, build_counter);
+
+	for (int32 i = 0; i < scene.models.length; i++)
+	{
 		if (scene.models[i].kd_tree.tree.length > (int32)kd_tree_max_nodes)
 		{
 			kd_tree_max_nodes = scene.models[i].kd_tree.tree.length;
 		}
-#else
+	}
+}
+
+//Per worker scratch for casting rays
+struct RenderWorkerData
+{
+	Sampler sampler;
+	DBuffer<KD_Node*> hit_stack;	//a list of non-leaf nodes the ray hits and needs to traverse for KD traversal
+	DBuffer<LeafNodePair> leaf_stack;	//a list of leaf nodes the ray hits for KD traversal
+	RayCastTools tools;
+};
+
+static void setup_render_worker_data(RenderInfo& info)
+{
+	//NOTE: one extra for threads that aren't workers, since waiting on jobs can run them anywhere.
+	uint32 no_worker_data = info.job_system->workers.size + 1;
+	info.worker_data = (RenderWorkerData*)pl_buffer_alloc(no_worker_data * sizeof(RenderWorkerData));
+	for (uint32 i = 0; i < no_worker_data; i++)
+	{
+		RenderWorkerData& wd = info.worker_data[i];
+		wd.sampler.type = info.camera->render_settings.sampler;
+
+		wd.hit_stack.capacity = info.hit_stack_capacity;
+		wd.leaf_stack.capacity = info.leaf_stack_capacity;
+		wd.hit_stack.front = (KD_Node**)pl_buffer_alloc(wd.hit_stack.capacity * sizeof(KD_Node*));
+		wd.leaf_stack.front = (LeafNodePair*)pl_buffer_alloc((wd.leaf_stack.capacity + 1) * sizeof(LeafNodePair));
+		*wd.leaf_stack.front = { 0,-MAX_FLOAT };	//used as barrier in KD_traversal
+		wd.leaf_stack.front++;
 
-#endif
+		wd.tools.sampler = &wd.sampler;
+		wd.tools.leaf_stack = &wd.leaf_stack;
+		wd.tools.hit_stack = &wd.hit_stack;
 	}
 }
 
-ATP_REGISTER_M(Tiles, 0);
-static b32 render_tile_from_camera(RenderInfo& info, RayCastTools& tools)
+static void free_render_worker_data(RenderInfo& info)
 {
-	RenderTile* rt;
-	Tile* tile_;
-	int64 tile_no = interlocked_increment_i32(&info.twq.jobs_done);
-	if (tile_no > info.twq.jobs.size)
+	if (!info.worker_data)
 	{
-		interlocked_decrement_i32(&info.twq.jobs_done);
-		return false;
+		return;
 	}
-	else
+	uint32 no_worker_data = info.job_system->workers.size + 1;
+	for (uint32 i = 0; i < no_worker_data; i++)
 	{
-		rt = &info.twq.jobs[(int32)tile_no - 1];
+		info.worker_data[i].leaf_stack.front--;
+		info.worker_data[i].leaf_stack.clear_buffer();
+		info.worker_data[i].hit_stack.clear_buffer();
 	}
-	ATP_BLOCK_M(Tiles, (uint32)tile_no-1);
+	pl_buffer_free(info.worker_data);
+	info.worker_data = 0;
+}
 
+static FORCEDINLINE RayCastTools& get_worker_ray_cast_tools(RenderInfo& info)
+{
+	int32 worker_index = get_current_worker_index();
+	return info.worker_data[worker_index == -1 ? info.job_system->workers.size : (uint32)worker_index].tools;
+}
 
-	tile_ = &rt->tile;
-	vec3f pixel_pos;
+template<b32 anti_aliasing, Accelerator accelerator, BounceClass bounce_class, b32 next_event_estimation, b32 russian_roulette>
+static void render_tile_row(RenderInfo& info, RenderTile* rt, int32 pass, int32 row, RayCastTools& tools)
+{
+	RenderSettings& rs = info.camera->render_settings;
+	uint32 max_samples = get_max_samples_per_pixel(rs);
+	uint32 samples_per_pass = rs.samples_per_pass ? rs.samples_per_pass : max_samples;
+	//NOTE: pixels get samples up to the pass's total rather than a fixed count, so pixels that already have them (film
+	//restored from a checkpoint) are skipped and the rest continue from their own count
+	uint32 pass_sample_target = min((pass + 1) * samples_per_pass, max_samples);
+	b32 adaptive = rs.adaptive_threshold > 0.0f;
+	b32 row_converged = TRUE;
+	int64 ray_casts = 0;
+
+	Tile* tile_ = &rt->tile;
+	int32 y = tile_->left_bottom.y + row;
+
+	f32 film_y = -1.0f + 2.0f * ((f32)y / (f32)rs.resolution.y);
 
-	for (int32 y = tile_->left_bottom.y; y <= tile_->right_top.y; y++)
+	b32 cancelled = FALSE;
+	for (int32 x = tile_->left_bottom.x; x <= tile_->right_top.x; x++)
 	{
+		//NOTE: checked per pixel so a cancel (ex: time budget) doesn't wait for whole rows. Every pixel's samples are
+		//added at once, so the film never has half a pixel.
+		if (info.cancel)
+		{
+			cancelled = TRUE;
+			break;
+		}
+		/*if (x == 645 && y == 452)	//to debug a single pixel
+		{
+			__debugbreak();
+		}
+		else
+		{
+			continue;
+		}*/
+		if (adaptive && is_film_pixel_converged(*info.film, x, y, rs.adaptive_threshold, rs.min_samples_per_pixel))
+		{
+			continue;
+		}
+		row_converged = FALSE;
+		uint32 pixel_samples = info.film->sample_count[y * info.film->width + x];
+		if (pixel_samples >= pass_sample_target)
+		{
+			continue;
+		}
+		uint32 pass_samples = pass_sample_target - pixel_samples;
 
-		f32 film_y = -1.0f + 2.0f * ((f32)y / (f32)info.camera->render_settings.resolution.y);
+		f32 film_x = (-1.0f + 2.0f * ((f32)x / (f32)rs.resolution.x)) * info.camera->h_fov * info.camera->aspect_ratio;
 
-		for (int32 x = tile_->left_bottom.x; x <= tile_->right_top.x; x++)
+		vec3f flt_pixel_color;
+		f32 luminance_sqr_sum = 0;
+		uint32 pixel_seed = get_pixel_seed(x, y, rs.frame, rs.seed);
+		uint32 first_sample = rs.sample_offset + pixel_samples;
+		FirstHit first_hit_sum = {};
+		FirstHit first_hit = {};
+		vec3f sample;
+		Ray ray = {};
+		vec3f pixel_pos;
+
+		if (anti_aliasing)
 		{
-			/*if (x == 645 && y == 452)	//to debug a single pixel
+			for (uint32 i = 0; i < pass_samples; i++)
 			{
-				__debugbreak();
+				start_pixel_sample(*tools.sampler, pixel_seed, first_sample + i);
+				vec2f jitter = get_sample_2d(*tools.sampler);
+				f32 x_off = (2.0f * jitter.x - 1.0f) * info.camera->half_pixel_width + film_x;
+				f32 y_off = (2.0f * jitter.y - 1.0f) * info.camera->half_pixel_height + film_y;
+				pixel_pos = info.camera->frame_center + (info.camera->camera_x * x_off) + (info.camera->camera_y * y_off);
+				SetRay(ray, info.camera->eye, pixel_pos);
+
+				sample = cast_ray<accelerator, bounce_class, next_event_estimation, russian_roulette>(ray, *info.scene, rs, ray_casts, tools, first_hit);
+				flt_pixel_color += sample;
+				first_hit_sum.depth += first_hit.depth;
+				first_hit_sum.normal += first_hit.normal;
+				first_hit_sum.albedo += first_hit.albedo;
+				first_hit_sum.position += first_hit.position;
+				luminance_sqr_sum += luminance(sample) * luminance(sample);
 			}
-			else
+		}
+		else
+		{
+			pixel_pos = info.camera->frame_center + (info.camera->camera_x * film_x) + (info.camera->camera_y * film_y);
+			SetRay(ray, info.camera->eye, pixel_pos);
+
+			for (uint32 i = 0; i < pass_samples; i++)
 			{
-				continue;
-			}*/
-			f32 film_x = (-1.0f + 2.0f * ((f32)x / (f32)info.camera->render_settings.resolution.x)) * info.camera->h_fov * info.camera->aspect_ratio;
+				start_pixel_sample(*tools.sampler, pixel_seed, first_sample + i);
+				sample = cast_ray<accelerator, bounce_class, next_event_estimation, russian_roulette>(ray, *info.scene, rs, ray_casts, tools, first_hit);
+				flt_pixel_color += sample;
+				first_hit_sum.depth += first_hit.depth;
+				first_hit_sum.normal += first_hit.normal;
+				first_hit_sum.albedo += first_hit.albedo;
+				first_hit_sum.position += first_hit.position;
+				luminance_sqr_sum += luminance(sample) * luminance(sample);
+			}
+		}
+
+		add_samples_to_film(*info.film, x, y, flt_pixel_color, luminance_sqr_sum, pass_samples);
+		add_first_hits_to_film(*info.film, x, y, first_hit_sum, first_hit);
+	}
+	//NOTE: resolved once per row so the conversion to 8-bit can be done 4 pixels at a time
+	if (!row_converged)
+	{
+		resolve_film_row(*info.film, *info.camera_tex, tile_->left_bottom.x, y, tile_->right_top.x - tile_->left_bottom.x + 1);
+	}
 
-			vec3b pixel_color;
-			vec3f flt_pixel_color;
+	interlocked_add_i64(&rt->ray_casts, ray_casts);
+	if (cancelled)
+	{
+		return;	//the pass is over, and the skipped pixels don't say anything about convergence
+	}
+	if (!row_converged)
+	{
+		rt->pass_sampled = TRUE;
+	}
+
+	//last row of the pass to finish (not necessarily the last row of the tile) ends the tile's pass
+	int32 no_rows = tile_->right_top.y - tile_->left_bottom.y + 1;
+	if (interlocked_increment_i32(&rt->rows_done) == no_rows)
+	{
+		rt->converged = adaptive && !rt->pass_sampled;
+		interlocked_increment_i32(&info.tiles_done);
+	}
+}
+
+//----<Tile row kernels>----
+//Every combination of the settings below gets its own render_tile_row, so none of them are checked per pixel or per bounce.
+//Indexed [anti_aliasing][accelerator][bounce_class][next_event_estimation][russian_roulette].
+//NOTE: single bounce paths never get to russian roulette, so both of its entries are the same kernel.
+#define TILE_ROW_KERNELS_MULTIPLE(aa, accel, nee) { render_tile_row<aa, accel, BounceClass::MULTIPLE, nee, FALSE>, render_tile_row<aa, accel, BounceClass::MULTIPLE, nee, TRUE> }
+#define TILE_ROW_KERNELS_SINGLE(aa, accel, nee) { render_tile_row<aa, accel, BounceClass::SINGLE, nee, FALSE>, render_tile_row<aa, accel, BounceClass::SINGLE, nee, FALSE> }
+#define TILE_ROW_KERNELS_BOUNCES(aa, accel) \
+	{ { TILE_ROW_KERNELS_SINGLE(aa, accel, FALSE), TILE_ROW_KERNELS_SINGLE(aa, accel, TRUE) }, \
+	  { TILE_ROW_KERNELS_MULTIPLE(aa, accel, FALSE), TILE_ROW_KERNELS_MULTIPLE(aa, accel, TRUE) } }
+#define TILE_ROW_KERNELS_ACCELERATORS(aa) { TILE_ROW_KERNELS_BOUNCES(aa, Accelerator::KD_TREE), TILE_ROW_KERNELS_BOUNCES(aa, Accelerator::BRUTE_FORCE) }
+
+static const TileRowKernel tile_row_kernels[2][2][2][2][2] =
+{
+	TILE_ROW_KERNELS_ACCELERATORS(FALSE),
+	TILE_ROW_KERNELS_ACCELERATORS(TRUE)
+};
+
+#undef TILE_ROW_KERNELS_MULTIPLE
+#undef TILE_ROW_KERNELS_SINGLE
+#undef TILE_ROW_KERNELS_BOUNCES
+#undef TILE_ROW_KERNELS_ACCELERATORS
+
+static TileRowKernel get_tile_row_kernel(RenderSettings& rs)
+{
+	BounceClass bounce_class = rs.bounce_limit == 1 ? BounceClass::SINGLE : BounceClass::MULTIPLE;
+	return tile_row_kernels[rs.anti_aliasing ? 1 : 0][(int32)rs.accelerator][(int32)bounce_class][rs.next_event_estimation ? 1 : 0][rs.russian_roulette ? 1 : 0];
+}
+//----</Tile row kernels>----
+
+//A tile job renders a range of rows of a tile for one pass
+struct TileJob
+{
+	RenderInfo* info;
+	RenderTile* tile;
+	int32 pass;
+	int32 first_row;	//offset from tile.left_bottom.y
+	int32 end_row;		//one past the last row
+};
+
+static void render_tile_job(void* payload);
+
+static void render_tile_rows(TileJob& job)
+{
+	RenderInfo& info = *job.info;
+	RayCastTools& tools = get_worker_ray_cast_tools(info);
+	for (int32 row = job.first_row; row < job.end_row; row++)
+	{
+		if (info.cancel)
+		{
+			return;
+		}
+		//NOTE: when some worker is out of jobs, the 2nd half of the remaining rows is split off into a new job for it.
+		//That way a few expensive tiles at the end of a pass get shared instead of keeping single workers busy while the rest idle.
+		if (job.end_row - row >= 2 && has_idle_workers(*info.job_system))
+		{
+			TileJob split = job;
+			split.first_row = (row + job.end_row) / 2;
+			job.end_row = split.first_row;
+			submit_job(*info.job_system, render_tile_job, &split, sizeof(split), &info.pass_counter);
+		}
+		info.tile_row_kernel(info, job.tile, job.pass, row, tools);
+	}
+}
+
+ATP_REGISTER_M(Tiles, 0);
+static void render_tile_job(void* payload)
+{
+	TileJob& job = *(TileJob*)payload;
+	if (job.first_row == 0)	//only profiling the job that started the tile
+	{
+		ATP_BLOCK_M(Tiles, (uint32)(job.tile - job.info->tiles.front));
+		render_tile_rows(job);
+	}
+	else
+	{
+		render_tile_rows(job);
+	}
+}
+
+struct EndPassJob
+{
+	RenderInfo* info;
+};
+
+static void submit_pass(RenderInfo& info, int32 pass);
+
+//runs once all tile jobs of a pass are done
+static void end_pass_job(void* payload)
+{
+	RenderInfo& info = *((EndPassJob*)payload)->info;
+	int32 next_pass = info.current_pass + 1;
+	if (!info.cancel && next_pass < (int32)info.no_passes)
+	{
+		submit_pass(info, next_pass);
+	}
+}
+
+//Submits a job per tile that isn't converged yet, and end_pass_job to run after all of them.
+//NOTE: render_counter doesn't reach 0 till the last pass is done, as every end_pass_job submits the next one before it finishes.
+static void submit_pass(RenderInfo& info, int32 pass)
+{
+	info.current_pass = pass;
+	info.tiles_done = 0;
+	//NOTE: passes after the first are submitted from a worker, which pops its own jobs newest first.
+	//Tiles are submitted back to front then, so they still get picked up in tile order.
+	b32 reverse = get_current_worker_index() != -1;
+	for (int32 t = 0; t < info.tiles.size; t++)
+	{
+		RenderTile* rt = &info.tiles[reverse ? info.tiles.size - 1 - t : t];
+		rt->rows_done = 0;
+		rt->pass_sampled = FALSE;
+		if (rt->converged)
+		{
+			interlocked_increment_i32(&info.tiles_done);
+			continue;
+		}
+		TileJob job = { &info, rt, pass, 0, rt->tile.right_top.y - rt->tile.left_bottom.y + 1 };
+		submit_job(*info.job_system, render_tile_job, &job, sizeof(job), &info.pass_counter);
+	}
+	EndPassJob end_job = { &info };
+	submit_job_after(*info.job_system, info.pass_counter, end_pass_job, &end_job, sizeof(end_job), &info.render_counter);
+}
+
+
+//----<Reprojection>----
+#define REPROJECTION_ROWS_PER_JOB 8
+
+struct ReprojectJob
+{
+	RenderInfo* info;
+	Film* previous;
+	Camera* previous_camera;
+	int32 first_row;
+	int32 end_row;	//one past the last row
+	volatile int64* pixels_kept;
+};
+
+//Moves pixel from_index of from to index of film with at most REPROJECTION_MAX_SAMPLES samples. depth is the pixel's
+//depth from the new camera.
+static void reproject_film_pixel(Film& film, uint32 index, Film& from, uint32 from_index, f32 depth)
+{
+	uint32 no_samples = from.sample_count[from_index];
+	f32 scale = 1.0f;
+	if (no_samples > REPROJECTION_MAX_SAMPLES)
+	{
+		scale = (f32)REPROJECTION_MAX_SAMPLES / (f32)no_samples;
+		no_samples = REPROJECTION_MAX_SAMPLES;
+	}
+	film.accumulated[index] = from.accumulated[from_index] * scale;
+	film.luminance_sqr[index] = from.luminance_sqr[from_index] * scale;
+	film.sample_count[index] = no_samples;
+	film.depth[index] = depth * (f32)no_samples;
+	if (film.aovs & AOV_NORMAL) film.normal[index] = from.normal[from_index] * scale;
+	if (film.aovs & AOV_ALBEDO) film.albedo[index] = from.albedo[from_index] * scale;
+	if (film.aovs & AOV_POSITION) film.position[index] = from.position[from_index] * scale;
+	if (film.aovs & AOV_OBJECT_ID) film.object_id[index] = from.object_id[from_index];
+	if (film.aovs & AOV_FACE_ID) film.face_id[index] = from.face_id[from_index];
+}
+
+static void clear_film_pixel(Film& film, uint32 index)
+{
+	film.accumulated[index] = { 0,0,0 };
+	film.luminance_sqr[index] = 0;
+	film.sample_count[index] = 0;
+	film.depth[index] = 0;
+	if (film.aovs & AOV_NORMAL) film.normal[index] = { 0,0,0 };
+	if (film.aovs & AOV_ALBEDO) film.albedo[index] = { 0,0,0 };
+	if (film.aovs & AOV_POSITION) film.position[index] = { 0,0,0 };
+	if (film.aovs & AOV_OBJECT_ID) film.object_id[index] = -1;
+	if (film.aovs & AOV_FACE_ID) film.face_id[index] = -1;
+}
+
+template<Accelerator accelerator>
+static void reproject_rows(ReprojectJob& job)
+{
+	RenderInfo& info = *job.info;
+	Film& film = *info.film;
+	Film& previous = *job.previous;
+	Camera& cm = *info.camera;
+	Camera& previous_cm = *job.previous_camera;
+	RenderSettings& rs = cm.render_settings;
+	RayCastTools& tools = get_worker_ray_cast_tools(info);
+	int64 kept = 0;
+	for (int32 y = job.first_row; y < job.end_row; y++)
+	{
+		f32 film_y = -1.0f + 2.0f * ((f32)y / (f32)rs.resolution.y);
+		for (int32 x = 0; x < (int32)film.width; x++)
+		{
+			//same ray as a render without anti aliasing
+			f32 film_x = (-1.0f + 2.0f * ((f32)x / (f32)rs.resolution.x)) * cm.h_fov * cm.aspect_ratio;
 			Ray ray = {};
-			vec3f pixel_pos;
+			SetRay(ray, cm.eye, cm.frame_center + (cm.camera_x * film_x) + (cm.camera_y * film_y));
+			IntersectionData id;
+			get_intersection_data<accelerator>(ray, *info.scene, id, tools);
 
-			if (info.camera->render_settings.anti_aliasing)
+			//NOTE: the skybox is at infinity, so only the direction says where the previous camera saw it
+			b32 skybox = id.type == ObjectType::SKYBOX;
+			vec3f hit_point = ray.at(id.distance_at_intersection);
+			vec3f from_previous_eye = skybox ? ray.direction : hit_point - previous_cm.eye;
+			uint32 index = y * film.width + x;
+			int32 previous_x, previous_y;
+			b32 valid = get_camera_pixel(previous_cm, from_previous_eye, previous_x, previous_y);
+			uint32 previous_index = valid ? previous_y * previous.width + previous_x : 0;
+			uint32 previous_samples = valid ? previous.sample_count[previous_index] : 0;
+			if (previous_samples > 0)
 			{
-				for (uint32 i = 0; i < info.camera->render_settings.samples_per_pixel; i++)
-				{
-					f32 x_off = rand_bi(tools.rng_stream) * info.camera->half_pixel_width + film_x;
-					f32 y_off = rand_bi(tools.rng_stream) * info.camera->half_pixel_height + film_y;
-					pixel_pos = info.camera->frame_center + (info.camera->camera_x * x_off) + (info.camera->camera_y * y_off);
-					SetRay(ray, info.camera->eye, pixel_pos);
-
-					flt_pixel_color += cast_ray(ray, *info.scene, info.camera->render_settings.bounce_limit, rt->ray_casts, tools);
-				}
+				//disocclusion: the previous pixel saw something in front of (or behind) the point. Pixels on edges have a
+				//depth between the two surfaces, so those start over too. The skybox has depth 0.
+				f32 previous_depth = previous.depth[previous_index] / (f32)previous_samples;
+				f32 expected_depth = skybox ? 0.0f : mag(from_previous_eye);
+				f32 difference = previous_depth - expected_depth;
+				difference = difference < 0 ? -difference : difference;
+				valid = difference <= REPROJECTION_DEPTH_TOLERANCE * expected_depth;
+			}
+			if (previous_samples > 0 && valid)
+			{
+				reproject_film_pixel(film, index, previous, previous_index, skybox ? 0.0f : id.distance_at_intersection);
+				kept++;
 			}
 			else
 			{
-				pixel_pos = info.camera->frame_center + (info.camera->camera_x * film_x) + (info.camera->camera_y * film_y);
-				SetRay(ray, info.camera->eye, pixel_pos);
-
-				for (uint32 i = 0; i < info.camera->render_settings.samples_per_pixel; i++)
-				{
-					flt_pixel_color += cast_ray(ray, *info.scene, info.camera->render_settings.bounce_limit, rt->ray_casts, tools);
-				}
+				clear_film_pixel(film, index);
 			}
-			flt_pixel_color = flt_pixel_color / (f32)info.camera->render_settings.samples_per_pixel;
-
-			flt_pixel_color = clamp(flt_pixel_color, 0.0f, 1.0f);
-			//flt_pixel_color = rgb_gamma_correct(flt_pixel_color);
-			//flt_pixel_color = linear_to_srgb(flt_pixel_color);
-			pixel_color = rgb_float_to_byte(flt_pixel_color);
-
-			Set_Pixel(pixel_color, *info.camera_tex, x, y);
 		}
 	}
-	return true;
+	interlocked_add_i64(job.pixels_kept, kept);
 }
 
-static void start_tile_render_thread(void* data)
+static void reproject_job(void* payload)
 {
-	RenderInfo* info = (RenderInfo*)data;
-	
+	ReprojectJob& job = *(ReprojectJob*)payload;
+	if (job.info->camera->render_settings.accelerator == Accelerator::KD_TREE)
+	{
+		reproject_rows<Accelerator::KD_TREE>(job);
+	}
+	else
+	{
+		reproject_rows<Accelerator::BRUTE_FORCE>(job);
+	}
+}
 
-	RNG_Stream rng_stream;
-	rng_stream.state = pl_get_hardware_entropy();
-	rng_stream.stream = (uint64)pl_get_thread_id();
+uint32 reproject_film(RenderInfo& info, Film& previous, Camera& previous_camera, JobSystem& job_system)
+{
+	ASSERT(is_counter_done(info.render_counter));	//render still going
+	Film& film = *info.film;
+	ASSERT(&film != &previous && film.width == previous.width && film.height == previous.height && film.aovs == previous.aovs);
+	ASSERT(film.aovs & AOV_DEPTH);
+	info.job_system = &job_system;
+	setup_render_worker_data(info);
 
-	DBuffer<KD_Node*> hit_stack;	//a list of non-leaf nodes the ray hits and needs to traverse for KD traversal
-	DBuffer<LeafNodePair> leaf_stack;	//a list of leaf nodes the ray hits for KD traversal
-	hit_stack.capacity = info->hit_stack_capacity;
-	leaf_stack.capacity = info->leaf_stack_capacity;
-	hit_stack.front = (KD_Node**)pl_buffer_alloc(hit_stack.capacity * sizeof(KD_Node*));
-	leaf_stack.front = (LeafNodePair*)pl_buffer_alloc(leaf_stack.capacity + 1 * sizeof(LeafNodePair));
-	*leaf_stack.front = { 0,-MAX_FLOAT };	//used as barrier in KD_traversal
-	leaf_stack.front++;
+	volatile int64 pixels_kept = 0;
+	JobCounter counter = {};
+	for (int32 y = 0; y < (int32)film.height; y += REPROJECTION_ROWS_PER_JOB)
+	{
+		ReprojectJob job = { &info, &previous, &previous_camera, y, min(y + REPROJECTION_ROWS_PER_JOB, (int32)film.height), &pixels_kept };
+		submit_job(job_system, reproject_job, &job, sizeof(job), &counter);
+	}
+	wait_for_counter(job_system, counter);
+	free_render_worker_data(info);
+
+	//the film changed, so tiles converged for the previous camera have to be checked again
+	for (int32 i = 0; i < info.tiles.size; i++)
+	{
+		info.tiles[i].converged = FALSE;
+	}
+	resolve_film(film, *info.camera_tex);
+	return (uint32)pixels_kept;
+}
+//----</Reprojection>----
 
-	RayCastTools tools;
-	tools.rng_stream = &rng_stream;
-	tools.leaf_stack = &leaf_stack;
-	tools.hit_stack = &hit_stack;
-	
-	while (render_tile_from_camera(*info, tools));
 
-	leaf_stack.front--;
-	leaf_stack.clear_buffer();
-	hit_stack.clear_buffer();
+//----<Tile ordering>----
+//Every tile gets a key from its position in the tile grid and tiles are sorted by it.
+
+static FORCEDINLINE uint64 get_morton_key(uint32 x, uint32 y)
+{
+	uint64 key = 0;
+	for (uint32 bit = 0; bit < 16; bit++)
+	{
+		key |= (uint64)((x >> bit) & 1) << (2 * bit);
+		key |= (uint64)((y >> bit) & 1) << (2 * bit + 1);
+	}
+	return key;
+}
+
+//distance along the hilbert curve covering a grid_size x grid_size grid (grid_size must be a power of 2)
+static FORCEDINLINE uint64 get_hilbert_key(uint32 x, uint32 y, uint32 grid_size)
+{
+	uint64 key = 0;
+	for (uint32 s = grid_size / 2; s > 0; s /= 2)
+	{
+		uint32 rx = (x & s) > 0;
+		uint32 ry = (y & s) > 0;
+		key += (uint64)s * s * ((3 * rx) ^ ry);
+		//rotating the quadrant
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = s - 1 - x;
+				y = s - 1 - y;
+			}
+			uint32 tmp = x;
+			x = y;
+			y = tmp;
+		}
+	}
+	return key;
+}
+
+//ring around the centre tile first, then position going counter clockwise along the ring
+static FORCEDINLINE uint64 get_spiral_key(int32 x, int32 y, int32 no_x_tiles, int32 no_y_tiles)
+{
+	//NOTE: coordinates are doubled so the centre lands on a tile even when the no of tiles is even
+	int32 dx = 2 * x - (no_x_tiles - 1);
+	int32 dy = 2 * y - (no_y_tiles - 1);
+	int32 ring = max(dx < 0 ? -dx : dx, dy < 0 ? -dy : dy);
+	int32 position;
+	if (dx == ring && dy > -ring)
+	{
+		position = dy + ring;
+	}
+	else if (dy == ring)
+	{
+		position = 2 * ring + (ring - dx);
+	}
+	else if (dx == -ring)
+	{
+		position = 4 * ring + (ring - dy);
+	}
+	else
+	{
+		position = 6 * ring + (dx + ring);
+	}
+	return ((uint64)ring << 32) | (uint64)position;
 }
 
+static void sort_tiles(FDBuffer<RenderTile>& tiles, TileOrder order, int32 tile_width, int32 tile_height, int32 no_x_tiles, int32 no_y_tiles)
+{
+	if (order == TileOrder::ROW_MAJOR)
+	{
+		return;	//already made in this order
+	}
+	uint32 grid_size = 1;
+	while (grid_size < (uint32)no_x_tiles || grid_size < (uint32)no_y_tiles)
+	{
+		grid_size *= 2;
+	}
+
+	FDBuffer<uint64, uint32> keys;
+	keys.allocate(tiles.size);
+	for (int32 i = 0; i < tiles.size; i++)
+	{
+		uint32 x = tiles[i].tile.left_bottom.x / tile_width;
+		uint32 y = tiles[i].tile.left_bottom.y / tile_height;
+		switch (order)
+		{
+		case TileOrder::MORTON: keys[i] = get_morton_key(x, y); break;
+		case TileOrder::HILBERT: keys[i] = get_hilbert_key(x, y, grid_size); break;
+		case TileOrder::SPIRAL: keys[i] = get_spiral_key(x, y, no_x_tiles, no_y_tiles); break;
+		default: keys[i] = i; break;
+		}
+	}
+
+	//insertion sort. There's only a few hundred tiles at most.
+	for (int32 i = 1; i < tiles.size; i++)
+	{
+		RenderTile tile = tiles[i];
+		uint64 key = keys[i];
+		int32 j = i - 1;
+		while (j >= 0 && keys[j] > key)
+		{
+			tiles[j + 1] = tiles[j];
+			keys[j + 1] = keys[j];
+			j--;
+		}
+		tiles[j + 1] = tile;
+		keys[j + 1] = key;
+	}
+	keys.clear();
+}
+//----</Tile ordering>----
 
-//Divides image into tiles and creates multiple threads to finish all tiles. 
-void start_render_from_camera(RenderInfo& info, ThreadPool& tpool)
+void make_render_tiles(FDBuffer<RenderTile>& tiles, uint32 width, uint32 height, uint32 no_threads, TileOrder order)
 {
-	//Creates a WorkQueue made of RenderTiles
-	int32 tile_width = info.camera_tex->bmb.width / tpool.threads.size;	//ASSESS: which tile_width value gives best results
-	if (tile_width > (int32)info.camera_tex->bmb.height)
+	int32 tile_width = width / no_threads;	//ASSESS: which tile_width value gives best results
+	if (tile_width > (int32)height)
+	{
+		tile_width = height / no_threads;
+	}
+	if (tile_width == 0)
 	{
-		tile_width = info.camera_tex->bmb.height / tpool.threads.size;
+		tile_width = 1;	//more threads than pixels
 	}
 	int32 tile_height = tile_width;	// for square tiles
 
-	ASSERT(tile_width > 0 && tile_height > 0 && tile_height <= (int32)info.camera_tex->bmb.height);
+	ASSERT(tile_width > 0 && tile_height > 0 && tile_height <= (int32)height);
 
-	int32 no_x_tiles = (info.camera_tex->bmb.width + tile_width - 1) / tile_width;
-	int32 no_y_tiles = (info.camera_tex->bmb.height + tile_height - 1) / tile_height;
+	int32 no_x_tiles = (width + tile_width - 1) / tile_width;
+	int32 no_y_tiles = (height + tile_height - 1) / tile_height;
 
 	int32 total_tiles = no_y_tiles * no_x_tiles;
 
-	RenderTile* tmp = info.twq.jobs.allocate(total_tiles);
-	info.twq.jobs_done = 0;
+	RenderTile* tmp = tiles.allocate(total_tiles);
 
-	//Creates the "tiles" and adds it into a "tile_work_queue"
+	//Creates the "tiles"
 	for (int y = 0; y < no_y_tiles; y++)
 	{
 		for (int x = 0; x < no_x_tiles; x++)
@@ -428,44 +1065,119 @@ void start_render_from_camera(RenderInfo& info, ThreadPool& tpool)
 			uint32 minx, miny, maxx, maxy;
 			minx = x * tile_width;
 			miny = y * tile_height;
-			maxx = minx + tile_width;
-			maxy = miny + tile_height;
-			if (maxx > info.camera_tex->bmb.width - 1)
+			maxx = minx + tile_width - 1;	//right_top is inclusive
+			maxy = miny + tile_height - 1;
+			if (maxx > width - 1)
 			{
-				maxx = (info.camera_tex->bmb.width - 1);
+				maxx = (width - 1);
 			}
-			if (maxy > info.camera_tex->bmb.height - 1)
+			if (maxy > height - 1)
 			{
-				maxy = (info.camera_tex->bmb.height - 1);
+				maxy = (height - 1);
 			}
 			tmp->tile.left_bottom = { (int32)minx, (int32)miny };
 			tmp->tile.right_top = { (int32)maxx, (int32)maxy };
 			tmp++;
 		}
 	}
-	
-	//----for ATP profiling----
-	ATP_GET_TESTTYPE(Tiles)->tests.size = info.twq.jobs.size;
-	ATP_GET_TESTTYPE(Tiles)->tests.finished_tests = 0;
-	ATP_GET_TESTTYPE(Tiles)->tests.front = (ATP::TestInfo*)pl_buffer_alloc(ATP_GET_TESTTYPE(Tiles)->tests.size * sizeof(ATP::TestInfo));
-
+	sort_tiles(tiles, order, tile_width, tile_height, no_x_tiles, no_y_tiles);
+}
 
-	activate_pool(tpool, start_tile_render_thread, &info);
-	
+void crop_render_tiles(FDBuffer<RenderTile>& tiles, Tile& region)
+{
+	int32 kept = 0;
+	for (int32 i = 0; i < tiles.size; i++)
+	{
+		Tile tile = tiles[i].tile;
+		tile.left_bottom = { max(tile.left_bottom.x, region.left_bottom.x), max(tile.left_bottom.y, region.left_bottom.y) };
+		tile.right_top = { min(tile.right_top.x, region.right_top.x), min(tile.right_top.y, region.right_top.y) };
+		if (tile.left_bottom.x > tile.right_top.x || tile.left_bottom.y > tile.right_top.y)
+		{
+			continue;
+		}
+		tiles[kept] = tiles[i];
+		tiles[kept].tile = tile;
+		kept++;
+	}
+	tiles.size = kept;	//NOTE: the memory stays allocated till tiles.clear()
 }
 
-b32 wait_for_render_from_camera_to_finish(RenderInfo& info,ThreadPool& tpool, uint32 ms_to_wait_for)
+void start_render_of_tiles(RenderInfo& info, JobSystem& job_system)
 {
-	if (pl_wait_for_all_threads(tpool.threads.size, &tpool.threads[0].handle, ms_to_wait_for))
+	ASSERT(is_counter_done(info.render_counter));	//previous render still going
+	ASSERT(info.film->width == info.camera_tex->bmb.width && info.film->height == info.camera_tex->bmb.height);
+	info.job_system = &job_system;
+	info.cancel = FALSE;
+	info.total_ray_casts = 0;
+	if (info.has_region)
+	{
+		crop_render_tiles(info.tiles, info.region);
+	}
+	setup_render_worker_data(info);
+
+	RenderSettings& rs = info.camera->render_settings;
+	uint32 max_samples = get_max_samples_per_pixel(rs);
+	uint32 samples_per_pass = rs.samples_per_pass ? rs.samples_per_pass : max_samples;
+	info.no_passes = (max_samples + samples_per_pass - 1) / samples_per_pass;
+	info.tile_row_kernel = get_tile_row_kernel(rs);
+
+	//----for ATP profiling----
+	//NOTE: renders get restarted with the same tiles (checkpoints, every move of the window's camera), so the buffer of
+	//the last start is reused then
+	ATP::TestType* tile_tests = ATP_GET_TESTTYPE(Tiles);
+	if (tile_tests->tests.front && tile_tests->tests.size == (uint32)info.tiles.size)
 	{
-		return TRUE;
+		pl_buffer_set(tile_tests->tests.front, 0, tile_tests->tests.size * sizeof(ATP::TestInfo));
 	}
 	else
 	{
-		for (int i = 0; i < info.twq.jobs.size; i++)
+		if (tile_tests->tests.front)
 		{
-			info.total_ray_casts += info.twq.jobs[i].ray_casts;
+			pl_buffer_free(tile_tests->tests.front);
 		}
-		return FALSE;
+		tile_tests->tests.size = info.tiles.size;
+		tile_tests->tests.front = (ATP::TestInfo*)pl_buffer_alloc(tile_tests->tests.size * sizeof(ATP::TestInfo));
 	}
-}
\ No newline at end of file
+	tile_tests->tests.finished_tests = 0;
+
+
+	submit_pass(info, 0);
+}
+
+//Divides image into tiles and submits them as jobs. Returns right away. 
+//Every tile is rendered once per pass, each pass adding samples_per_pass samples to the film.
+//With adaptive sampling, converged pixels are skipped in the following passes.
+void start_render_from_camera(RenderInfo& info, JobSystem& job_system)
+{
+	ASSERT(is_counter_done(info.render_counter));	//previous render still going
+	make_render_tiles(info.tiles, info.camera_tex->bmb.width, info.camera_tex->bmb.height, job_system.workers.size, info.camera->render_settings.tile_order);
+	clear_film(*info.film);
+	start_render_of_tiles(info, job_system);
+}
+
+//Returns TRUE if render is still going after waiting, and FALSE once it's finished
+b32 wait_for_render_from_camera_to_finish(RenderInfo& info, uint32 ms_to_wait_for)
+{
+	if (!is_counter_done(info.render_counter))
+	{
+		pl_sleep_thread(ms_to_wait_for);
+		if (!is_counter_done(info.render_counter))
+		{
+			return TRUE;
+		}
+	}
+	for (int i = 0; i < info.tiles.size; i++)
+	{
+		info.total_ray_casts += info.tiles[i].ray_casts;
+	}
+	free_render_worker_data(info);
+	return FALSE;
+}
+
+//Stops rendering and waits for the pixels being rendered to finish. Film keeps the samples done till now.
+void cancel_render_from_camera(RenderInfo& info)
+{
+	info.cancel = TRUE;
+	wait_for_counter(*info.job_system, info.render_counter);
+	free_render_worker_data(info);
+}
@@ -1,22 +1,43 @@
 #pragma once
 #include "PL/PL_math.h"
 #include "engine/tools/texture.h"
-#include "engine/tools/work_queue.h"
+#include "engine/tools/job_system.h"
 #include "scene.h"
 #include "camera.h"
-
-#define USE_KD_TREE
-
+#include "film.h"
 
 struct RenderTile
 {
 	Tile tile;
-	int64 ray_casts;
+	volatile int64 ray_casts;
+	b32 converged;	//every pixel of the tile converged (adaptive sampling), so the remaining passes are skipped
+
+	volatile int32 rows_done;	//rows of the current pass that are finished (rows can be split into different jobs)
+	volatile b32 pass_sampled;	//some pixel got samples in the current pass
 };
 
+struct RenderWorkerData;
+struct RayCastTools;
+struct RenderInfo;
+
+//Renders a row of a tile for one pass. Specialised at compile time for each combination of render settings that
+//changes the inner loops (see get_tile_row_kernel in renderer.cpp).
+typedef void (*TileRowKernel)(RenderInfo& info, RenderTile* rt, int32 pass, int32 row, RayCastTools& tools);
+
 struct RenderInfo
 {
-	WorkQueue<RenderTile> twq;
+	//Every pass submits a job per tile. The next pass is submitted once all tile jobs of the pass are done.
+	FDBuffer<RenderTile> tiles;
+	uint32 no_passes;
+	volatile int32 current_pass;
+	volatile int32 tiles_done;	//tiles finished in the current pass
+	volatile b32 cancel;
+
+	JobSystem* job_system;
+	JobCounter pass_counter;	//tile jobs of the current pass
+	JobCounter render_counter;	//reaches 0 once the last pass is done
+	RenderWorkerData* worker_data;	//ray casting scratch per worker
+	TileRowKernel tile_row_kernel;	//picked from the camera's render settings when the render starts
 
 	//buffers used for KD_tree traversal
 	uint32 hit_stack_capacity;
@@ -24,12 +45,38 @@ struct RenderInfo
 
 	Camera* camera;
 	Scene* scene;
-	Texture* camera_tex;
+	Texture* camera_tex;	//display image. Resolved from film as pixels get samples.
+	Film* film;				//float accumulation buffer. Must be the same size as camera_tex.
+
+	//Region of interest: only the parts of info.tiles inside region (inclusive) are rendered. Pixels outside it are left
+	//alone in film and camera_tex, so a region of a previous image can be rendered again on top of it.
+	b32 has_region;
+	Tile region;
 
 	int64 total_ray_casts = 0;
 };
 
-void start_render_from_camera(RenderInfo& info, ThreadPool& tpool);
-b32 wait_for_render_from_camera_to_finish(RenderInfo& info, ThreadPool& tpool, uint32 ms_to_wait_for);
+void start_render_from_camera(RenderInfo& info, JobSystem& job_system);
+//Splits a width x height image into the tiles start_render_from_camera renders with no_threads workers, sorted in order.
+//NOTE: the tiles only depend on the arguments, so processes rendering parts of the same image agree on them.
+void make_render_tiles(FDBuffer<RenderTile>& tiles, uint32 width, uint32 height, uint32 no_threads, TileOrder order);
+//Renders only info.tiles (set up by the caller, ex: a part of make_render_tiles) and returns right away.
+//Samples are added to what the film already has; pixels outside the tiles are left alone.
+void start_render_of_tiles(RenderInfo& info, JobSystem& job_system);
+//Cuts tiles down to their part inside region (inclusive), and removes the ones outside it. Tile order is kept.
+void crop_render_tiles(FDBuffer<RenderTile>& tiles, Tile& region);
+b32 wait_for_render_from_camera_to_finish(RenderInfo& info, uint32 ms_to_wait_for);
+void cancel_render_from_camera(RenderInfo& info);
+
+#define REPROJECTION_DEPTH_TOLERANCE 0.02f	//relative to the depth
+#define REPROJECTION_MAX_SAMPLES 32		//history of a pixel is scaled down to this many samples, so view dependent shading catches up
+
+//Temporal reprojection, for a camera that moved since previous was rendered (from previous_camera). A ray is cast through
+//the center of every pixel of info.film, and the pixel gets the accumulated samples of the previous pixel that saw the same
+//point, if that pixel's mean first hit depth says it really did. Pixels that see something previous didn't (disocclusions,
+//new parts of the view) start again with no samples, so the next render only has to converge those.
+//Both films need AOV_DEPTH. Not while rendering. Resolves info.film into info.camera_tex. Returns the no of pixels kept.
+uint32 reproject_film(RenderInfo& info, Film& previous, Camera& previous_camera, JobSystem& job_system);
 
-void prep_scene(Scene&, uint32& max_no_nodes_from_all_kd_trees);
\ No newline at end of file
+//accelerator has to match RenderSettings::accelerator of the cameras rendering the scene
+void prep_scene(Scene&, Accelerator accelerator, uint32& max_no_nodes_from_all_kd_trees, JobSystem& job_system);
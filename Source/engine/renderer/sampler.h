@@ -0,0 +1,143 @@
+#pragma once
+#include "PL/PL_math.h"
+
+//Gives the random numbers a pixel sample uses (AA jitter, light sampling, bounce directions, etc..).
+//Every call takes the next dimension(s) of the sample.
+//
+//SOBOL: low discrepancy points. Every 2D request is its own (0,2) sequence (first 2 Sobol dimensions) with its own
+//Owen scrambling and sample order shuffle, keyed by pixel and dimension ("padded" Sobol). Sample n of a pixel is
+//sample n of the sequence, so samples added in later passes keep filling in the gaps of the earlier ones.
+//(Burley 2020, "Practical Hash-based Owen Scrambling")
+//RANDOM: independent draws from an RNG_Stream that is restarted for every pixel sample.
+//
+//Both only depend on the pixel, sample index, frame and render seed (counter based), never on what was drawn before.
+//So a tile renders bit-identically no matter which thread, job or process renders it, or in which order.
+
+enum class SamplerType
+{
+	RANDOM,
+	SOBOL
+};
+
+inline const char* get_sampler_type_name(SamplerType type)
+{
+	switch (type)
+	{
+	case SamplerType::SOBOL: return "Sobol";
+	default: return "Random";
+	}
+}
+
+struct Sampler
+{
+	SamplerType type;
+	RNG_Stream rng_stream;	//RANDOM only
+	uint32 pixel_seed;
+	uint32 sample_index;
+	uint32 dimension;
+};
+
+FORCEDINLINE uint32 hash_u32(uint32 x)
+{
+	//lowbias32 by Chris Wellons
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+FORCEDINLINE uint32 hash_combine(uint32 seed, uint32 value)
+{
+	return hash_u32(seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2)));
+}
+
+FORCEDINLINE uint32 reverse_bits(uint32 x)
+{
+	x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+	x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+	x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+	x = ((x >> 8) & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+	return (x >> 16) | (x << 16);
+}
+
+//Owen scrambling of the bits of x (most significant bit first), in reversed bit order
+FORCEDINLINE uint32 laine_karras_permutation(uint32 x, uint32 seed)
+{
+	x += seed;
+	x ^= x * 0x6c50b47c;
+	x ^= x * 0xb82f1e52;
+	x ^= x * 0xc7afe638;
+	x ^= x * 0x8d22f6e6;
+	return x;
+}
+
+FORCEDINLINE uint32 owen_scramble(uint32 x, uint32 seed)
+{
+	return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+}
+
+//2nd dimension of the Sobol sequence (1st is the bit reversed index)
+FORCEDINLINE uint32 sobol_dimension_1(uint32 index)
+{
+	uint32 result = 0;
+	for (uint32 v = 1u << 31; index; index >>= 1, v ^= v >> 1)
+	{
+		if (index & 1)
+		{
+			result ^= v;
+		}
+	}
+	return result;
+}
+
+//NOTE: 24 bits so the result is always < 1.0f
+FORCEDINLINE f32 u32_to_unit_float(uint32 x)
+{
+	return (f32)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+//Seed of every sample of pixel [x,y] (in full image coordinates). frame gives animations/sequences different noise per frame
+//and seed different noise per render.
+FORCEDINLINE uint32 get_pixel_seed(uint32 x, uint32 y, uint32 frame, uint32 seed)
+{
+	return hash_combine(hash_combine(hash_combine(hash_u32(seed), frame), y), x);
+}
+
+FORCEDINLINE void start_pixel_sample(Sampler& sampler, uint32 pixel_seed, uint32 sample_index)
+{
+	sampler.pixel_seed = pixel_seed;
+	sampler.sample_index = sample_index;
+	sampler.dimension = 0;
+	if (sampler.type == SamplerType::RANDOM)
+	{
+		sampler.rng_stream.state = ((uint64)hash_combine(pixel_seed, sample_index) << 32) | (uint64)hash_combine(sample_index, ~pixel_seed);
+		sampler.rng_stream.stream = pixel_seed;
+	}
+}
+
+FORCEDINLINE f32 get_sample_1d(Sampler& sampler)
+{
+	if (sampler.type == SamplerType::RANDOM)
+	{
+		return rand_uni(&sampler.rng_stream);
+	}
+	uint32 seed = hash_combine(sampler.pixel_seed, sampler.dimension++);
+	uint32 index = owen_scramble(sampler.sample_index, seed);
+	return u32_to_unit_float(owen_scramble(reverse_bits(index), hash_u32(seed)));
+}
+
+FORCEDINLINE vec2f get_sample_2d(Sampler& sampler)
+{
+	if (sampler.type == SamplerType::RANDOM)
+	{
+		return { rand_uni(&sampler.rng_stream), rand_uni(&sampler.rng_stream) };
+	}
+	uint32 seed = hash_combine(sampler.pixel_seed, sampler.dimension);
+	sampler.dimension += 2;
+	uint32 index = owen_scramble(sampler.sample_index, seed);
+	uint32 x = owen_scramble(reverse_bits(index), hash_u32(seed ^ 0xa511e9b3));
+	uint32 y = owen_scramble(sobol_dimension_1(index), hash_u32(seed ^ 0x63d83595));
+	return { u32_to_unit_float(x), u32_to_unit_float(y) };
+}
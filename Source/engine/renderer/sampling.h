@@ -0,0 +1,47 @@
+#pragma once
+#include "PL/PL_math.h"
+
+//Makes tangent and bitangent so (tangent, bitangent, normal) is an orthonormal basis. normal must be normalized.
+//(Duff et al. 2017, "Building an Orthonormal Basis, Revisited")
+FORCEDINLINE void make_orthonormal_basis(vec3f normal, vec3f& tangent, vec3f& bitangent)
+{
+	f32 sign = normal.z >= 0.0f ? 1.0f : -1.0f;
+	f32 a = -1.0f / (sign + normal.z);
+	f32 b = normal.x * normal.y * a;
+	tangent = { 1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x };
+	bitangent = { b, sign + normal.y * normal.y * a, -normal.y };
+}
+
+//Direction around normal with pdf = cos(theta) / PI
+FORCEDINLINE vec3f sample_cosine_hemisphere(vec3f normal, f32 u1, f32 u2)
+{
+	f32 r = sqroot(u1);
+	f32 phi = 2.0f * PI32 * u2;
+	vec3f tangent, bitangent;
+	make_orthonormal_basis(normal, tangent, bitangent);
+	vec3f dir = tangent * (r * fcos(phi)) + bitangent * (r * fsin(phi)) + normal * sqroot(max(1.0f - u1, 0.0f));
+	return dir;
+}
+
+FORCEDINLINE f32 get_cosine_hemisphere_pdf(f32 cos_theta)
+{
+	return max(cos_theta, 0.0f) * INV_PI32;
+}
+
+//Direction around axis with pdf = 1 / (2 * PI)
+FORCEDINLINE vec3f sample_uniform_hemisphere(vec3f axis, f32 u1, f32 u2)
+{
+	f32 r = sqroot(max(1.0f - u1 * u1, 0.0f));
+	f32 phi = 2.0f * PI32 * u2;
+	vec3f tangent, bitangent;
+	make_orthonormal_basis(axis, tangent, bitangent);
+	return tangent * (r * fcos(phi)) + bitangent * (r * fsin(phi)) + axis * u1;
+}
+
+//Power heuristic (beta = 2) weight for a sample taken with pdf_a, when pdf_b could also have made it
+FORCEDINLINE f32 get_mis_weight(f32 pdf_a, f32 pdf_b)
+{
+	f32 a = pdf_a * pdf_a;
+	f32 b = pdf_b * pdf_b;
+	return a / (a + b);
+}
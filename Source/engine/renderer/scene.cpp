@@ -5,6 +5,8 @@ void free_scene_memory(Scene& scene)
 	scene.materials.clear_buffer();
 	scene.planes.clear_buffer();
 	scene.spheres.clear_buffer();
+	free_sphere_BVH(scene.sphere_bvh);
+	free_light_list(scene.lights);
 	for (int i = 0; i < scene.models.length; i++)
 	{
 		scene.models[i].data.faces_data.clear();
@@ -21,7 +23,7 @@ void free_scene_memory(Scene& scene)
 			{
 				if (!scene.models[i].kd_tree.tree[j].has_children)
 				{
-					scene.models[i].kd_tree.tree[j].primitives.clear();
+					scene.models[i].kd_tree.tree[j].packets.clear();
 				}
 			}
 			scene.models[i].kd_tree.tree.clear_buffer();
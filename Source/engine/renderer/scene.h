@@ -1,8 +1,10 @@
 #pragma once
 #include "sphere.h"
+#include "sphere_bvh.h"
 #include "plane.h"
 #include "model.h"
 #include "aabb.h"
+#include "lights.h"
 
 enum class PrimitiveTypes
 {
@@ -19,8 +21,11 @@ struct Scene
 	DBuffer<Model> models;
 
 	DBuffer<Sphere> spheres;
+	SphereBVH sphere_bvh;	//built from spheres in prep_scene
 
 	DBuffer<Plane> planes;
+
+	LightList lights;	//emissive spheres and triangles, gathered in prep_scene
 };
 
 void free_scene_memory(Scene& scene);
\ No newline at end of file
@@ -1,10 +1,76 @@
 #pragma once
 #include "PL/PL_math.h"
+#include "sampler.h"
+
+//Order tiles are handed out to the workers in
+enum class TileOrder
+{
+	ROW_MAJOR,	//left to right, bottom to top
+	MORTON,		//Z-order curve. Tiles rendered at the same time are close to each other, so they touch the same geometry.
+	HILBERT,	//like MORTON but without the jumps between quadrants
+	SPIRAL		//centre out, so the middle of the frame is done first (interactive sessions)
+};
+
+inline const char* get_tile_order_name(TileOrder order)
+{
+	switch (order)
+	{
+	case TileOrder::MORTON: return "Morton";
+	case TileOrder::HILBERT: return "Hilbert";
+	case TileOrder::SPIRAL: return "Spiral";
+	default: return "Row Major";
+	}
+}
+
+//How rays find the triangles of models. Picked at runtime; the render kernels are compiled for each one.
+enum class Accelerator
+{
+	KD_TREE,		//a tree is built per model in prep_scene
+	BRUTE_FORCE		//every face of a model whose bounding box is hit is tested. No build time, for debugging the trees.
+};
+
+inline const char* get_accelerator_name(Accelerator accelerator)
+{
+	switch (accelerator)
+	{
+	case Accelerator::BRUTE_FORCE: return "Brute Force";
+	default: return "KD Tree";
+	}
+}
 
 struct RenderSettings
 {
 	vec2i resolution;
 	b32 anti_aliasing;
 	uint32 samples_per_pixel;
+	uint32 samples_per_pass;	//samples added to every pixel each pass (progressive rendering). 0 renders all samples in a single pass.
 	int32 bounce_limit;
-};
\ No newline at end of file
+	//Russian roulette: after russian_roulette_min_depth bounces, paths are ended at random with a chance based on how much
+	//they can still contribute (their throughput). Dark paths end early, so bounce_limit can be set high for bright scenes.
+	b32 russian_roulette;
+	int32 russian_roulette_min_depth;
+	//Next event estimation: every bounce samples a point on an emissive sphere/triangle and casts a shadow ray to it.
+	//Combined with bounces that hit emitters using multiple importance sampling.
+	b32 next_event_estimation;
+	SamplerType sampler;	//where the random numbers of every pixel sample come from
+	//Samples are seeded from (pixel, sample index, frame, seed) only, so renders with the same settings are bit-identical.
+	uint32 seed;	//change for a different noise pattern
+	uint32 frame;	//frame of a sequence. Every frame gets different noise.
+	uint32 sample_offset;	//index of the first sample of every pixel. Lets separate renders do different samples of the same pixels.
+	TileOrder tile_order;
+	Accelerator accelerator;	//must be the one the scene was prepped with
+
+	//Adaptive sampling: pixels stop getting samples once the standard error of their mean luminance falls below
+	//adaptive_threshold (relative to the mean), and the noisy ones keep going up to max_samples_per_pixel.
+	//0 disables it and every pixel gets samples_per_pixel samples.
+	f32 adaptive_threshold;
+	uint32 min_samples_per_pixel;	//samples a pixel gets before it can be considered converged
+	uint32 max_samples_per_pixel;	//used in place of samples_per_pixel when adaptive sampling is on
+
+};
+
+//total samples a pixel can get
+FORCEDINLINE uint32 get_max_samples_per_pixel(RenderSettings& rs)
+{
+	return rs.adaptive_threshold > 0.0f ? rs.max_samples_per_pixel : rs.samples_per_pixel;
+}
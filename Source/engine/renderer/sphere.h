@@ -37,3 +37,84 @@ static inline f32 get_sphere_ray_intersection(Ray& ray, Sphere& sphere)
 	return ta;
 
 }
+
+//4 spheres stored as SoA so a ray can be tested against all of them at once with SSE.
+//NOTE: leaves that don't fill a packet repeat their last sphere in the empty lanes (a duplicate hit is harmless).
+struct SpherePacket
+{
+	f32 center_x[4];
+	f32 center_y[4];
+	f32 center_z[4];
+	f32 radius_sqr[4];
+	int32 sphere_index[4];	//index of the sphere in Scene::spheres
+};
+
+//Ray with every component splatted across a SSE register. Made once per ray and reused for every packet.
+struct Wide_Ray
+{
+	__m128 origin_x, origin_y, origin_z;
+	__m128 direction_x, direction_y, direction_z;
+};
+
+FORCEDINLINE void SetWideRay(Wide_Ray& wide_ray, Ray& ray)
+{
+	wide_ray.origin_x = _mm_set1_ps(ray.origin.x);
+	wide_ray.origin_y = _mm_set1_ps(ray.origin.y);
+	wide_ray.origin_z = _mm_set1_ps(ray.origin.z);
+	wide_ray.direction_x = _mm_set1_ps(ray.direction.x);
+	wide_ray.direction_y = _mm_set1_ps(ray.direction.y);
+	wide_ray.direction_z = _mm_set1_ps(ray.direction.z);
+}
+
+//Batched version of get_sphere_ray_intersection. Tests ray against the 4 spheres in the packet.
+//Returns the lane of the nearest sphere hit that is closer than "closest" (and updates closest), or -1 if nothing was hit.
+//NOTE: assumes ray direction is normalized
+static FORCEDINLINE int32 get_sphere_packet_ray_intersection(Wide_Ray& ray, SpherePacket& packet, f32& closest)
+{
+	__m128 p_to_c_x = _mm_sub_ps(ray.origin_x, _mm_loadu_ps(packet.center_x));
+	__m128 p_to_c_y = _mm_sub_ps(ray.origin_y, _mm_loadu_ps(packet.center_y));
+	__m128 p_to_c_z = _mm_sub_ps(ray.origin_z, _mm_loadu_ps(packet.center_z));
+
+	//half of b in the quadratic (a == 1 as direction is normalized)
+	__m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ray.direction_x, p_to_c_x), _mm_mul_ps(ray.direction_y, p_to_c_y)), _mm_mul_ps(ray.direction_z, p_to_c_z));
+	__m128 c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p_to_c_x, p_to_c_x), _mm_mul_ps(p_to_c_y, p_to_c_y)), _mm_mul_ps(p_to_c_z, p_to_c_z));
+	c = _mm_sub_ps(c, _mm_loadu_ps(packet.radius_sqr));
+
+	__m128 dmt = _mm_sub_ps(_mm_mul_ps(b, b), c);
+	__m128 hit_mask = _mm_cmpge_ps(dmt, _mm_setzero_ps());
+	if (_mm_movemask_ps(hit_mask) == 0)
+	{
+		return -1;
+	}
+
+	__m128 sqr_dmt = _mm_sqrt_ps(_mm_max_ps(dmt, _mm_setzero_ps()));
+	__m128 neg_b = _mm_sub_ps(_mm_setzero_ps(), b);
+	__m128 tb = _mm_sub_ps(neg_b, sqr_dmt);	//nearest intersection
+	__m128 ta = _mm_add_ps(neg_b, sqr_dmt);	//farthest intersection (used when ray origin is inside sphere)
+
+	__m128 tol = _mm_set1_ps(tolerance);
+	__m128 use_tb = _mm_cmpgt_ps(tb, tol);
+	__m128 t = _mm_or_ps(_mm_and_ps(use_tb, tb), _mm_andnot_ps(use_tb, ta));
+
+	hit_mask = _mm_and_ps(hit_mask, _mm_cmpgt_ps(t, tol));
+	hit_mask = _mm_and_ps(hit_mask, _mm_cmplt_ps(t, _mm_set1_ps(closest)));
+	int32 hits = _mm_movemask_ps(hit_mask);
+	if (hits == 0)
+	{
+		return -1;
+	}
+
+	//horizontal min of the lanes that hit
+	t = _mm_or_ps(_mm_and_ps(hit_mask, t), _mm_andnot_ps(hit_mask, _mm_set1_ps(MAX_FLOAT)));
+	__m128 min_t = _mm_min_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 3, 0, 1)));
+	min_t = _mm_min_ps(min_t, _mm_shuffle_ps(min_t, min_t, _MM_SHUFFLE(1, 0, 3, 2)));
+	hits &= _mm_movemask_ps(_mm_cmpeq_ps(t, min_t));
+
+	int32 lane = 0;
+	while (!(hits & (1 << lane)))
+	{
+		lane++;
+	}
+	closest = _mm_cvtss_f32(min_t);
+	return lane;
+}
\ No newline at end of file
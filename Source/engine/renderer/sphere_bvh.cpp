@@ -0,0 +1,313 @@
+#include "sphere_bvh.h"
+
+#define SPHERE_BVH_NO_BINS 12
+
+//Per sphere data only used while building
+struct SphereBuildRef
+{
+	AABB aabb;
+	vec3f centroid;
+	int32 sphere_index;
+};
+
+struct SphereBuildTask
+{
+	uint32 node_index;
+	uint32 start;	//first ref in refs buffer
+	uint32 count;	//no of refs
+	uint32 depth;
+};
+
+struct SphereBin
+{
+	AABB aabb;
+	uint32 count;
+};
+
+static FORCEDINLINE AABB get_empty_AABB()
+{
+	AABB ret;
+	ret.min = { MAX_FLOAT, MAX_FLOAT, MAX_FLOAT };
+	ret.max = { -MAX_FLOAT, -MAX_FLOAT, -MAX_FLOAT };
+	return ret;
+}
+
+static FORCEDINLINE void grow_AABB(AABB& box, vec3f point)
+{
+	box.min = { min(box.min.x, point.x), min(box.min.y, point.y), min(box.min.z, point.z) };
+	box.max = { max(box.max.x, point.x), max(box.max.y, point.y), max(box.max.z, point.z) };
+}
+
+static void make_leaf(SphereBVH& bvh, SphereBVH_Node& node, SphereBuildRef* refs, DBuffer<Sphere>& spheres)
+{
+	uint32 no_packets = (node.no_packets + 3) / 4;	//no_packets holds the sphere count until here
+	uint32 count = node.no_packets;
+	node.first_packet = bvh.packets.length;
+	node.no_packets = no_packets;
+
+	for (uint32 p = 0; p < no_packets; p++)
+	{
+		SpherePacket packet;
+		for (uint32 lane = 0; lane < 4; lane++)
+		{
+			uint32 ref = min(p * 4 + lane, count - 1);	//repeating last sphere for empty lanes
+			Sphere& spr = spheres[refs[ref].sphere_index];
+			packet.center_x[lane] = spr.center.x;
+			packet.center_y[lane] = spr.center.y;
+			packet.center_z[lane] = spr.center.z;
+			packet.radius_sqr[lane] = spr.radius * spr.radius;
+			packet.sphere_index[lane] = refs[ref].sphere_index;
+		}
+		bvh.packets.add_nocpy(packet);
+	}
+}
+
+//Binned SAH along the longest centroid axis. Returns the no of refs put in the left child.
+static uint32 partition_refs(SphereBuildRef* refs, uint32 count, AABB& centroid_bounds)
+{
+	vec3f extent = centroid_bounds.max - centroid_bounds.min;
+	int32 axis = 0;
+	if (extent.y > extent.x) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+
+	uint32 half = count / 2;
+	if (extent[axis] <= tolerance)	//all centroids on top of each other, splitting in the middle
+	{
+		return half;
+	}
+
+	SphereBin bins[SPHERE_BVH_NO_BINS];
+	for (int32 i = 0; i < SPHERE_BVH_NO_BINS; i++)
+	{
+		bins[i].aabb = get_empty_AABB();
+		bins[i].count = 0;
+	}
+
+	f32 bin_factor = (f32)SPHERE_BVH_NO_BINS * (1.0f - tolerance) / extent[axis];
+	for (uint32 i = 0; i < count; i++)
+	{
+		int32 bin = (int32)((refs[i].centroid[axis] - centroid_bounds.min[axis]) * bin_factor);
+		bins[bin].count++;
+		bins[bin].aabb = get_surrounding_AABB(bins[bin].aabb, refs[i].aabb);
+	}
+
+	//sweeping from the right to get cost of right side of every split
+	f32 right_cost[SPHERE_BVH_NO_BINS];
+	AABB right_box = get_empty_AABB();
+	uint32 right_count = 0;
+	for (int32 i = SPHERE_BVH_NO_BINS - 1; i > 0; i--)
+	{
+		right_box = get_surrounding_AABB(right_box, bins[i].aabb);
+		right_count += bins[i].count;
+		right_cost[i] = right_count ? get_surface_area(right_box) * right_count : 0;
+	}
+
+	f32 best_cost = MAX_FLOAT;
+	int32 best_split = -1;
+	AABB left_box = get_empty_AABB();
+	uint32 left_count = 0;
+	for (int32 i = 1; i < SPHERE_BVH_NO_BINS; i++)
+	{
+		left_box = get_surrounding_AABB(left_box, bins[i - 1].aabb);
+		left_count += bins[i - 1].count;
+		if (left_count == 0 || left_count == count)
+		{
+			continue;
+		}
+		f32 cost = get_surface_area(left_box) * left_count + right_cost[i];
+		if (cost < best_cost)
+		{
+			best_cost = cost;
+			best_split = i;
+		}
+	}
+	if (best_split == -1)
+	{
+		return half;
+	}
+
+	//partitioning refs in place
+	uint32 left = 0, right = count;
+	while (left < right)
+	{
+		int32 bin = (int32)((refs[left].centroid[axis] - centroid_bounds.min[axis]) * bin_factor);
+		if (bin < best_split)
+		{
+			left++;
+		}
+		else
+		{
+			right--;
+			SphereBuildRef tmp = refs[left];
+			refs[left] = refs[right];
+			refs[right] = tmp;
+		}
+	}
+	return left;
+}
+
+void build_sphere_BVH(DBuffer<Sphere>& spheres, SphereBVH& bvh)
+{
+	free_sphere_BVH(bvh);
+	if (spheres.length == 0)
+	{
+		return;
+	}
+
+	FDBuffer<SphereBuildRef, uint32> refs;
+	refs.allocate(spheres.length);
+	for (int32 i = 0; i < spheres.length; i++)
+	{
+		vec3f radius = { spheres[i].radius, spheres[i].radius, spheres[i].radius };
+		refs[i].aabb.min = spheres[i].center - radius;
+		refs[i].aabb.max = spheres[i].center + radius;
+		refs[i].centroid = spheres[i].center;
+		refs[i].sphere_index = i;
+	}
+
+	uint32 max_leaf = max(bvh.max_no_spheres_per_leaf, 1u);
+	bvh.packets.capacity = (spheres.length + 3) / 4;
+	bvh.packets.overflow_addon = bvh.packets.capacity / 4 + 1;
+	bvh.tree.capacity = 2 * ((spheres.length + max_leaf - 1) / max_leaf);
+	bvh.tree.overflow_addon = bvh.tree.capacity / 4 + 2;
+
+	SphereBVH_Node root = {};
+	bvh.tree.add_nocpy(root);
+
+	DBuffer<SphereBuildTask, 64, 64> task_stack;
+	task_stack.add({ 0, 0, refs.size, 0 });
+
+	while (task_stack.length > 0)
+	{
+		SphereBuildTask task = task_stack[task_stack.length - 1];
+		task_stack.length--;
+
+		SphereBuildRef* task_refs = refs.front + task.start;
+		AABB bounds = get_empty_AABB();
+		AABB centroid_bounds = get_empty_AABB();
+		for (uint32 i = 0; i < task.count; i++)
+		{
+			bounds = get_surrounding_AABB(bounds, task_refs[i].aabb);
+			grow_AABB(centroid_bounds, task_refs[i].centroid);
+		}
+
+		//NOTE: tree buffer can be reallocated when adding children, so node is looked up by index every time.
+		bvh.tree[task.node_index].aabb = bounds;
+
+		if (task.count <= max_leaf)
+		{
+			bvh.tree[task.node_index].no_packets = task.count;
+			make_leaf(bvh, bvh.tree[task.node_index], task_refs, spheres);
+			continue;
+		}
+
+		//NOTE: past half the max depth, splitting by count to make sure traversal stack can't overflow.
+		uint32 left_count;
+		if (task.depth < SPHERE_BVH_MAX_DEPTH / 2)
+		{
+			left_count = partition_refs(task_refs, task.count, centroid_bounds);
+		}
+		else
+		{
+			left_count = task.count / 2;
+		}
+
+		uint32 children_start_position = bvh.tree.length;
+		SphereBVH_Node left = {}, right = {};
+		bvh.tree.add_nocpy(left);
+		bvh.tree.add_nocpy(right);
+		bvh.tree[task.node_index].no_packets = 0;
+		bvh.tree[task.node_index].children_start_position = children_start_position;
+
+		task_stack.add({ children_start_position, task.start, left_count, task.depth + 1 });
+		task_stack.add({ children_start_position + 1, task.start + left_count, task.count - left_count, task.depth + 1 });
+	}
+
+	task_stack.clear_buffer();
+	refs.clear();
+}
+
+void free_sphere_BVH(SphereBVH& bvh)
+{
+	bvh.tree.clear_buffer();
+	bvh.packets.clear_buffer();
+}
+
+struct SphereBVH_StackEntry
+{
+	SphereBVH_Node* node;
+	f32 entry_distance;
+};
+
+f32 get_ray_sphere_bvh_intersection(Optimized_Ray& op_ray, SphereBVH& bvh, f32 closest, int32& sphere_index)
+{
+	sphere_index = -1;
+	f32 entry;
+	if (bvh.tree.length == 0 || !get_ray_AABB_entry_distance(op_ray, bvh.tree.front->aabb, closest, entry))
+	{
+		return closest;
+	}
+
+	Wide_Ray wide_ray;
+	SetWideRay(wide_ray, op_ray.ray);
+
+	SphereBVH_StackEntry stack[SPHERE_BVH_MAX_DEPTH];
+	int32 stack_length = 0;
+	stack[stack_length++] = { bvh.tree.front, entry };
+
+	while (stack_length > 0)
+	{
+		stack_length--;
+		if (stack[stack_length].entry_distance > closest)	//a nearer sphere was found after this node was pushed
+		{
+			continue;
+		}
+		SphereBVH_Node* node = stack[stack_length].node;
+
+		if (node->no_packets > 0)
+		{
+			SpherePacket* packet = bvh.packets.front + node->first_packet;
+			for (uint32 i = 0; i < node->no_packets; i++)
+			{
+				int32 lane = get_sphere_packet_ray_intersection(wide_ray, *packet, closest);
+				if (lane != -1)
+				{
+					sphere_index = packet->sphere_index[lane];
+				}
+				packet++;
+			}
+			continue;
+		}
+
+		SphereBVH_Node* left = bvh.tree.front + node->children_start_position;
+		SphereBVH_Node* right = left + 1;
+		f32 left_entry, right_entry;
+		b32 hit_left = get_ray_AABB_entry_distance(op_ray, left->aabb, closest, left_entry);
+		b32 hit_right = get_ray_AABB_entry_distance(op_ray, right->aabb, closest, right_entry);
+
+		//pushing farther child first so nearer child gets popped first
+		if (hit_left && hit_right)
+		{
+			ASSERT(stack_length + 2 <= SPHERE_BVH_MAX_DEPTH);
+			if (left_entry < right_entry)
+			{
+				stack[stack_length++] = { right, right_entry };
+				stack[stack_length++] = { left, left_entry };
+			}
+			else
+			{
+				stack[stack_length++] = { left, left_entry };
+				stack[stack_length++] = { right, right_entry };
+			}
+		}
+		else if (hit_left)
+		{
+			stack[stack_length++] = { left, left_entry };
+		}
+		else if (hit_right)
+		{
+			stack[stack_length++] = { right, right_entry };
+		}
+	}
+	return closest;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "sphere.h"
+#include "aabb.h"
+
+//Binary BVH over all the analytic spheres in a scene. Leaves hold SpherePackets so they can be tested 4 spheres at a time.
+
+#define SPHERE_BVH_MAX_DEPTH 64
+
+struct SphereBVH_Node
+{
+	AABB aabb;
+	uint32 no_packets;	//0 if node is not a leaf
+	union
+	{
+		uint32 children_start_position;	//position in tree buffer where the 2 children are (non-leaf)
+		uint32 first_packet;			//position in packets buffer where the leaf's packets start (leaf)
+	};
+};
+
+struct SphereBVH
+{
+	//max no of spheres in a leaf (rounded up to a multiple of 4 to fill the packets)
+	uint32 max_no_spheres_per_leaf = 4;
+	DBuffer<SphereBVH_Node, 1, 16, int32> tree;
+	DBuffer<SpherePacket, 1, 16, int32> packets;
+};
+
+void build_sphere_BVH(DBuffer<Sphere>& spheres, SphereBVH& bvh);
+
+void free_sphere_BVH(SphereBVH& bvh);
+
+//Returns distance to nearest sphere closer than "closest" and sets sphere_index to its index in Scene::spheres.
+//sphere_index is -1 (and closest is returned) if no closer sphere is hit.
+f32 get_ray_sphere_bvh_intersection(Optimized_Ray& op_ray, SphereBVH& bvh, f32 closest, int32& sphere_index);
@@ -0,0 +1,100 @@
+#include "tone_mapping.h"
+
+uint8 srgb_lut[SRGB_LUT_SIZE];
+uint8 linear_lut[SRGB_LUT_SIZE];
+
+void setup_tone_mapping()
+{
+	if (srgb_lut[SRGB_LUT_SIZE - 1] == 255)	//already filled by another film
+	{
+		return;
+	}
+	for (uint32 i = 0; i < SRGB_LUT_SIZE; i++)
+	{
+		f32 l = (f32)i / (f32)(SRGB_LUT_SIZE - 1);
+		srgb_lut[i] = (uint8)(linear_to_srgb(l) * 255.0f + 0.5f);
+		linear_lut[i] = (uint8)(l * 255.0f + 0.5f);
+	}
+}
+
+static FORCEDINLINE __m128 tone_map_4(__m128 c, ToneMapOperator op)
+{
+	__m128 one = _mm_set1_ps(1.0f);
+	switch (op)
+	{
+	case ToneMapOperator::REINHARD:
+	{
+		return _mm_div_ps(c, _mm_add_ps(one, c));
+	}
+	case ToneMapOperator::ACES:
+	{
+		__m128 numerator = _mm_mul_ps(c, _mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+		__m128 denominator = _mm_add_ps(_mm_mul_ps(c, _mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+		return _mm_div_ps(numerator, denominator);
+	}
+	default:
+		return c;
+	}
+}
+
+void convert_radiance_to_bgra(DisplaySettings& ds, vec3f* radiance_sums, uint32* sample_counts, uint32 count, uint32* bgra)
+{
+	uint8* lut = ds.srgb ? srgb_lut : linear_lut;
+	__m128 exposure = _mm_set1_ps(ds.exposure);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 lut_scale = _mm_set1_ps((f32)(SRGB_LUT_SIZE - 1));
+
+	uint32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		vec3f* c = radiance_sums + i;
+		//AoS to SoA
+		__m128 r = _mm_setr_ps(c[0].x, c[1].x, c[2].x, c[3].x);
+		__m128 g = _mm_setr_ps(c[0].y, c[1].y, c[2].y, c[3].y);
+		__m128 b = _mm_setr_ps(c[0].z, c[1].z, c[2].z, c[3].z);
+
+		__m128 scale = exposure;
+		__m128i has_samples = _mm_set1_epi32(-1);
+		if (sample_counts)
+		{
+			__m128i counts = _mm_loadu_si128((__m128i*)(sample_counts + i));
+			has_samples = _mm_xor_si128(_mm_cmpeq_epi32(counts, _mm_setzero_si128()), _mm_set1_epi32(-1));
+			//max(count, 1) so pixels without samples don't divide by 0 (they're not written anyway)
+			__m128 counts_f = _mm_max_ps(_mm_cvtepi32_ps(counts), one);
+			scale = _mm_div_ps(exposure, counts_f);
+		}
+		r = _mm_min_ps(tone_map_4(_mm_max_ps(_mm_mul_ps(r, scale), zero), ds.tone_map), one);
+		g = _mm_min_ps(tone_map_4(_mm_max_ps(_mm_mul_ps(g, scale), zero), ds.tone_map), one);
+		b = _mm_min_ps(tone_map_4(_mm_max_ps(_mm_mul_ps(b, scale), zero), ds.tone_map), one);
+
+		//NOTE: cvtps rounds to nearest
+		int32 ri[4], gi[4], bi[4], mask[4];
+		_mm_storeu_si128((__m128i*)ri, _mm_cvtps_epi32(_mm_mul_ps(r, lut_scale)));
+		_mm_storeu_si128((__m128i*)gi, _mm_cvtps_epi32(_mm_mul_ps(g, lut_scale)));
+		_mm_storeu_si128((__m128i*)bi, _mm_cvtps_epi32(_mm_mul_ps(b, lut_scale)));
+		_mm_storeu_si128((__m128i*)mask, has_samples);
+		for (uint32 j = 0; j < 4; j++)
+		{
+			if (mask[j])
+			{
+				bgra[i + j] = ((uint32)lut[ri[j]] << 16) | ((uint32)lut[gi[j]] << 8) | (uint32)lut[bi[j]];
+			}
+		}
+	}
+	for (; i < count; i++)
+	{
+		if (sample_counts)
+		{
+			if (sample_counts[i] == 0)
+			{
+				continue;
+			}
+			bgra[i] = radiance_to_bgra(ds, radiance_sums[i] / (f32)sample_counts[i]);
+		}
+		else
+		{
+			bgra[i] = radiance_to_bgra(ds, radiance_sums[i]);
+		}
+	}
+}
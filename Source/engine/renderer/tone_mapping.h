@@ -0,0 +1,67 @@
+#pragma once
+#include "PL/PL_math.h"
+
+//Turns linear HDR radiance into 8-bit sRGB BGRA pixels (the Texture/window format).
+//Exposure and tone mapping are done with SSE 4 pixels at a time, and the sRGB curve is a lookup table
+//so it's cheap enough to always be on (instead of fpow per channel).
+
+enum class ToneMapOperator
+{
+	CLAMP,		//no tone mapping, everything above 1 is clipped
+	REINHARD,	//c / (1 + c)
+	ACES		//filmic curve (Narkowicz 2015 fit of the ACES RRT/ODT)
+};
+
+inline const char* get_tone_map_operator_name(ToneMapOperator op)
+{
+	switch (op)
+	{
+	case ToneMapOperator::REINHARD: return "Reinhard";
+	case ToneMapOperator::ACES: return "ACES";
+	default: return "Clamp";
+	}
+}
+
+struct DisplaySettings
+{
+	f32 exposure = 1.0f;	//radiance is multiplied by this before tone mapping
+	ToneMapOperator tone_map = ToneMapOperator::ACES;
+	b32 srgb = TRUE;		//FALSE writes the tone mapped values as they are (linear)
+};
+
+#define SRGB_LUT_SIZE 4096
+
+//Linear [0,1] (in SRGB_LUT_SIZE steps) to 8-bit sRGB. Max error is below 1 step of the 8-bit output.
+extern uint8 srgb_lut[SRGB_LUT_SIZE];
+extern uint8 linear_lut[SRGB_LUT_SIZE];
+
+//Fills the lookup tables. Called by setup_film, does nothing if they're already filled.
+void setup_tone_mapping();
+
+FORCEDINLINE f32 tone_map(f32 c, ToneMapOperator op)
+{
+	switch (op)
+	{
+	case ToneMapOperator::REINHARD: return c / (1.0f + c);
+	case ToneMapOperator::ACES: return (c * (2.51f * c + 0.03f)) / (c * (2.43f * c + 0.59f) + 0.14f);
+	default: return c;
+	}
+}
+
+//Scalar version of convert_radiance_to_bgra for a single pixel
+FORCEDINLINE uint32 radiance_to_bgra(DisplaySettings& ds, vec3f radiance)
+{
+	uint8* lut = ds.srgb ? srgb_lut : linear_lut;
+	uint32 bgra = 0;
+	for (int32 i = 0; i < 3; i++)
+	{
+		f32 c = tone_map(max(radiance[i] * ds.exposure, 0.0f), ds.tone_map);
+		uint32 index = (uint32)(min(c, 1.0f) * (f32)(SRGB_LUT_SIZE - 1) + 0.5f);
+		bgra |= (uint32)lut[index] << (16 - 8 * i);	//r is the 3rd byte, b the 1st
+	}
+	return bgra;
+}
+
+//Converts count pixels. Pixel i is radiance_sums[i] / sample_counts[i] (pixels with 0 samples are left as they are).
+//sample_counts can be 0 if radiance isn't a sum (every pixel counts as 1 sample).
+void convert_radiance_to_bgra(DisplaySettings& ds, vec3f* radiance_sums, uint32* sample_counts, uint32 count, uint32* bgra);
@@ -0,0 +1,69 @@
+#include "scene_setup.h"
+#include "engine/tools/OBJ_loader.h"
+
+b32 setup_app_scene(Scene& scene, const char* model_path, JobSystem& job_system)
+{
+	void* file;
+	if (!pl_get_file_handle((char*)model_path, &file))
+	{
+		return FALSE;
+	}
+	pl_close_file_handle(file);
+
+	Model model = {};
+	load_model_data(model.data, model_path, job_system);
+	model.surrounding_aabb = get_AABB(model.data);
+	//resize_scale(model, 3);
+	translate_to(model, { 0.f,-15.f,-38.f });
+
+	model.kd_tree.division_method = KD_Division_Method::SAH;
+	model.kd_tree.max_no_faces_per_node = 300;//(uint32)((200.f/(1570.f * 8)) * (f32)model.data.faces_vertices.size);	//use "bucket size" or density value factor to calculate this.
+	model.cull_mode = TriangleCullMode::CULLED;	//dragon is a closed mesh. Use TWO_SIDED/WATERTIGHT for open meshes.
+
+	Material skybox = { {0.3f,0.4f,0.5f}, {0.2f,0.3f,0.4f},0.3f };
+	Material sphere_1 = { {0.f,0.0f,0.0f }, {0.2f,0.8f,0.2f },0.3f };
+	Material sphere_2 = { {0.0f,0.0f,0.0f }, {0.4f,0.8f,0.9f },0.9f };
+	Material plane_2 = { { 0.0f, 0.4f,0.6f } , { 0.2f, 0.3f,0.2f },0.f };
+	Material ground_plane = { {0.f, 0.f,0.0f } , {0.5f, 0.5f,0.5f },0.f };
+	Material model_mat = { {0.4f,0.2f,0.2f}, {0.92f,0.5f,0.0f},0.3f };
+	Material mat_model_aabb = { {0.8f,0.2f,0.2f}, {0.92f,0.0f,0.0f},0.3f };
+
+	scene.materials.add(skybox);	//The first material is the skybox
+	scene.materials.add(sphere_1);
+	scene.materials.add(sphere_2);
+	scene.materials.add(plane_2);
+	scene.materials.add(ground_plane);
+	scene.materials.add(model_mat);
+	scene.materials.add(mat_model_aabb);
+
+	//NOTE: this stuff is ad-hoc right now and should be properly implemented. 
+	//Should Objects contain a pointer to a material or should they have an "index" instead...
+	//Depends on how materials are loaded and what order they are stored in. Objects need to know which material
+	// they point to in the Material buffer in scene.
+	model.data.material = &scene.materials[5];
+
+	scene.models.add_nocpy(model);
+	return TRUE;
+}
+
+void set_default_render_settings(RenderSettings& rs, uint32 width, uint32 height)
+{
+	rs.anti_aliasing = FALSE;
+	rs.resolution.x = width;
+	rs.resolution.y = height;
+	rs.samples_per_pixel = 5;
+	rs.samples_per_pass = 1;
+	rs.adaptive_threshold = 0.05f;	//set to 0 for uniform sampling
+	rs.min_samples_per_pixel = 4;
+	rs.max_samples_per_pixel = 16;
+	rs.bounce_limit = 12;
+	rs.russian_roulette = TRUE;
+	rs.russian_roulette_min_depth = 3;
+	rs.next_event_estimation = TRUE;
+	rs.sampler = SamplerType::SOBOL;
+	rs.tile_order = TileOrder::HILBERT;
+	rs.accelerator = Accelerator::KD_TREE;
+	rs.seed = 0;
+	rs.frame = 0;
+	rs.sample_offset = 0;
+}
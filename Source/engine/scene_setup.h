@@ -0,0 +1,16 @@
+#pragma once
+#include "renderer/renderer.h"
+
+//The scene the app renders until there are proper scene files: a model from an OBJ file with hard-coded materials,
+//moved in front of the default camera. Shared by the window and the batch (headless) renders.
+
+#define DEFAULT_SCENE_PATH "Assets\\dragon.obj"
+#define DEFAULT_CAMERA_POSITION vec3f{ 0.1f, 2.f, 0.f }
+#define DEFAULT_CAMERA_DIRECTION vec3f{ -.1f, -0.5f, -1.f }
+#define DEFAULT_CAMERA_FOV 1.0f
+
+//Returns FALSE if the model file can't be opened. The scene is left empty then.
+b32 setup_app_scene(Scene& scene, const char* model_path, JobSystem& job_system);
+
+//Render settings of the window render. The batch render overrides some of them from the command line.
+void set_default_render_settings(RenderSettings& rs, uint32 width, uint32 height);
@@ -1,6 +1,6 @@
 #include "OBJ_loader.h"
 #include "utilities/parser.h"
-#include "work_queue.h"
+#include "job_system.h"
 
 //Possible Optimizations:
 //Perfrom prep_faces in SIMD ( easy to remove the offset on multiple data)
@@ -29,20 +29,8 @@ struct ParseDataChunk
 
 
 
-static bool parse_chunks(WorkQueue<ParseDataChunk>& chunks_)
+static void parse_chunk(ParseDataChunk* chunk)
 {
-	ParseDataChunk* chunk;
-	int64 chunk_no = interlocked_increment_i32(&chunks_.jobs_done);
-	if (chunk_no > chunks_.jobs.size)
-	{
-		interlocked_decrement_i32(&chunks_.jobs_done);
-		return false;
-	}
-	else
-	{
-		chunk = &chunks_.jobs[(int32)chunk_no - 1];
-	}
-
 	char* cursor = chunk->start;
 	vec3f parsed_vec3f;
 	while (cursor < chunk->end)
@@ -171,23 +159,25 @@ static bool parse_chunks(WorkQueue<ParseDataChunk>& chunks_)
 		cursor = skip_to_new_line(cursor);
 		cursor++;
 	}
-	
-	return true;
 }
 
-
-static void start_parse_chunk_thread(void* chunks_)
+struct ParseChunkJob
 {
-	WorkQueue<ParseDataChunk>* chunks = (WorkQueue<ParseDataChunk>*)chunks_;
+	ParseDataChunk* chunk;
+	volatile int32* chunks_parsed;
+	int32 no_of_chunks;
+};
 
-	while (parse_chunks(*chunks))
-	{
-		pl_debug_print("\rChunks parsed: %i/%i", chunks->jobs_done, chunks->jobs.size);
-	}
+static void parse_chunk_job(void* payload)
+{
+	ParseChunkJob* job = (ParseChunkJob*)payload;
+	parse_chunk(job->chunk);
+	int32 chunks_parsed = (int32)interlocked_increment_i32(job->chunks_parsed);
+	pl_debug_print("\rChunks parsed: %i/%i", chunks_parsed, job->no_of_chunks);
 }
 
 //Joins the parsed chunks into a big chunk. NOTE: Joining needs to be in order of parsing to keep indicies integrity intact.
-static void join_chunks(WorkQueue<ParseDataChunk>& chunks_, ModelData& chunk)
+static void join_chunks(FDBuffer<ParseDataChunk>& chunks_, ModelData& chunk)
 {
 	//ASSESS: Should I multi-thread this or is that overkill? Nevermind....probably overkill..
 	uint32 no_faces = 0;
@@ -195,12 +185,12 @@ static void join_chunks(WorkQueue<ParseDataChunk>& chunks_, ModelData& chunk)
 	uint32 no_normals = 0;
 	uint32 no_tex_coords = 0;
 
-	for (int i = 0; i < chunks_.jobs.size; i++)
+	for (int i = 0; i < chunks_.size; i++)
 	{
-		no_faces += chunks_.jobs[i].chunk_data.faces_vertices.length;
-		no_normals += chunks_.jobs[i].chunk_data.normals.length;
-		no_vertices += chunks_.jobs[i].chunk_data.vertices.length;
-		no_tex_coords += chunks_.jobs[i].chunk_data.tex_coords.length;
+		no_faces += chunks_[i].chunk_data.faces_vertices.length;
+		no_normals += chunks_[i].chunk_data.normals.length;
+		no_vertices += chunks_[i].chunk_data.vertices.length;
+		no_tex_coords += chunks_[i].chunk_data.tex_coords.length;
 	}
 	//Allocating the final chunk of memory that holds all the chunks.
 	vec3f* ptr_tex_chunk = chunk.tex_coords.allocate(no_tex_coords);
@@ -210,19 +200,19 @@ static void join_chunks(WorkQueue<ParseDataChunk>& chunks_, ModelData& chunk)
 	FaceData* ptr_face_data_chunk = chunk.faces_data.allocate(no_faces);
 
 
-	for (int i = 0; i < chunks_.jobs.size; i++)
+	for (int i = 0; i < chunks_.size; i++)
 	{
-		pl_buffer_copy(ptr_tex_chunk, chunks_.jobs[i].chunk_data.tex_coords.front, chunks_.jobs[i].chunk_data.tex_coords.length * sizeof(vec3f));
-		pl_buffer_copy(ptr_nor_chunk, chunks_.jobs[i].chunk_data.normals.front, chunks_.jobs[i].chunk_data.normals.length * sizeof(vec3f));
-		pl_buffer_copy(ptr_vert_chunk, chunks_.jobs[i].chunk_data.vertices.front, chunks_.jobs[i].chunk_data.vertices.length * sizeof(vec3f));
-		pl_buffer_copy(ptr_face_chunk, chunks_.jobs[i].chunk_data.faces_vertices.front, chunks_.jobs[i].chunk_data.faces_vertices.length * sizeof(FaceVertices));
-		pl_buffer_copy(ptr_face_data_chunk, chunks_.jobs[i].chunk_data.faces_data.front, chunks_.jobs[i].chunk_data.faces_data.length * sizeof(FaceData));
-
-		ptr_face_chunk += chunks_.jobs[i].chunk_data.faces_vertices.length;
-		ptr_face_data_chunk += chunks_.jobs[i].chunk_data.faces_data.length;
-		ptr_nor_chunk += chunks_.jobs[i].chunk_data.normals.length;
-		ptr_vert_chunk += chunks_.jobs[i].chunk_data.vertices.length;
-		ptr_tex_chunk += chunks_.jobs[i].chunk_data.tex_coords.length;
+		pl_buffer_copy(ptr_tex_chunk, chunks_[i].chunk_data.tex_coords.front, chunks_[i].chunk_data.tex_coords.length * sizeof(vec3f));
+		pl_buffer_copy(ptr_nor_chunk, chunks_[i].chunk_data.normals.front, chunks_[i].chunk_data.normals.length * sizeof(vec3f));
+		pl_buffer_copy(ptr_vert_chunk, chunks_[i].chunk_data.vertices.front, chunks_[i].chunk_data.vertices.length * sizeof(vec3f));
+		pl_buffer_copy(ptr_face_chunk, chunks_[i].chunk_data.faces_vertices.front, chunks_[i].chunk_data.faces_vertices.length * sizeof(FaceVertices));
+		pl_buffer_copy(ptr_face_data_chunk, chunks_[i].chunk_data.faces_data.front, chunks_[i].chunk_data.faces_data.length * sizeof(FaceData));
+
+		ptr_face_chunk += chunks_[i].chunk_data.faces_vertices.length;
+		ptr_face_data_chunk += chunks_[i].chunk_data.faces_data.length;
+		ptr_nor_chunk += chunks_[i].chunk_data.normals.length;
+		ptr_vert_chunk += chunks_[i].chunk_data.vertices.length;
+		ptr_tex_chunk += chunks_[i].chunk_data.tex_coords.length;
 	}
 }
 
@@ -275,7 +265,7 @@ static inline void clear_OBJ_Model_Load_Chunk_Data(OBJ_Model_Load_Chunk_Data& da
 	data.vertices.clear_buffer();
 }
 
-void load_model_data(ModelData& mdl, const char* file_name, ThreadPool& threadpool)
+void load_model_data(ModelData& mdl, const char* file_name, JobSystem& job_system)
 {
 	void* file;
 	if (!pl_get_file_handle((char*)file_name, &file))
@@ -295,12 +285,13 @@ void load_model_data(ModelData& mdl, const char* file_name, ThreadPool& threadpo
 		buffer_front[file_size] = 0;
 	}
 
-	int32 no_of_chunks = threadpool.threads.size;
+	//NOTE: a few chunks per worker so the workers that finish early can steal the rest.
+	int32 no_of_chunks = job_system.workers.size * 4;
 	
 
 	int32 general_chunk_size = (file_size + (no_of_chunks - 1)) / no_of_chunks;
-	WorkQueue<ParseDataChunk>chunks;
-	ParseDataChunk* chunk = chunks.jobs.allocate_preserve_type_info(no_of_chunks);
+	FDBuffer<ParseDataChunk> chunks;
+	ParseDataChunk* chunk = chunks.allocate_preserve_type_info(no_of_chunks);
 
 	char* ptr = buffer_front;
 	char* file_end = (buffer_front + (file_size - 1));
@@ -326,11 +317,20 @@ void load_model_data(ModelData& mdl, const char* file_name, ThreadPool& threadpo
 		chunk++;
 		ptr++;
 	}
-	chunks.jobs[chunks.jobs.size - 1].end++;		//accounting for off-by-one error ( now last chunk.end points to '\n')
-	*chunks.jobs[chunks.jobs.size - 1].end = '\n';	//to make the last character a new line.
+	//NOTE: small files can end up with less chunks than allocated
+	chunks.size = (int32)(chunk - chunks.front);
+
+	chunks[chunks.size - 1].end++;		//accounting for off-by-one error ( now last chunk.end points to '\n')
+	*chunks[chunks.size - 1].end = '\n';	//to make the last character a new line.
 
-	activate_pool(threadpool, start_parse_chunk_thread, &chunks);
-	wait_for_pool(threadpool, UINT32MAX);
+	JobCounter parse_counter = {};
+	volatile int32 chunks_parsed = 0;
+	for (int32 i = 0; i < chunks.size; i++)
+	{
+		ParseChunkJob job = { &chunks[i], &chunks_parsed, chunks.size };
+		submit_job(job_system, parse_chunk_job, &job, sizeof(job), &parse_counter);
+	}
+	wait_for_counter(job_system, parse_counter);
 
 	
 	//joining the chunks together
@@ -340,17 +340,17 @@ void load_model_data(ModelData& mdl, const char* file_name, ThreadPool& threadpo
 	prep_model_data(mdl);
 
 
-	if (chunks.jobs_done == chunks.jobs.size)
+	if (chunks_parsed == chunks.size)
 	{
 		//Freeing buffer thats filled with obj file 
 		pl_buffer_free(buffer_front);
 		//Deleting chunks
-		for (int i = 0; i < chunks.jobs.size; i++)
+		for (int i = 0; i < chunks.size; i++)
 		{
-			clear_OBJ_Model_Load_Chunk_Data(chunks.jobs[i].chunk_data);
+			clear_OBJ_Model_Load_Chunk_Data(chunks[i].chunk_data);
 		}
-		//deleting job queue buffer
-		chunks.jobs.clear();
+		//deleting chunks buffer
+		chunks.clear();
 	}
 	else
 	{
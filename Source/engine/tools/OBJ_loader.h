@@ -1,7 +1,7 @@
 #pragma once
 
 #include "engine/renderer/model.h"
-#include "thread_pool.h"
+#include "job_system.h"
 
-void load_model_data(ModelData& mdl, const char* file_name, ThreadPool& threadpool);
+void load_model_data(ModelData& mdl, const char* file_name, JobSystem& job_system);
 
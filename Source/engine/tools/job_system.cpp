@@ -0,0 +1,343 @@
+#include "job_system.h"
+
+#define JOB_WORKER_SLEEP_TIMEOUT_MS 10
+#define JOB_SPINS_BEFORE_YIELD 64
+
+static thread_local JobWorker* current_worker = 0;
+
+//NOTE: yields after spinning for a while, in case the thread holding the lock isn't running (more threads than cores).
+static FORCEDINLINE void backoff(uint32& spins)
+{
+	if (++spins < JOB_SPINS_BEFORE_YIELD)
+	{
+		_mm_pause();
+	}
+	else
+	{
+		pl_sleep_thread(0);
+	}
+}
+
+static FORCEDINLINE void lock_spin(volatile int32* lock)
+{
+	uint32 spins = 0;
+	while (interlocked_compare_exchange_i32(lock, 1, 0) != 0)
+	{
+		backoff(spins);
+	}
+}
+
+static FORCEDINLINE void unlock_spin(volatile int32* lock)
+{
+	interlocked_exchange_i32(lock, 0);
+}
+
+//----<Chase-Lev deque>----
+//NOTE: fixed capacity. push returns FALSE when full and the job gets run right away instead.
+
+static b32 deque_push(JobDeque& dq, Job& job)
+{
+	int64 b = dq.bottom;
+	int64 t = dq.top;
+	if (b - t >= JOB_DEQUE_CAPACITY)
+	{
+		return FALSE;
+	}
+	dq.jobs[b & (JOB_DEQUE_CAPACITY - 1)] = job;
+	COMPILER_BARRIER();	//job has to be written before thieves can see the new bottom
+	dq.bottom = b + 1;
+	return TRUE;
+}
+
+static b32 deque_pop(JobDeque& dq, Job& job)
+{
+	int64 b = dq.bottom - 1;
+	interlocked_exchange_i64(&dq.bottom, b);	//full barrier. Thieves have to see the new bottom before top is read.
+	int64 t = dq.top;
+	if (t > b)	//empty
+	{
+		dq.bottom = t;
+		return FALSE;
+	}
+	job = dq.jobs[b & (JOB_DEQUE_CAPACITY - 1)];
+	if (t == b)	//last job, racing the thieves for it
+	{
+		b32 won = interlocked_compare_exchange_i64(&dq.top, t + 1, t) == t;
+		dq.bottom = t + 1;
+		return won;
+	}
+	return TRUE;
+}
+
+static b32 deque_steal(JobDeque& dq, Job& job)
+{
+	int64 t = dq.top;
+	COMPILER_BARRIER();
+	int64 b = dq.bottom;
+	if (t >= b)
+	{
+		return FALSE;
+	}
+	job = dq.jobs[t & (JOB_DEQUE_CAPACITY - 1)];
+	return interlocked_compare_exchange_i64(&dq.top, t + 1, t) == t;
+}
+//----</Chase-Lev deque>----
+
+static FORCEDINLINE JobWorker* get_worker_of(JobSystem& system)
+{
+	return (current_worker && current_worker->system == &system) ? current_worker : 0;
+}
+
+static b32 find_job(JobSystem& system, JobWorker* worker, Job& job)
+{
+	if (worker && deque_pop(worker->deque, job))
+	{
+		return TRUE;
+	}
+
+	if (system.injection_head != system.injection_tail)
+	{
+		b32 found = FALSE;
+		lock_spin(&system.injection_lock);
+		if (system.injection_head < system.injection_tail)
+		{
+			job = system.injection[system.injection_head & (JOB_INJECTION_CAPACITY - 1)];
+			system.injection_head++;
+			found = TRUE;
+		}
+		unlock_spin(&system.injection_lock);
+		if (found)
+		{
+			return TRUE;
+		}
+	}
+
+	//stealing from the other workers, starting at a random one so thieves don't all hit the same deque
+	uint32 no_workers = system.workers.size;
+	uint32 start = 0;
+	if (worker)
+	{
+		worker->steal_seed ^= worker->steal_seed << 13;
+		worker->steal_seed ^= worker->steal_seed >> 17;
+		worker->steal_seed ^= worker->steal_seed << 5;
+		start = worker->steal_seed;
+	}
+	for (uint32 i = 0; i < no_workers; i++)
+	{
+		JobWorker* victim = &system.workers[(start + i) % no_workers];
+		if (victim != worker && deque_steal(victim->deque, job))
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void push_job(JobSystem& system, Job& job);
+
+static void finish_job(JobSystem& system, JobCounter* counter)
+{
+	if (!counter)
+	{
+		return;
+	}
+	Job* continuations = 0;
+	int32 no_continuations = 0;
+
+	lock_spin(&counter->lock);
+	if (interlocked_decrement_i32(&counter->remaining) == 0 && counter->continuations.length > 0)
+	{
+		continuations = counter->continuations.front;
+		no_continuations = counter->continuations.length;
+		counter->continuations.front = 0;
+		counter->continuations.length = 0;
+	}
+	unlock_spin(&counter->lock);
+	//NOTE: counter can't be touched from here on. Whoever was waiting on it might have freed it.
+
+	for (int32 i = 0; i < no_continuations; i++)
+	{
+		push_job(system, continuations[i]);
+	}
+	if (continuations)
+	{
+		pl_buffer_free(continuations);
+	}
+}
+
+static FORCEDINLINE void run_job(JobSystem& system, Job& job)
+{
+	job.proc(job.payload);
+	finish_job(system, job.counter);
+}
+
+static void push_job(JobSystem& system, Job& job)
+{
+	JobWorker* worker = get_worker_of(system);
+	if (worker)
+	{
+		if (!deque_push(worker->deque, job))
+		{
+			run_job(system, job);
+			return;
+		}
+	}
+	else
+	{
+		lock_spin(&system.injection_lock);
+		if (system.injection_tail - system.injection_head >= JOB_INJECTION_CAPACITY)
+		{
+			unlock_spin(&system.injection_lock);
+			run_job(system, job);
+			return;
+		}
+		system.injection[system.injection_tail & (JOB_INJECTION_CAPACITY - 1)] = job;
+		system.injection_tail++;
+		unlock_spin(&system.injection_lock);
+	}
+
+	//NOTE: interlocked read so it can't be reordered before the push. A worker going to sleep increments
+	//sleeping_workers before checking for jobs one last time, so either it sees this job or this sees it sleeping.
+	if (interlocked_add_i32(&system.sleeping_workers, 0) > 0)
+	{
+		pl_signal_semaphore(&system.wake_up, 1);
+	}
+}
+
+static FORCEDINLINE Job make_job(JobProc proc, void* payload, uint32 payload_size, JobCounter* counter)
+{
+	ASSERT(payload_size <= JOB_PAYLOAD_SIZE);
+	Job job;
+	job.proc = proc;
+	job.counter = counter;
+	if (payload_size > 0)
+	{
+		pl_buffer_copy(job.payload, payload, payload_size);
+	}
+	return job;
+}
+
+void submit_job(JobSystem& system, JobProc proc, void* payload, uint32 payload_size, JobCounter* counter)
+{
+	if (counter)
+	{
+		interlocked_increment_i32(&counter->remaining);
+	}
+	Job job = make_job(proc, payload, payload_size, counter);
+	push_job(system, job);
+}
+
+void submit_job_after(JobSystem& system, JobCounter& dependency, JobProc proc, void* payload, uint32 payload_size, JobCounter* counter)
+{
+	if (counter)
+	{
+		interlocked_increment_i32(&counter->remaining);
+	}
+	Job job = make_job(proc, payload, payload_size, counter);
+
+	lock_spin(&dependency.lock);
+	if (dependency.remaining == 0)
+	{
+		unlock_spin(&dependency.lock);
+		push_job(system, job);
+		return;
+	}
+	dependency.continuations.add_nocpy(job);
+	unlock_spin(&dependency.lock);
+}
+
+void wait_for_counter(JobSystem& system, JobCounter& counter)
+{
+	JobWorker* worker = get_worker_of(system);
+	Job job;
+	uint32 spins = 0;
+	while (!is_counter_done(counter))
+	{
+		if (find_job(system, worker, job))
+		{
+			run_job(system, job);
+			spins = 0;
+		}
+		else
+		{
+			backoff(spins);
+		}
+	}
+}
+
+int32 get_current_worker_index()
+{
+	return current_worker ? (int32)current_worker->index : -1;
+}
+
+static void worker_thread_proc(void* data)
+{
+	JobWorker* worker = (JobWorker*)data;
+	JobSystem& system = *worker->system;
+	current_worker = worker;
+
+	Job job;
+	while (system.running)
+	{
+		if (find_job(system, worker, job))
+		{
+			run_job(system, job);
+			continue;
+		}
+
+		interlocked_increment_i32(&system.sleeping_workers);
+		if (find_job(system, worker, job))
+		{
+			interlocked_decrement_i32(&system.sleeping_workers);
+			run_job(system, job);
+			continue;
+		}
+		//NOTE: timeout is just a safety net, submits wake up sleeping workers.
+		pl_wait_for_semaphore(&system.wake_up, JOB_WORKER_SLEEP_TIMEOUT_MS);
+		interlocked_decrement_i32(&system.sleeping_workers);
+	}
+	current_worker = 0;
+}
+
+void start_job_system(JobSystem& system, uint32 no_workers)
+{
+	ASSERT(no_workers > 0);
+	system.injection = (Job*)pl_buffer_alloc(JOB_INJECTION_CAPACITY * sizeof(Job));
+	system.injection_lock = 0;
+	system.injection_head = 0;
+	system.injection_tail = 0;
+	system.sleeping_workers = 0;
+	system.wake_up = pl_create_semaphore(0, 0x7FFFFFFF);
+	system.running = TRUE;
+
+	system.workers.allocate(no_workers);
+	for (uint32 i = 0; i < no_workers; i++)
+	{
+		JobWorker& worker = system.workers[i];
+		worker.deque.jobs = (Job*)pl_buffer_alloc(JOB_DEQUE_CAPACITY * sizeof(Job));
+		worker.system = &system;
+		worker.index = i;
+		worker.steal_seed = (i + 1) * 0x9E3779B9;
+	}
+	//NOTE: created after all workers are set up, as workers steal from each other right away
+	for (uint32 i = 0; i < no_workers; i++)
+	{
+		system.workers[i].handle = pl_create_thread(worker_thread_proc, &system.workers[i]);
+	}
+}
+
+void stop_job_system(JobSystem& system)
+{
+	system.running = FALSE;
+	pl_signal_semaphore(&system.wake_up, system.workers.size);
+	for (uint32 i = 0; i < system.workers.size; i++)
+	{
+		pl_wait_for_thread(&system.workers[i].handle, UINT32MAX);
+		pl_close_thread(&system.workers[i].handle);
+		pl_buffer_free(system.workers[i].deque.jobs);
+	}
+	system.workers.clear();
+	pl_close_semaphore(&system.wake_up);
+	pl_buffer_free(system.injection);
+	system.injection = 0;
+}
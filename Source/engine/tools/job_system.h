@@ -0,0 +1,94 @@
+#pragma once
+#include "PL/PL_math.h"
+#include "PL/pl_utils.h"
+
+//Persistent pool of worker threads running small jobs.
+//Every worker has its own lock-free deque (Chase-Lev): it pushes and pops jobs at the bottom, and workers that run out
+//of jobs steal from the top of other workers' deques. Threads that aren't workers (main thread) submit into a shared
+//injection queue instead.
+//Jobs can submit more jobs and wait on them (nested parallelism), since waiting runs other jobs instead of blocking.
+
+#define JOB_PAYLOAD_SIZE 48
+#define JOB_DEQUE_CAPACITY 4096		//must be power of 2
+#define JOB_INJECTION_CAPACITY 4096
+
+//payload points to a copy of the data given when submitting the job
+typedef void (*JobProc)(void* payload);
+
+struct JobCounter;
+
+struct Job
+{
+	JobProc proc;
+	JobCounter* counter;
+	uint8 payload[JOB_PAYLOAD_SIZE];
+};
+
+//Counts jobs not yet finished. Used to wait on a group of jobs, and to run jobs after a group is done (dependencies).
+//NOTE: must be zero initialized and must outlive all jobs that were submitted with it.
+struct JobCounter
+{
+	volatile int32 remaining;
+	volatile int32 lock;			//guards continuations, and is held while remaining reaches 0
+	DBuffer<Job, 0, 8, int32> continuations;	//jobs to submit once remaining reaches 0
+};
+
+struct JobDeque
+{
+	volatile int64 top;		//thieves take from here
+	volatile int64 bottom;	//owner pushes and pops here
+	Job* jobs;
+};
+
+struct JobSystem;
+struct JobWorker
+{
+	JobDeque deque;
+	ThreadHandle handle;
+	JobSystem* system;
+	uint32 index;
+	uint32 steal_seed;	//xorshift state for picking victims
+};
+
+struct JobSystem
+{
+	FDBuffer<JobWorker, uint32> workers;
+
+	//for submits from threads that aren't workers
+	Job* injection;
+	volatile int32 injection_lock;
+	volatile int64 injection_head;
+	volatile int64 injection_tail;
+
+	SemaphoreHandle wake_up;
+	volatile int32 sleeping_workers;
+	volatile b32 running;
+};
+
+void start_job_system(JobSystem& system, uint32 no_workers);
+
+//waits for the workers to finish their current job and closes them. Jobs still in the queues are dropped.
+void stop_job_system(JobSystem& system);
+
+//copies payload into the job. counter (optional) is incremented now and decremented when the job finishes.
+void submit_job(JobSystem& system, JobProc proc, void* payload, uint32 payload_size, JobCounter* counter);
+
+//job is submitted once dependency reaches 0 (right away if it already is).
+void submit_job_after(JobSystem& system, JobCounter& dependency, JobProc proc, void* payload, uint32 payload_size, JobCounter* counter);
+
+//runs other jobs until counter reaches 0. Can be called from inside a job.
+void wait_for_counter(JobSystem& system, JobCounter& counter);
+
+FORCEDINLINE b32 is_counter_done(JobCounter& counter)
+{
+	return counter.remaining == 0 && counter.lock == 0;
+}
+
+//true if some worker is out of jobs. Used to split big jobs only when it helps.
+FORCEDINLINE b32 has_idle_workers(JobSystem& system)
+{
+	return system.sleeping_workers > 0;
+}
+
+//index of worker thread calling this, or -1 if it isn't a worker
+int32 get_current_worker_index();
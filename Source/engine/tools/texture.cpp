@@ -63,9 +63,8 @@ namespace BMP_FILE_FORMAT
 		bmp.buffer_memory = pl_buffer_alloc(bmp.size());
 	}
 
-	static bool Write_To_File(BitmapBuffer& bmb, const char* file_name)
+	static void Setup_Bitmap_Headers(Bitmap& bmp, BitmapBuffer& bmb)
 	{
-		Bitmap bmp;
 		bmp.bitmap_buffer = bmb;
 		bmp.bih.bits_per_pixel = 8 * bmp.bitmap_buffer.bytes_per_pixel;
 		bmp.bih.planes = 1;
@@ -89,6 +88,20 @@ namespace BMP_FILE_FORMAT
 		bmp.bfh.reserved1 = 0;
 		bmp.bfh.reserved2 = 0;
 		bmp.bfh.total_file_size = 14 + sizeof(bmp.bih) + bmp.bitmap_buffer.size();
+	}
+
+	static void Write_Bitmap(Bitmap& bmp, void* file)
+	{
+		pl_append_to_file(file, &bmp.bfh, 14);
+		pl_append_to_file(file, &bmp.bih, sizeof(bmp.bih));
+		pl_append_to_file(file, bmp.bitmap_buffer.buffer_memory, bmp.bitmap_buffer.size());
+		pl_close_file_handle(file);
+	}
+
+	static bool Write_To_File(BitmapBuffer& bmb, const char* file_name)
+	{
+		Bitmap bmp;
+		Setup_Bitmap_Headers(bmp, bmb);
 
 		void* file = 0;
 
@@ -106,14 +119,64 @@ namespace BMP_FILE_FORMAT
 		}
 		if (file)
 		{
-			pl_append_to_file(file, &bmp.bfh, 14);
-			pl_append_to_file(file,&bmp.bih, sizeof(bmp.bih));
-			pl_append_to_file(file, bmp.bitmap_buffer.buffer_memory, bmp.bitmap_buffer.size());
-			pl_close_file_handle(file);
+			Write_Bitmap(bmp, file);
+		}
+		return true;
+	}
+
+	static bool Write_To_Path(BitmapBuffer& bmb, const char* path)
+	{
+		Bitmap bmp;
+		Setup_Bitmap_Headers(bmp, bmb);
+
+		void* file = 0;
+		if (!pl_create_or_overwrite_file(&file, (char*)path))
+		{
+			return false;
 		}
+		Write_Bitmap(bmp, file);
 		return true;
 	}
 
+	//Only reads 32 bit uncompressed/bitfield bitmaps, the ones Write_Bitmap writes
+	static bool Read_From_Path(BitmapBuffer& bmb, const char* path)
+	{
+		void* file = 0;
+		if (!pl_get_file_handle((char*)path, &file))
+		{
+			return false;
+		}
+		uint64 file_size = pl_get_file_size(file);
+		uint8* contents = 0;
+		if (file_size >= 14 + sizeof(BitmapDIBHeader) && file_size <= UINT32MAX)
+		{
+			contents = (uint8*)pl_buffer_alloc(file_size);
+			if (!pl_load_file_into(file, contents, (uint32)file_size))
+			{
+				pl_buffer_free(contents);
+				contents = 0;
+			}
+		}
+		pl_close_file_handle(file);
+		if (!contents)
+		{
+			return false;
+		}
+
+		BitmapFileHeader& bfh = *(BitmapFileHeader*)contents;
+		BitmapDIBHeader& bih = *(BitmapDIBHeader*)(contents + 14);
+		uint64 pixels_size = (uint64)bih.width * (uint64)bih.height * 4;
+		bool valid = bfh.bitmap_type[0] == 'B' && bfh.bitmap_type[1] == 'M' && bih.bits_per_pixel == 32 && (bih.compression == 0 || bih.compression == 3)
+			&& bih.width > 0 && bih.height > 0 && (uint64)bfh.offset_bits + pixels_size <= file_size;
+		if (valid)
+		{
+			Setup_Bitmap(bmb, bih.width, bih.height);
+			pl_buffer_copy(bmb.buffer_memory, contents + bfh.offset_bits, bmb.size());
+		}
+		pl_buffer_free(contents);
+		return valid;
+	}
+
 	//use if extracting this namespace for seperate BMP library, else defined in texture.h
 
 	/*inline void Set_Pixel(const Vec3<uint8>& color, Texture& buffer, int32 x, int32 y)
@@ -157,3 +220,36 @@ namespace BMP_FILE_FORMAT
 		ASSERT(false); //File initilization not defined for file type
 	}
 }
+
+bool Write_To_Path(Texture& tex, const char* path)
+{
+	if (tex.file_type == TextureFileType::BMP)
+	{
+		return BMP_FILE_FORMAT::Write_To_Path(tex.bmb, path);
+	}
+	else
+	{
+		return false;
+		ASSERT(false); //File initilization not defined for file type
+	}
+}
+
+bool Read_From_Path(Texture& tex, const char* path)
+{
+	tex.file_type = TextureFileType::BMP;	//NOTE: only format there is
+	return BMP_FILE_FORMAT::Read_From_Path(tex.bmb, path);
+}
+
+void Copy_Texture_Region(Texture& from, int32 from_x, int32 from_y, Texture& to, int32 to_x, int32 to_y, uint32 width, uint32 height)
+{
+	ASSERT(from.bmb.bytes_per_pixel == to.bmb.bytes_per_pixel);
+	ASSERT(from_x >= 0 && from_y >= 0 && from_x + width <= from.bmb.width && from_y + height <= from.bmb.height);
+	ASSERT(to_x >= 0 && to_y >= 0 && to_x + width <= to.bmb.width && to_y + height <= to.bmb.height);
+	uint32 bpp = from.bmb.bytes_per_pixel;
+	for (uint32 y = 0; y < height; y++)
+	{
+		uint8* src = (uint8*)from.bmb.buffer_memory + ((from_y + y) * from.bmb.width + from_x) * bpp;
+		uint8* dst = (uint8*)to.bmb.buffer_memory + ((to_y + y) * to.bmb.width + to_x) * bpp;
+		pl_buffer_copy(dst, src, width * bpp);
+	}
+}
@@ -28,15 +28,26 @@ FORCEDINLINE void Set_Pixel(const Vec3<uint8>& color, Texture& texture, int32 x,
 {
 	if (texture.file_type == TextureFileType::BMP)
 	{
-		Vec3<uint8> rgb_color = { color.z, color.y,color.x };
 		ASSERT(((((uint32)x <= texture.bmb.width) && (x >= 0)) && (((uint32)y <= texture.bmb.height) && (y >= 0))));
 
 		uint32* pixel = (uint32*)texture.bmb.buffer_memory;
 		pixel += y * texture.bmb.width + x;
-		*pixel = *(uint32*)&rgb_color.raw[0] & 0x00FFFFFF;
+		//BGRA: b is the lowest byte. (Reading the 3 byte color as a uint32 reads past it.)
+		*pixel = ((uint32)color.x << 16) | ((uint32)color.y << 8) | (uint32)color.z;
 	}
 }
 
 bool Setup_Texture(Texture& tex, TextureFileType file_type, uint32 width, uint32 height);
 
-bool Write_To_File(Texture& texture, const char* file_name);
\ No newline at end of file
+//Writes to file_name_<n>.bmp, with the first n that doesn't overwrite an existing file.
+bool Write_To_File(Texture& texture, const char* file_name);
+
+//Writes to exactly path (extension included), overwriting it if it exists. Returns false if the file couldn't be created.
+bool Write_To_Path(Texture& texture, const char* path);
+
+//Loads the image at path into a new texture (freed with pl_buffer_free(tex.bmb.buffer_memory)). Returns false if the
+//file can't be read or isn't a 32 bit BMP.
+bool Read_From_Path(Texture& texture, const char* path);
+
+//Copies a width x height block of pixels from [from_x,from_y] of from to [to_x,to_y] of to
+void Copy_Texture_Region(Texture& from, int32 from_x, int32 from_y, Texture& to, int32 to_x, int32 to_y, uint32 width, uint32 height);
@@ -1,5 +1,5 @@
 #pragma once
-#include "PL/pl_math.h"
+#include "PL/PL_math.h"
 
 static inline b32 is_whitespace(char ch)
 {